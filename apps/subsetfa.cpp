@@ -28,33 +28,255 @@
  *
  */
 
+#include <cstddef>
 #include <cstdlib>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <unordered_set>
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
 
 #include "fastaObj.hpp"
+#include "fastaIndex.hpp"
+#include "fastaServer.hpp"
+#include "fastaWriter.hpp"
+#include "headerIndex.hpp"
+#include "inputStream.hpp"
+#include "runStatistics.hpp"
 #include "utilities.hpp"
 
 int main(int argc, char *argv[]) {
 	// set usage message
 	const std::string cliHelp = "Available command line flags (in any order):\n" 
 		"  --input-fasta   file_name (input multi-record FASTA file name; required).\n" 
+		"                  gzip and bgzip-compressed files are read directly.\n"
+		"                  Several files (shards) may be given as a comma-separated\n"
+		"                  list or as @list_file with one file name per line; they are\n"
+		"                  then filtered on --threads threads and merged into one output.\n"
 		"  --header-list   subset_file_name (list of FASTA headers to extract; required).\n"
 		"                  The header list must one whole FASTA header per line,\n"
 		"                  with or without the leading '>'.\n"
-		"  --out-file      out_file_name (output file name; default is 'subset.fasta').\n";
+		"  --batch         manifest_file_name (extract several subsets in one pass;\n"
+		"                  replaces --header-list and --out-file). Each manifest line\n"
+		"                  has a header list file name and an output file name.\n"
+		"                  Records are written in input order.\n"
+		"  --out-file      out_file_name (output file name; default is 'subset.fasta').\n"
+		"  --shard-outputs write each input shard's records to its own file, named\n"
+		"                  shard_out_file_name (no value).\n"
+		"  --use-index     extract records by seeking with a FASTA index (input_fasta.fai),\n"
+		"                  built if absent or older than the FASTA file (no value).\n"
+		"                  Compressed input must then be bgzip-compressed.\n"
+		"                  The header list may then also contain name:start-end regions.\n"
+		"  --threads       number of threads for loading the whole FASTA file,\n"
+		"                  for filtering several input files, and for decompressing\n"
+		"                  bgzip input (default 1).\n"
+		"  --pack-sequences  store sequences with two bits per base when loading the whole\n"
+		"                  FASTA file, to reduce memory use (no value).\n"
+		"  --snapshot      keep a binary snapshot of the parsed FASTA file next to it\n"
+		"                  (input_fasta.fsnap) and reload from it on later runs (no value).\n"
+		"                  An existing snapshot is used, and refreshed if the FASTA file\n"
+		"                  changed, without this flag. Not used with --pack-sequences.\n"
+		"  --order         output record order: 'input' (as in the FASTA file; default)\n"
+		"                  or 'list' (as in the header list).\n"
+		"  --match         how header list entries are matched: 'whole' (whole header;\n"
+		"                  default), 'accession' (first word of the header), or 'prefix'\n"
+		"                  (beginning of the header).\n"
+		"  --line-width    maximal number of sequence characters per output line\n"
+		"                  (default 0: each sequence on one line).\n"
+		"  --out-compress  output compression: 'none' (default) or 'bgzf' (blocked gzip,\n"
+		"                  as from bgzip, compressed on --threads threads).\n"
+		"  --out-index     write a FASTA index (out_file_name.fai) and, for bgzf output,\n"
+		"                  a block index (out_file_name.gzi) with the output (no value).\n"
+		"                  Not used with --batch or --server.\n"
+		"  --serve         socket_path (keep the input FASTA files in memory and answer\n"
+		"                  subset requests on a Unix domain socket until stopped;\n"
+		"                  --input-fasta may then be a comma-separated list of files).\n"
+		"  --server        socket_path (send the header list to a server started with\n"
+		"                  --serve instead of reading the FASTA file; --input-fasta\n"
+		"                  names one of the server's files).\n"
+		"  --stats         report phase times, bytes read and written, record counts,\n"
+		"                  and peak memory use; to standard error if given no value,\n"
+		"                  otherwise as JSON to the named file.\n";
 
 	try {
 		std::unordered_map <std::string, std::string> clInfo;
 		std::unordered_map <std::string, std::string> stringVariables;
 		BayesicSpace::parseCL(argc, argv, clInfo);
 		BayesicSpace::extractCLinfo(clInfo, stringVariables);
+		size_t nThreads{1};
+		try {
+			if (stringVariables.at("threads").front() == '-') {
+				throw std::invalid_argument("negative thread number");
+			}
+			nThreads = std::stoul( stringVariables.at("threads") );
+		} catch(const std::exception &problem) {
+			throw std::string("ERROR: --threads must be a non-negative integer");
+		}
+		size_t lineWidth{0};
+		try {
+			if (stringVariables.at("line-width").front() == '-') {
+				throw std::invalid_argument("negative line width");
+			}
+			lineWidth = std::stoul( stringVariables.at("line-width") );
+		} catch(const std::exception &problem) {
+			throw std::string("ERROR: --line-width must be a non-negative integer");
+		}
+		BayesicSpace::OutputFormat outFormat;
+		outFormat.lineWidth    = lineWidth;
+		outFormat.nThreads     = nThreads;
+		outFormat.writeIndexes = (stringVariables.at("out-index") == "set");
+		if (stringVariables.at("out-compress") == "bgzf") {
+			outFormat.compression = BayesicSpace::Compression::bgzf;
+		} else if (stringVariables.at("out-compress") != "none") {
+			throw std::string("ERROR: --out-compress must be 'none' or 'bgzf'");
+		}
+		BayesicSpace::RecordOrder order{BayesicSpace::RecordOrder::input};
+		if (stringVariables.at("order") == "list") {
+			order = BayesicSpace::RecordOrder::list;
+		} else if (stringVariables.at("order") != "input") {
+			throw std::string("ERROR: --order must be 'input' or 'list'");
+		}
+		BayesicSpace::HeaderMatch match{BayesicSpace::HeaderMatch::whole};
+		if (stringVariables.at("match") == "accession") {
+			match = BayesicSpace::HeaderMatch::accession;
+		} else if (stringVariables.at("match") == "prefix") {
+			match = BayesicSpace::HeaderMatch::prefix;
+		} else if (stringVariables.at("match") != "whole") {
+			throw std::string("ERROR: --match must be 'whole', 'accession', or 'prefix'");
+		}
 
-		BayesicSpace::Fasta fastaData( stringVariables.at("input-fasta") );
-		std::unordered_map<std::string, std::string> subset{fastaData.subset( stringVariables.at("header-list") )};
-		BayesicSpace::saveAsFASTA( subset, stringVariables.at("out-file") );
+		BayesicSpace::RunStatistics statistics(stringVariables.at("stats") != "unset");
+		// number of distinct header list entries, used to count missing records
+		auto countUnique = [](const std::vector<std::string> &entries){
+			return std::unordered_set<std::string>( entries.begin(), entries.end() ).size();
+		};
+
+		// a server loads its files once and answers requests until stopped
+		if (stringVariables.at("serve") != "unset") {
+			const std::vector<std::string> fastaFileNames{BayesicSpace::inputFileNames( stringVariables.at("input-fasta") )};
+			BayesicSpace::FastaServer server(stringVariables.at("serve"), fastaFileNames, nThreads, stringVariables.at("pack-sequences") == "set");
+			std::cerr << "Serving " << server.size() << " FASTA file(s) on " << stringVariables.at("serve") << "\n";
+			server.serve();
+			return 0;
+		}
+
+		// route a batch of lists in one pass, or seek with the index if requested; otherwise stream through the FASTA file unless the header list is at least as large,
+		// in which case loading the whole file costs little extra
+		// a server client names one of the server's files
+		const std::vector<std::string> fastaFileNames{
+			stringVariables.at("server") == "unset" ? BayesicSpace::inputFileNames( stringVariables.at("input-fasta") ) : std::vector<std::string>{stringVariables.at("input-fasta")}
+		};
+		if ( fastaFileNames.empty() ) {
+			throw std::string("ERROR: no input FASTA file names given");
+		}
+		// a snapshot maps the sequences instead of parsing them, so with one, loading the whole file beats streaming through it
+		const bool useSnapshot{(stringVariables.at("pack-sequences") != "set") &&
+			( (stringVariables.at("snapshot") == "set") || ( BayesicSpace::fileSize( BayesicSpace::Fasta::snapshotFileName( fastaFileNames.front() ) ) > 0 ) )};
+		const bool sharded{( fastaFileNames.size() > 1 ) || (stringVariables.at("shard-outputs") == "set")};
+		if ( sharded && ( (stringVariables.at("batch") != "unset") || (stringVariables.at("use-index") == "set") || (stringVariables.at("server") != "unset") ) ) {
+			throw std::string("ERROR: --batch, --use-index, and --server take a single input FASTA file");
+		}
+		if ( ( (outFormat.compression != BayesicSpace::Compression::none) || outFormat.writeIndexes ) &&
+				( (stringVariables.at("batch") != "unset") || (stringVariables.at("server") != "unset") ) ) {
+			throw std::string("ERROR: --out-compress and --out-index cannot be used with --batch or --server");
+		}
+		if (stringVariables.at("server") != "unset") {
+			statistics.startPhase("header list");
+			BayesicSpace::SubsetRequest request;
+			request.fastaName = stringVariables.at("input-fasta");
+			request.headers   = BayesicSpace::readHeaderList( stringVariables.at("header-list") );
+			request.order     = order;
+			request.match     = match;
+			request.lineWidth = lineWidth;
+			statistics.startPhase("request");
+			BayesicSpace::requestSubset(stringVariables.at("server"), request, stringVariables.at("out-file"));
+		} else if (sharded) {
+			statistics.startPhase("header list");
+			const BayesicSpace::FastaFilter headerFilter(stringVariables.at("header-list"), match);
+			std::vector<std::string> outFileNames{stringVariables.at("out-file")};
+			if (stringVariables.at("shard-outputs") == "set") {
+				outFileNames.clear();
+				for (const auto &eachFileName : fastaFileNames) {
+					outFileNames.push_back( BayesicSpace::shardOutFileName( eachFileName, stringVariables.at("out-file") ) );
+				}
+			}
+			statistics.startPhase("filter");
+			headerFilter.filterShards(fastaFileNames, outFileNames, nThreads, order, outFormat, statistics);
+			// with per-shard outputs a header may be matched in several shards
+			if ( (match == BayesicSpace::HeaderMatch::whole) && ( outFileNames.size() == 1 ) ) {
+				statistics.addCount( "records missing", headerFilter.size() - statistics.count("records matched") );
+			}
+		} else if (stringVariables.at("batch") != "unset") {
+			statistics.startPhase("header lists");
+			const BayesicSpace::FastaDemultiplexer batchRouter( stringVariables.at("batch") );
+			statistics.startPhase("demultiplex");
+			batchRouter.demultiplex(fastaFileNames.front(), nThreads, lineWidth, statistics);
+			statistics.addCount( "records missing", batchRouter.nHeaders() - statistics.count("records matched") );
+		} else if (stringVariables.at("use-index") == "set") {
+			statistics.startPhase("index");
+			BayesicSpace::IndexedFasta indexedData( fastaFileNames.front() );
+			if (match != BayesicSpace::HeaderMatch::whole) {
+				indexedData.buildHeaderIndex();
+			}
+			statistics.startPhase("header list");
+			const std::vector<std::string> headerList{BayesicSpace::readHeaderList( stringVariables.at("header-list") )};
+			const std::vector<std::string> requests{indexedData.matchHeaders(headerList, match)};
+			statistics.startPhase("extract");
+			const auto subset{indexedData.orderedSubset(requests, order)};
+			statistics.startPhase("write");
+			BayesicSpace::saveAsFASTA(subset, stringVariables.at("out-file"), outFormat);
+			statistics.addCount( "records matched", subset.size() );
+			if (match == BayesicSpace::HeaderMatch::whole) {
+				statistics.addCount( "records missing", countUnique(headerList) - subset.size() );
+			}
+		} else if ( !useSnapshot && ( BayesicSpace::fileSize( stringVariables.at("header-list") ) < BayesicSpace::fileSize( fastaFileNames.front() ) ) ) {
+			statistics.startPhase("header list");
+			const BayesicSpace::FastaFilter headerFilter(stringVariables.at("header-list"), match);
+			statistics.startPhase("filter");
+			headerFilter.filter(fastaFileNames.front(), stringVariables.at("out-file"), nThreads, order, outFormat, statistics);
+			if (match == BayesicSpace::HeaderMatch::whole) {
+				statistics.addCount( "records missing", headerFilter.size() - statistics.count("records matched") );
+			}
+		} else {
+			statistics.startPhase("load");
+			BayesicSpace::Fasta fastaData(fastaFileNames.front(), nThreads, stringVariables.at("pack-sequences") == "set", useSnapshot);
+			if (match != BayesicSpace::HeaderMatch::whole) {
+				fastaData.buildHeaderIndex();
+			}
+			statistics.addCount( "records parsed", fastaData.size() );
+			statistics.setValue( "record table load factor", static_cast<double>( fastaData.loadFactor() ) );
+			statistics.startPhase("header list");
+			const std::vector<std::string> headerList{BayesicSpace::readHeaderList( stringVariables.at("header-list") )};
+			const std::vector<std::string> headers{fastaData.matchHeaders(headerList, match)};
+			statistics.startPhase("subset");
+			const std::vector<size_t> subset{fastaData.subsetIndexes(headers, order)};
+			statistics.startPhase("write");
+			BayesicSpace::saveAsFASTA(fastaData, subset, stringVariables.at("out-file"), outFormat);
+			statistics.addCount( "records matched", subset.size() );
+			if (match == BayesicSpace::HeaderMatch::whole) {
+				statistics.addCount( "records missing", countUnique(headerList) - subset.size() );
+			}
+		}
+		statistics.endPhase();
+
+		if ( statistics.enabled() ) {
+			// bytes counted by the library as they are read and written, so indexed, snapshot, compressed, and server runs report what they actually transfer
+			statistics.addCount( "bytes read", BayesicSpace::RunStatistics::bytesRead() );
+			statistics.addCount( "bytes written", BayesicSpace::RunStatistics::bytesWritten() );
+			if (stringVariables.at("stats") == "set") {
+				statistics.report(std::cerr);
+			} else {
+				std::fstream statsFile;
+				statsFile.open(stringVariables.at("stats"), std::ios::out | std::ios::trunc);
+				if ( !statsFile.is_open() ) {
+					throw std::string("ERROR: cannot open statistics file ") + stringVariables.at("stats");
+				}
+				statsFile << statistics.json();
+				statsFile.close();
+			}
+		}
 	} catch(std::string &problem) {
 		std::cerr << problem << "\n";
 		std::cerr << cliHelp;
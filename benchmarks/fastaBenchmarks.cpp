@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// FASTA operation benchmark suite
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Measures the `Fasta` constructor, `Fasta::subset`, `Fasta::subsetIndexes`, `saveAsFASTA` (plain and BGZF) and `FastaFilter::filter` on a deterministic synthetic FASTA file.
+ * Results are printed as JSON to standard output or saved to a file.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+#include <sys/resource.h>
+
+#include "fastaObj.hpp"
+#include "fastaWriter.hpp"
+#include "headerSet.hpp"
+#include "utilities.hpp"
+#include "syntheticFasta.hpp"
+
+namespace {
+	/** \brief One benchmark result */
+	struct BenchmarkResult {
+		/** \brief Benchmark name */
+		std::string name;
+		/** \brief Shortest time over repeats, in seconds */
+		double seconds{0.0};
+		/** \brief Bytes processed per run */
+		size_t nBytes{0};
+		/** \brief Records processed per run */
+		size_t nRecords{0};
+		/** \brief Peak resident set size of the process after the benchmark, in kilobytes */
+		int64_t peakRSSkB{0};
+	};
+
+	/** \brief Peak resident set size
+	 *
+	 * \return peak resident set size of the process so far, in kilobytes
+	 */
+	int64_t peakRSS() {
+		struct rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss;
+	}
+
+	/** \brief Time a function
+	 *
+	 * \tparam FunctionT callable type
+	 * \param[in] nRepeats number of runs
+	 * \param[in] function function to time
+	 * \return shortest run time in seconds
+	 */
+	template <typename FunctionT>
+	double bestTime(const size_t &nRepeats, FunctionT function) {
+		double best = std::numeric_limits<double>::max();
+		for (size_t iRepeat = 0; iRepeat < nRepeats; ++iRepeat) {
+			const auto startTime = std::chrono::steady_clock::now();
+			function();
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+			best = std::min( best, elapsed.count() );
+		}
+		return best;
+	}
+
+	/** \brief Convert a benchmark result to JSON
+	 *
+	 * \param[in] result benchmark result
+	 * \return JSON object
+	 */
+	std::string toJSON(const BenchmarkResult &result) {
+		constexpr double bytesPerMB{1e6};
+		std::stringstream jsonStream;
+		jsonStream << "{\"name\": \"" << result.name << "\", \"seconds\": " << result.seconds
+			<< ", \"bytes\": " << result.nBytes << ", \"records\": " << result.nRecords
+			<< ", \"MBperSecond\": " << static_cast<double>(result.nBytes) / bytesPerMB / result.seconds
+			<< ", \"recordsPerSecond\": " << static_cast<double>(result.nRecords) / result.seconds
+			<< ", \"peakRSSkB\": " << result.peakRSSkB << "}";
+		return jsonStream.str();
+	}
+
+	/** \brief Read a numeric flag
+	 *
+	 * \param[in] clInfo parsed command line
+	 * \param[in] flag flag name
+	 * \param[in] defaultValue value if the flag is absent
+	 * \return flag value
+	 */
+	double numericFlag(const std::unordered_map<std::string, std::string> &clInfo, const std::string &flag, const double &defaultValue) {
+		auto search = clInfo.find(flag);
+		if ( search == clInfo.end() ) {
+			return defaultValue;
+		}
+		try {
+			const double value = std::stod(search->second);
+			if (value < 0.0) {
+				throw std::invalid_argument("negative value");
+			}
+			return value;
+		} catch(const std::exception &problem) {
+			throw std::string("ERROR: --") + flag + std::string(" must be a non-negative number");
+		}
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const std::string cliHelp = "Available command line flags (in any order; all optional):\n"
+		"  --records          number of FASTA records (default 2000).\n"
+		"  --record-length    number of bases per record (default 100000).\n"
+		"  --line-width       number of bases per line; 0 for one line (default 80).\n"
+		"  --header-length    minimal header length (default 24).\n"
+		"  --subset-fraction  fraction of records to extract (default 0.1).\n"
+		"  --threads          number of threads for loading (default 1).\n"
+		"  --repeats          number of runs of each benchmark; the fastest is reported (default 3).\n"
+		"  --json             output JSON file name (default: standard output).\n";
+	try {
+		std::unordered_map<std::string, std::string> clInfo;
+		BayesicSpace::parseCL(argc, argv, clInfo);
+		if (clInfo.count("help") > 0) {
+			std::cout << cliHelp;
+			return 0;
+		}
+		BayesicSpace::SyntheticFastaParameters parameters;
+		parameters.nRecords       = static_cast<size_t>( numericFlag( clInfo, "records", static_cast<double>(parameters.nRecords) ) );
+		parameters.recordLength   = static_cast<size_t>( numericFlag( clInfo, "record-length", static_cast<double>(parameters.recordLength) ) );
+		parameters.lineWidth      = static_cast<size_t>( numericFlag( clInfo, "line-width", static_cast<double>(parameters.lineWidth) ) );
+		parameters.headerLength   = static_cast<size_t>( numericFlag( clInfo, "header-length", static_cast<double>(parameters.headerLength) ) );
+		parameters.subsetFraction = std::min(numericFlag(clInfo, "subset-fraction", parameters.subsetFraction), 1.0);
+		const auto nThreads       = static_cast<size_t>( numericFlag(clInfo, "threads", 1.0) );
+		const auto nRepeats       = std::max(static_cast<size_t>( numericFlag(clInfo, "repeats", 3.0) ), static_cast<size_t>(1));
+
+		// benchmark files are kept out of the working directory and removed at the end
+		const BayesicSpace::ScratchDirectory scratch("fastaBenchmarks");
+		const std::string fastaFileName{scratch.path("benchmark.fasta")};
+		const std::string listFileName{scratch.path("benchmarkList.txt")};
+		const std::string outFileName{scratch.path("benchmarkSubset.fasta")};
+		BayesicSpace::writeSyntheticFasta(parameters, fastaFileName);
+		BayesicSpace::writeSyntheticSubset(parameters, listFileName);
+		const std::vector<std::string> subsetHeaders{BayesicSpace::syntheticSubset(parameters)};
+		const size_t nInputBytes = BayesicSpace::fileSize(fastaFileName);
+
+		std::vector<BenchmarkResult> results;
+		BenchmarkResult loadResult;
+		loadResult.name     = "Fasta constructor";
+		loadResult.nBytes   = nInputBytes;
+		loadResult.nRecords = parameters.nRecords;
+		loadResult.seconds  = bestTime(nRepeats, [&fastaFileName, &nThreads]{
+			const BayesicSpace::Fasta fastaData(fastaFileName, nThreads);
+		});
+		loadResult.peakRSSkB = peakRSS();
+		results.push_back(loadResult);
+
+		// the first load writes the snapshot, so that the timed runs map it
+		const BayesicSpace::Fasta snapshotSource(fastaFileName, nThreads, false, true);
+		BenchmarkResult snapshotResult(loadResult);
+		snapshotResult.name    = "Fasta constructor (snapshot)";
+		snapshotResult.seconds = bestTime(nRepeats, [&fastaFileName, &nThreads]{
+			const BayesicSpace::Fasta fastaData(fastaFileName, nThreads, false, true);
+		});
+		snapshotResult.peakRSSkB = peakRSS();
+		results.push_back(snapshotResult);
+		std::remove( BayesicSpace::Fasta::snapshotFileName(fastaFileName).c_str() );
+
+		const BayesicSpace::Fasta fastaData(fastaFileName, nThreads);
+		std::unordered_map<std::string, std::string> subset;
+		BenchmarkResult vectorResult;
+		vectorResult.name    = "Fasta::subset(vector)";
+		vectorResult.seconds = bestTime(nRepeats, [&fastaData, &subsetHeaders, &subset]{
+			subset = fastaData.subset(subsetHeaders);
+		});
+		size_t nSubsetBytes{0};
+		for (const auto &eachRecord : subset) {
+			nSubsetBytes += eachRecord.first.size() + eachRecord.second.size();
+		}
+		vectorResult.nBytes    = nSubsetBytes;
+		vectorResult.nRecords  = subset.size();
+		vectorResult.peakRSSkB = peakRSS();
+		results.push_back(vectorResult);
+
+		BenchmarkResult fileResult(vectorResult);
+		fileResult.name    = "Fasta::subset(file)";
+		fileResult.seconds = bestTime(nRepeats, [&fastaData, &listFileName, &subset]{
+			subset = fastaData.subset(listFileName);
+		});
+		fileResult.peakRSSkB = peakRSS();
+		results.push_back(fileResult);
+
+		BenchmarkResult saveResult;
+		saveResult.name     = "saveAsFASTA";
+		saveResult.nRecords = subset.size();
+		saveResult.seconds  = bestTime(nRepeats, [&subset, &outFileName]{
+			BayesicSpace::saveAsFASTA(subset, outFileName);
+		});
+		saveResult.nBytes    = BayesicSpace::fileSize(outFileName);
+		saveResult.peakRSSkB = peakRSS();
+		results.push_back(saveResult);
+
+		std::vector<size_t> subsetIndexes;
+		BenchmarkResult indexResult(vectorResult);
+		indexResult.name    = "Fasta::subsetIndexes";
+		indexResult.seconds = bestTime(nRepeats, [&fastaData, &subsetHeaders, &subsetIndexes]{
+			subsetIndexes = fastaData.subsetIndexes(subsetHeaders, BayesicSpace::RecordOrder::input);
+		});
+		indexResult.peakRSSkB = peakRSS();
+		results.push_back(indexResult);
+
+		BenchmarkResult saveIndexResult;
+		saveIndexResult.name     = "saveAsFASTA(indexes)";
+		saveIndexResult.nRecords = subsetIndexes.size();
+		saveIndexResult.seconds  = bestTime(nRepeats, [&fastaData, &subsetIndexes, &outFileName]{
+			BayesicSpace::saveAsFASTA(fastaData, subsetIndexes, outFileName, 0);
+		});
+		saveIndexResult.nBytes    = BayesicSpace::fileSize(outFileName);
+		saveIndexResult.peakRSSkB = peakRSS();
+		results.push_back(saveIndexResult);
+
+		// BGZF output compressed on the benchmark threads; nBytes is the compressed size
+		BenchmarkResult saveBgzfResult(saveIndexResult);
+		saveBgzfResult.name = "saveAsFASTA(indexes, bgzf)";
+		BayesicSpace::OutputFormat bgzfFormat;
+		bgzfFormat.compression = BayesicSpace::Compression::bgzf;
+		bgzfFormat.nThreads    = nThreads;
+		const std::string bgzfFileName{outFileName + ".gz"};
+		saveBgzfResult.seconds   = bestTime(nRepeats, [&fastaData, &subsetIndexes, &bgzfFileName, &bgzfFormat]{
+			BayesicSpace::saveAsFASTA(fastaData, subsetIndexes, bgzfFileName, bgzfFormat);
+		});
+		saveBgzfResult.nBytes    = BayesicSpace::fileSize(bgzfFileName);
+		saveBgzfResult.peakRSSkB = peakRSS();
+		results.push_back(saveBgzfResult);
+		std::remove( bgzfFileName.c_str() );
+
+		BenchmarkResult filterResult;
+		filterResult.name     = "FastaFilter::filter";
+		filterResult.nBytes   = nInputBytes;
+		filterResult.nRecords = parameters.nRecords;
+		const BayesicSpace::FastaFilter listFilter(subsetHeaders);
+		filterResult.seconds  = bestTime(nRepeats, [&listFilter, &fastaFileName, &outFileName, &nThreads]{
+			listFilter.filter(fastaFileName, outFileName, nThreads);
+		});
+		filterResult.peakRSSkB = peakRSS();
+		results.push_back(filterResult);
+
+		// the whole file header list probed with every record header, as a stand-in for multi-million-entry lists
+		std::vector<std::string> allHeaders;
+		allHeaders.reserve( fastaData.size() );
+		for (size_t iRecord = 0; iRecord < fastaData.size(); ++iRecord) {
+			allHeaders.push_back( fastaData.header(iRecord).str() );
+		}
+		size_t nFound{0};
+		BenchmarkResult hashLookupResult;
+		hashLookupResult.name     = "header lookup (unordered_set)";
+		hashLookupResult.nRecords = allHeaders.size();
+		hashLookupResult.seconds  = bestTime(nRepeats, [&allHeaders, &nFound]{
+			const std::unordered_set<std::string> headerTable( allHeaders.begin(), allHeaders.end() );
+			nFound = 0;
+			for (const auto &eachHeader : allHeaders) {
+				nFound += headerTable.count(eachHeader);
+			}
+		});
+		hashLookupResult.peakRSSkB = peakRSS();
+		results.push_back(hashLookupResult);
+
+		BenchmarkResult setLookupResult(hashLookupResult);
+		setLookupResult.name    = "header lookup (HeaderSet)";
+		setLookupResult.seconds = bestTime(nRepeats, [&allHeaders, &nFound]{
+			const BayesicSpace::HeaderSet headerSet(allHeaders);
+			nFound = 0;
+			for (const auto &eachHeader : allHeaders) {
+				nFound += static_cast<size_t>( headerSet.find(eachHeader) < headerSet.size() );
+			}
+		});
+		setLookupResult.peakRSSkB = peakRSS();
+		results.push_back(setLookupResult);
+
+		std::stringstream json;
+		json << "{\n  \"parameters\": {\"records\": " << parameters.nRecords << ", \"recordLength\": " << parameters.recordLength
+			<< ", \"lineWidth\": " << parameters.lineWidth << ", \"headerLength\": " << parameters.headerLength
+			<< ", \"subsetFraction\": " << parameters.subsetFraction << ", \"threads\": " << nThreads << ", \"repeats\": " << nRepeats
+			<< ", \"inputBytes\": " << nInputBytes << "},\n  \"benchmarks\": [\n";
+		for (size_t iResult = 0; iResult < results.size(); ++iResult) {
+			json << "    " << toJSON(results[iResult]) << (iResult + 1 < results.size() ? ",\n" : "\n");
+		}
+		json << "  ]\n}\n";
+		if (clInfo.count("json") > 0) {
+			std::fstream outJSON;
+			outJSON.open(clInfo.at("json"), std::ios::out | std::ios::trunc);
+			outJSON << json.str();
+			outJSON.close();
+		} else {
+			std::cout << json.str();
+		}
+	} catch(std::string &problem) {
+		std::cerr << problem << "\n";
+		std::cerr << cliHelp;
+		return 1;
+	}
+	return 0;
+}
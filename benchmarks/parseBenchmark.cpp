@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Parse throughput benchmark
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Compares the original line-by-line FASTA parser with the block scanner used by `Fasta`.
+ * Takes an optional FASTA file name; otherwise generates a synthetic file in a temporary directory that is removed at the end.
+ *
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <exception>
+
+#include "fastaObj.hpp"
+#include "mappedFile.hpp"
+#include "scanner.hpp"
+#include "utilities.hpp"
+#include "syntheticFasta.hpp"
+
+namespace {
+	/** \brief Line-by-line parser as originally implemented in the `Fasta` constructor
+	 *
+	 * \param[in] inFileName input FASTA file name
+	 * \return number of records
+	 */
+	size_t getlineParse(const std::string &inFileName) {
+		std::unordered_map<std::string, std::string> fastaData;
+		std::fstream inFASTA;
+		std::string eachLine;
+		inFASTA.open(inFileName, std::ios::in);
+		if ( !inFASTA.is_open() ) {
+			throw std::string("ERROR: cannot open file ") + inFileName + std::string(" in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if ( !std::getline(inFASTA, eachLine) || eachLine.empty() || (eachLine.front() != '>') ) {
+			throw std::string("ERROR: file ") + inFileName + std::string(" does not start with a FASTA header in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		std::string currentHeader = eachLine.substr(1);
+		std::string sequence;
+		while ( std::getline(inFASTA, eachLine) ) {
+			if ( !eachLine.empty() && (eachLine.front() == '>') ) {
+				fastaData.emplace(currentHeader, sequence);
+				currentHeader = eachLine.substr(1);
+				sequence.clear();
+				continue;
+			}
+			sequence.append(eachLine);
+		}
+		fastaData.emplace(currentHeader, sequence);
+		inFASTA.close();
+		return fastaData.size();
+	}
+
+	/** \brief Report throughput
+	 *
+	 * \param[in] label benchmark name
+	 * \param[in] nBytes number of bytes processed
+	 * \param[in] startTime start time
+	 */
+	void reportThroughput(const std::string &label, const size_t &nBytes, const std::chrono::steady_clock::time_point &startTime) {
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+		constexpr double bytesPerGB{1e9};
+		std::cout << label << ": " << elapsed.count() << " s, " << static_cast<double>(nBytes) / bytesPerGB / elapsed.count() << " GB/s\n";
+	}
+}
+
+int main(int argc, char *argv[]) {
+	const std::string cliHelp = "Usage: parseBenchmark [fasta_file]\n"
+		"  Times FASTA parsers on fasta_file, or on a synthetic file if none is given.\n";
+	if (argc > 2) {
+		std::cerr << cliHelp;
+		return 1;
+	}
+	const std::string argument{argc > 1 ? argv[1] : ""};
+	if ( (argument == "--help") || (argument == "-h") ) {
+		std::cout << cliHelp;
+		return 0;
+	}
+	if ( !argument.empty() && (argument.front() == '-') ) {
+		std::cerr << "ERROR: unknown flag " << argument << "\n" << cliHelp;
+		return 1;
+	}
+	try {
+		std::unique_ptr<BayesicSpace::ScratchDirectory> scratch;
+		std::string fastaFileName{argument};
+		if ( fastaFileName.empty() ) {
+			scratch       = std::unique_ptr<BayesicSpace::ScratchDirectory>( new BayesicSpace::ScratchDirectory("parseBenchmark") );
+			fastaFileName = scratch->path("parseBenchmark.fasta");
+			const BayesicSpace::SyntheticFastaParameters parameters;
+			BayesicSpace::writeSyntheticFasta(parameters, fastaFileName);
+		} else if ( !std::fstream(fastaFileName, std::ios::in).is_open() ) {
+			throw std::string("ERROR: cannot open file ") + fastaFileName;
+		}
+		const size_t nBytes = BayesicSpace::fileSize(fastaFileName);
+		std::cout << "File " << fastaFileName << ", " << nBytes << " bytes\n";
+
+		auto startTime = std::chrono::steady_clock::now();
+		const size_t nGetlineRecords = getlineParse(fastaFileName);
+		reportThroughput("getline parser (" + std::to_string(nGetlineRecords) + " records)", nBytes, startTime);
+
+		startTime = std::chrono::steady_clock::now();
+		const BayesicSpace::Fasta fastaData(fastaFileName);
+		reportThroughput("block scanner parser (" + std::to_string( fastaData.size() ) + " records)", nBytes, startTime);
+
+		// raw scanner speed over the mapped file, after the parse above has paged it in
+		const BayesicSpace::MappedFile mappedFasta(fastaFileName);
+		std::string stripped(mappedFasta.size(), '\0');
+		const std::vector<std::string> levelNames{"portable", "SSE2", "AVX2"};
+		for (const auto &eachLevel : {BayesicSpace::SimdLevel::portable, BayesicSpace::SimdLevel::sse2, BayesicSpace::SimdLevel::avx2}) {
+			const BayesicSpace::FastaScanner scanner(eachLevel);
+			if (scanner.simdLevel() != eachLevel) {
+				continue;
+			}
+			const std::string &levelName = levelNames.at( static_cast<size_t>(eachLevel) );
+			startTime = std::chrono::steady_clock::now();
+			size_t nRecords{0};
+			const char *recordStart = mappedFasta.data();
+			const char *fileEnd     = mappedFasta.data() + mappedFasta.size();
+			while (recordStart < fileEnd) {
+				recordStart = scanner.findRecordStart(recordStart, fileEnd);
+				++nRecords;
+			}
+			reportThroughput(levelName + " record search (" + std::to_string(nRecords) + " records)", nBytes, startTime);
+			startTime = std::chrono::steady_clock::now();
+			scanner.copyStripped(mappedFasta.data(), fileEnd, &stripped[0]);
+			reportThroughput(levelName + " line break removal", nBytes, startTime);
+			// sequences one record at a time, as in the parser, where lines of constant width take the fixed-width path
+			startTime   = std::chrono::steady_clock::now();
+			recordStart = mappedFasta.data();
+			char *destination = &stripped[0];
+			while (recordStart < fileEnd) {
+				const auto *headerEnd = static_cast<const char*>( std::memchr( recordStart, '\n', static_cast<size_t>(fileEnd - recordStart) ) );
+				if (headerEnd == nullptr) {
+					break;
+				}
+				const char *nextRecord = scanner.findRecordStart(headerEnd, fileEnd);
+				destination += scanner.copyStripped(headerEnd + 1, nextRecord, destination);
+				recordStart  = nextRecord;
+			}
+			reportThroughput(levelName + " sequence line break removal", nBytes, startTime);
+		}
+	} catch(std::string &problem) {
+		std::cerr << problem << "\n";
+		return 1;
+	} catch(const std::exception &problem) {
+		std::cerr << "ERROR: " << problem.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
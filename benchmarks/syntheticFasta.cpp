@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Synthetic FASTA generator
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of the deterministic synthetic FASTA generator used by the benchmarks.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <random>
+#include <algorithm>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include "syntheticFasta.hpp"
+
+using namespace BayesicSpace;
+
+std::string BayesicSpace::syntheticHeader(const SyntheticFastaParameters &parameters, const size_t &recordIndex) {
+	std::string header = "synthetic_" + std::to_string(recordIndex) + "_";
+	const std::string padding{"ABCDEFGHIJKLMNOPQRSTUVWXYZ"};
+	while (header.size() < parameters.headerLength) {
+		header.push_back(padding[header.size() % padding.size()]);
+	}
+	return header;
+}
+
+std::vector<std::string> BayesicSpace::syntheticSubset(const SyntheticFastaParameters &parameters) {
+	std::vector<std::string> subset;
+	// a record is chosen each time the running count of chosen records passes an integer
+	for (size_t iRecord = 0; iRecord < parameters.nRecords; ++iRecord) {
+		const auto chosenBefore = static_cast<uint64_t>(static_cast<double>(iRecord) * parameters.subsetFraction);
+		const auto chosenAfter  = static_cast<uint64_t>(static_cast<double>(iRecord + 1) * parameters.subsetFraction);
+		if (chosenAfter > chosenBefore) {
+			subset.push_back( syntheticHeader(parameters, iRecord) );
+		}
+	}
+	return subset;
+}
+
+void BayesicSpace::writeSyntheticFasta(const SyntheticFastaParameters &parameters, const std::string &outFileName) {
+	std::mt19937_64 generator(parameters.seed);
+	const std::string alphabet{"acgt"};
+	std::fstream outFASTA;
+	outFASTA.open(outFileName, std::ios::out | std::ios::trunc);
+	const size_t lineWidth = (parameters.lineWidth == 0 ? parameters.recordLength : parameters.lineWidth);
+	std::string sequence;
+	for (size_t iRecord = 0; iRecord < parameters.nRecords; ++iRecord) {
+		// each random number supplies 32 two-bit bases
+		sequence.clear();
+		uint64_t randomBits{0};
+		for (size_t iBase = 0; iBase < parameters.recordLength; ++iBase) {
+			constexpr size_t basesPerNumber{32};
+			if (iBase % basesPerNumber == 0) {
+				randomBits = generator();
+			}
+			sequence.push_back(alphabet[randomBits & 3]);
+			randomBits >>= 2;
+		}
+		outFASTA << ">" << syntheticHeader(parameters, iRecord) << "\n";
+		for (size_t lineStart = 0; lineStart < sequence.size(); lineStart += lineWidth) {
+			outFASTA.write(sequence.data() + lineStart, static_cast<std::streamsize>( std::min(lineWidth, sequence.size() - lineStart) ) );
+			outFASTA << "\n";
+		}
+	}
+	outFASTA.close();
+}
+
+void BayesicSpace::writeSyntheticSubset(const SyntheticFastaParameters &parameters, const std::string &outFileName) {
+	std::fstream outList;
+	outList.open(outFileName, std::ios::out | std::ios::trunc);
+	for ( const auto &eachHeader : syntheticSubset(parameters) ) {
+		outList << eachHeader << "\n";
+	}
+	outList.close();
+}
+
+ScratchDirectory::ScratchDirectory(const std::string &prefix) {
+	const char *tempRoot = std::getenv("TMPDIR");
+	std::string nameTemplate{ ( (tempRoot == nullptr) || (*tempRoot == '\0') ) ? std::string("/tmp") : std::string(tempRoot) };
+	nameTemplate += "/" + prefix + "XXXXXX";
+	if (mkdtemp(&nameTemplate[0]) == nullptr) {
+		throw std::string("ERROR: cannot create a temporary directory from ") + nameTemplate + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	directoryName_ = nameTemplate;
+}
+
+ScratchDirectory::~ScratchDirectory() {
+	DIR *directory = opendir( directoryName_.c_str() );
+	if (directory != nullptr) {
+		const dirent *entry{nullptr};
+		while ( ( entry = readdir(directory) ) != nullptr ) {
+			const std::string entryName{static_cast<const char*>(entry->d_name)};
+			if ( (entryName != ".") && (entryName != "..") ) {
+				std::remove( this->path(entryName).c_str() );
+			}
+		}
+		closedir(directory);
+	}
+	rmdir( directoryName_.c_str() );
+}
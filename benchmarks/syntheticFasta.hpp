@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Synthetic FASTA generator
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for the deterministic synthetic FASTA generator and the scratch directory used by the benchmarks.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BayesicSpace {
+	struct SyntheticFastaParameters;
+	class ScratchDirectory;
+
+	/** \brief Synthetic FASTA file parameters */
+	struct SyntheticFastaParameters {
+		/** \brief Number of records */
+		size_t nRecords{2000};
+		/** \brief Number of bases per record */
+		size_t recordLength{100000};
+		/** \brief Number of bases per line */
+		size_t lineWidth{80};
+		/** \brief Minimal number of header characters; headers are longer only if needed to keep them unique */
+		size_t headerLength{24};
+		/** \brief Fraction of records in the subset list */
+		double subsetFraction{0.1};
+		/** \brief Random number seed */
+		uint64_t seed{1983};
+	};
+
+	/** \brief Header of a synthetic record
+	 *
+	 * \param[in] parameters file parameters
+	 * \param[in] recordIndex record index
+	 * \return header without the leading '>'
+	 */
+	std::string syntheticHeader(const SyntheticFastaParameters &parameters, const size_t &recordIndex);
+	/** \brief Headers of the synthetic subset
+	 *
+	 * Records are chosen evenly spaced through the file.
+	 *
+	 * \param[in] parameters file parameters
+	 * \return subset headers in file order
+	 */
+	std::vector<std::string> syntheticSubset(const SyntheticFastaParameters &parameters);
+	/** \brief Write a synthetic FASTA file
+	 *
+	 * The same parameters always produce the same file.
+	 *
+	 * \param[in] parameters file parameters
+	 * \param[in] outFileName output FASTA file name
+	 */
+	void writeSyntheticFasta(const SyntheticFastaParameters &parameters, const std::string &outFileName);
+	/** \brief Write the synthetic subset header list
+	 *
+	 * \param[in] parameters file parameters
+	 * \param[in] outFileName output header list file name
+	 */
+	void writeSyntheticSubset(const SyntheticFastaParameters &parameters, const std::string &outFileName);
+
+	/** \brief Temporary directory for benchmark files
+	 *
+	 * Created under `TMPDIR` (or `/tmp`) and removed, with the files in it, when the object is destroyed.
+	 * Objects can be neither copied nor moved.
+	 */
+	class ScratchDirectory {
+	public:
+		/** \brief Constructor
+		 *
+		 * \param[in] prefix directory name prefix
+		 */
+		explicit ScratchDirectory(const std::string &prefix);
+		/** \brief Destructor
+		 *
+		 * Removes the files in the directory and then the directory. Errors are ignored.
+		 */
+		~ScratchDirectory();
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		ScratchDirectory(const ScratchDirectory &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		ScratchDirectory& operator=(const ScratchDirectory &toCopy) = delete;
+		/** \brief Move constructor (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 */
+		ScratchDirectory(ScratchDirectory &&toMove) = delete;
+		/** \brief Move assignment operator (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		ScratchDirectory& operator=(ScratchDirectory &&toMove) = delete;
+		/** \brief Path of a file in the directory
+		 *
+		 * \param[in] fileName file name
+		 * \return file path
+		 */
+		std::string path(const std::string &fileName) const {return directoryName_ + "/" + fileName;};
+	private:
+		/** \brief Directory name */
+		std::string directoryName_;
+	};
+}
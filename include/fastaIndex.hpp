@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// FASTA index for random access
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for `faidx`-compatible FASTA indexes and indexed record extraction.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+#include "inputStream.hpp"
+#include "fastaWriter.hpp"
+#include "headerIndex.hpp"
+
+namespace BayesicSpace {
+	struct FaidxEntry;
+	class FastaIndex;
+	class IndexedFasta;
+
+	/** \brief One line of a `.fai` index */
+	struct FaidxEntry {
+		/** \brief Record name (the first white space-delimited word of the header, as in `samtools`) */
+		std::string name;
+		/** \brief Sequence length in bases */
+		uint64_t length{0};
+		/** \brief Byte offset of the first base in the FASTA file */
+		uint64_t offset{0};
+		/** \brief Number of bases per line */
+		uint64_t lineBases{0};
+		/** \brief Number of bytes per line, including the line break */
+		uint64_t lineBytes{0};
+	};
+
+	/** \brief FASTA index
+	 *
+	 * Index in the `samtools faidx` format: a tab-delimited file with the name, length, offset, bases per line, and bytes per line of each record.
+	 * The index is stored next to the FASTA file, with `.fai` appended to the FASTA file name.
+	 * As in `samtools`, names are the first words of the headers, so indexes written by either tool can be used by the other.
+	 * Indexing requires all lines of a sequence, except the last, to have the same length.
+	 */
+	class FastaIndex {
+	public:
+		/** \brief Default constructor */
+		FastaIndex() = default;
+		/** \brief Constructor with FASTA file name
+		 *
+		 * Reads the `.fai` index if it exists and is newer than the FASTA file.
+		 * Otherwise, indexes the FASTA file and attempts to save the index; failure to save (e.g., in a read-only directory) is not an error.
+		 *
+		 * \param[in] fastaFileName FASTA file name
+		 */
+		FastaIndex(const std::string &fastaFileName);
+		/** \brief Constructor with index entries
+		 *
+		 * Used by writers that index their output as they write it. Names that are whole header lines are cut to their first word.
+		 *
+		 * \param[in] entries index entries in file order
+		 */
+		FastaIndex(std::vector<FaidxEntry> entries);
+		/** \brief Copy constructor 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaIndex(const FastaIndex &toCopy) = default;
+		/** \brief Copy assignment operator 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaIndex& operator=(const FastaIndex &toCopy) = default;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaIndex(FastaIndex &&toMove) = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaIndex& operator=(FastaIndex &&toMove) = default;
+		/** \brief Number of indexed records
+		 *
+		 * \return number of records
+		 */
+		size_t size() const {return entries_.size();};
+		/** \brief Find a record
+		 *
+		 * If a name occurs more than once, the first record is returned.
+		 *
+		 * \param[in] name record name
+		 * \return record index; equal to `size()` if the name is not found
+		 */
+		size_t find(const std::string &name) const;
+		/** \brief Index entry
+		 *
+		 * \param[in] recordIndex record index
+		 * \return index entry
+		 */
+		const FaidxEntry& entry(const size_t &recordIndex) const {return entries_.at(recordIndex);};
+		/** \brief Save the index
+		 *
+		 * If the file with the given name exists, it is overwritten.
+		 *
+		 * \param[in] indexFileName output index file name
+		 */
+		void save(const std::string &indexFileName) const;
+		/** \brief Is an index file up to date
+		 *
+		 * \param[in] fastaFileName FASTA file name
+		 * \param[in] indexFileName index file name
+		 * \return true if the index file exists and was modified no earlier than the FASTA file
+		 */
+		static bool isFresh(const std::string &fastaFileName, const std::string &indexFileName);
+	protected:
+		/** \brief Index entries in file order */
+		std::vector<FaidxEntry> entries_;
+		/** \brief Entry positions by name */
+		std::unordered_map<std::string, size_t> nameIndex_;
+		/** \brief Index a FASTA file
+		 *
+		 * \param[in] fastaFileName FASTA file name
+		 */
+		void build_(const std::string &fastaFileName);
+		/** \brief Read a `.fai` file
+		 *
+		 * \param[in] indexFileName index file name
+		 */
+		void load_(const std::string &indexFileName);
+	};
+
+	/** \brief Indexed FASTA file
+	 *
+	 * Extracts records and regions from a FASTA file by seeking to their positions with `pread` according to a `FastaIndex`.
+	 * Only the requested bytes are read. BGZF-compressed files are also supported: only the blocks that hold the requested bytes,
+	 * located with a `.gzi` index, are decompressed. Objects can be moved but not copied.
+	 */
+	class IndexedFasta {
+	public:
+		/** \brief Default constructor */
+		IndexedFasta() = default;
+		/** \brief Constructor with FASTA file name
+		 *
+		 * Opens the FASTA file and reads or builds its index. Plain gzip files cannot be indexed and cause an error.
+		 *
+		 * \param[in] fastaFileName FASTA file name
+		 */
+		IndexedFasta(const std::string &fastaFileName);
+		/** \brief Destructor */
+		~IndexedFasta();
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		IndexedFasta(const IndexedFasta &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		IndexedFasta& operator=(const IndexedFasta &toCopy) = delete;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 */
+		IndexedFasta(IndexedFasta &&toMove) noexcept;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		IndexedFasta& operator=(IndexedFasta &&toMove) noexcept;
+		/** \brief Number of records
+		 *
+		 * \return number of FASTA sequences in the file
+		 */
+		size_t size() const {return index_.size();};
+		/** \brief Extract a region
+		 *
+		 * Coordinates are one-based and inclusive, as in `samtools faidx`. The end is truncated to the sequence length.
+		 * The record can be named by its indexed name or by its whole header line.
+		 *
+		 * \param[in] name record name or header
+		 * \param[in] start first base
+		 * \param[in] end last base
+		 * \return region sequence; empty if the name is not found or the region is outside the sequence
+		 */
+		std::string region(const std::string &name, const uint64_t &start, const uint64_t &end) const;
+		/** \brief Extract a record or region
+		 *
+		 * The request is a record name or a region in the `name:start-end` or `name:start` format.
+		 * Names that are present in the index are always treated as whole records, even if they contain ':'.
+		 * A whole header line also names its record: its first word is looked up in the index, and the header of the record found is read to confirm the match.
+		 *
+		 * \param[in] request record name or region
+		 * \param[out] sequence extracted sequence
+		 * \return true if the request matches an indexed record and, for a region, the region starts within the sequence
+		 */
+		bool fetch(const std::string &request, std::string &sequence) const;
+		/** \brief Subset the records 
+		 *
+		 * Return a subset of FASTA records or regions according to a vector of requests.
+		 * Regions are keyed by the request string, so they are saved with `name:start-end` headers.
+		 *
+		 * \param[in] requestList vector of FASTA headers or regions to extract
+		 * \return record subset
+		 */
+		std::unordered_map<std::string, std::string> subset(const std::vector<std::string> &requestList) const;
+		/** \brief Subset the records from file 
+		 *
+		 * Return a subset of FASTA records or regions according to the list in the provided file.
+		 *
+		 * \param[in] requestFileName name of the file with FASTA headers or regions to extract
+		 * \return record subset
+		 */
+		std::unordered_map<std::string, std::string> subset(const std::string &requestFileName) const;
+		/** \brief Subset the records in a set order
+		 *
+		 * Return a subset of FASTA records or regions according to a vector of requests, in input file or request list order.
+		 * In input file order, regions of the same record keep their list order. Repeated requests are included once.
+		 *
+		 * \param[in] requestList vector of FASTA headers or regions to extract
+		 * \param[in] order record order
+		 * \return request and sequence pairs
+		 */
+		std::vector< std::pair<std::string, std::string> > orderedSubset(const std::vector<std::string> &requestList, const RecordOrder &order) const;
+		/** \brief Subset the records from file in a set order
+		 *
+		 * \param[in] requestFileName name of the file with FASTA headers or regions to extract
+		 * \param[in] order record order
+		 * \return request and sequence pairs
+		 */
+		std::vector< std::pair<std::string, std::string> > orderedSubset(const std::string &requestFileName, const RecordOrder &order) const;
+		/** \brief Build the secondary header index
+		 *
+		 * Needed for accession and prefix matching in `matchHeaders()`.
+		 */
+		void buildHeaderIndex();
+		/** \brief Expand a list of queries into record names
+		 *
+		 * Whole-name queries (including regions) are returned unchanged. Accession and prefix queries require the secondary index
+		 * (see `buildHeaderIndex()`) and are replaced by the names of the records they match, in file order for each query.
+		 *
+		 * \param[in] queries whole names, accessions, or name prefixes
+		 * \param[in] match how the queries are matched
+		 * \return requests to pass to `subset()` or `orderedSubset()`
+		 */
+		std::vector<std::string> matchHeaders(const std::vector<std::string> &queries, const HeaderMatch &match) const;
+	private:
+		/** \brief FASTA file descriptor */
+		int fastaDescriptor_{-1};
+		/** \brief FASTA index */
+		FastaIndex index_;
+		/** \brief BGZF reader, used instead of the file descriptor for compressed files */
+		BgzfReader bgzfReader_;
+		/** \brief Secondary header index; empty unless built on request */
+		HeaderIndex headerIndex_;
+		/** \brief Read bases from an indexed record
+		 *
+		 * \param[in] record index entry
+		 * \param[in] firstBase zero-based position of the first base
+		 * \param[in] lastBase zero-based position one past the last base
+		 * \return sequence with line breaks removed
+		 */
+		std::string readBases_(const FaidxEntry &record, const uint64_t &firstBase, const uint64_t &lastBase) const;
+		/** \brief Find a record by name or header
+		 *
+		 * \param[in] name indexed record name or whole header line
+		 * \return record index; the number of records if there is no match
+		 */
+		size_t find_(const std::string &name) const;
+		/** \brief Read the header of a record
+		 *
+		 * The header line lies between the end of the previous sequence and the start of this one.
+		 *
+		 * \param[in] recordIndex record index
+		 * \return header without the leading '>'
+		 */
+		std::string header_(const size_t &recordIndex) const;
+		/** \brief Read bytes from the FASTA file
+		 *
+		 * \param[in] byteStart offset of the first byte (uncompressed for BGZF files)
+		 * \param[in] nBytes number of bytes
+		 * \return bytes read; fewer than `nBytes` at the end of the file
+		 */
+		std::string readBytes_(const uint64_t &byteStart, const uint64_t &nBytes) const;
+		/** \brief Index of the record a request refers to
+		 *
+		 * \param[in] request record name or region
+		 * \return record index; the number of records if there is no match
+		 */
+		size_t recordIndex_(const std::string &request) const;
+	};
+}
@@ -30,16 +30,34 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
+#include <utility>
+#include <memory>
+#include <array>
+
+#include "mappedFile.hpp"
+#include "packedSequence.hpp"
+#include "fastaWriter.hpp"
+#include "headerIndex.hpp"
+#include "headerSet.hpp"
+#include "runStatistics.hpp"
 
 namespace BayesicSpace {
 	class Fasta;
+	class FastaFilter;
+	class FastaDemultiplexer;
+	class MappedFasta;
 
 	/** \brief Fasta file data
 	 *
 	 * Data read from a FASTA multi-sequence file. Sequence portions can be on multiple lines and do not have to be the same length for each sequence.
+	 * Both `\n` and `\r\n` line endings are accepted; line breaks are not included in headers or sequences.
+	 * Sequences are stored back to back in one contiguous buffer (the arena), with a table of their positions in input file order.
+	 * Records are addressed by their index in this order, and subsets can be taken as index lists that view the data without copying.
+	 * The arena is never modified after loading, so copies of an object share it.
 	 */
 	class Fasta {
 	public:
@@ -47,11 +65,44 @@ namespace BayesicSpace {
 		Fasta() = default;
 		/** \brief Constructor with input file name 
 		 *
-		 * Takes the input file name and reads the data.
+		 * Takes the input file name and reads the data on one thread.
 		 *
 		 * \param[in] inFileName input FASTA file name
 		 */
 		Fasta(const std::string &inFileName);
+		/** \brief Multithreaded constructor with input file name 
+		 *
+		 * Maps the input file into memory, splits it into byte ranges aligned to record starts, and parses the ranges in parallel.
+		 * The result is identical to that of the single-threaded constructor.
+		 * gzip and BGZF-compressed files are first decompressed into memory, BGZF blocks on `nThreads` threads.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of threads
+		 */
+		Fasta(const std::string &inFileName, const size_t &nThreads);
+		/** \brief Multithreaded constructor with optional sequence packing
+		 *
+		 * If `packSequences` is true, sequences are stored with two bits per A, C, G, or T base (see `PackedSequence`) and unpacked only when returned.
+		 * Each sequence is packed as soon as it is parsed, so the whole file is never held unpacked.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of threads
+		 * \param[in] packSequences store packed sequences
+		 */
+		Fasta(const std::string &inFileName, const size_t &nThreads, const bool &packSequences);
+		/** \brief Multithreaded constructor with optional packing and snapshot cache
+		 *
+		 * If `useSnapshot` is true and sequences are not packed, a binary snapshot of the parsed records (see `snapshotFileName()`) is used as a cache.
+		 * If the snapshot matches the input file, it is memory-mapped and the sequences are used in place, so only the header table is read;
+		 * otherwise the input is parsed and the snapshot is (re)written. A snapshot that cannot be written is skipped.
+		 * A current snapshot with headers or sequences outside the file is reported as an error.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of threads
+		 * \param[in] packSequences store packed sequences
+		 * \param[in] useSnapshot load from, and save to, a snapshot file
+		 */
+		Fasta(const std::string &inFileName, const size_t &nThreads, const bool &packSequences, const bool &useSnapshot);
 		/** \brief Copy constructor 
 		 *
 		 * \param[in] toCopy object to copy
@@ -77,10 +128,589 @@ namespace BayesicSpace {
 		 */
 		Fasta& operator=(Fasta &&toMove) = default;
 		/** \brief Number of input records
+		 *
+		 * Records with duplicate headers are counted once.
 		 *
 		 * return number of FASTA sequences in input
 		 */
-		size_t size() const {return fastaData_.size();};
+		size_t size() const {return recordOrder_.size();};
+		/** \brief Snapshot file name
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \return name of the snapshot file kept next to the input file
+		 */
+		static std::string snapshotFileName(const std::string &inFileName) {return inFileName + ".fsnap";};
+		/** \brief Is the snapshot current
+		 *
+		 * A snapshot is current if it has the present format version and was made from a file with the same size, modification time,
+		 * and checksum of its first and last bytes as the input file.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \return true if the snapshot of the input file exists and is current
+		 */
+		static bool snapshotIsCurrent(const std::string &inFileName);
+		/** \brief Record table load factor
+		 *
+		 * \return load factor of the hash table that indexes the records
+		 */
+		float loadFactor() const {return recordIndex_.load_factor();};
+		/** \brief Are sequences packed
+		 *
+		 * \return true if sequences are stored packed
+		 */
+		bool isPacked() const {return !packedSequences_.empty();};
+		/** \brief Find a record
+		 *
+		 * \param[in] header FASTA header without the leading '>'
+		 * \return record index; equal to `size()` if the header is not found
+		 */
+		size_t find(const std::string &header) const;
+		/** \brief Record header
+		 *
+		 * \param[in] recordIndex record index
+		 * \return view of the header, without the leading '>'
+		 */
+		CharView header(const size_t &recordIndex) const;
+		/** \brief Sequence view
+		 *
+		 * Zero-copy access to a sequence in the arena. Throws if sequences are packed.
+		 *
+		 * \param[in] recordIndex record index
+		 * \return view of the sequence
+		 */
+		CharView sequenceView(const size_t &recordIndex) const;
+		/** \brief Record sequence
+		 *
+		 * Returns a copy of the sequence, unpacked if necessary.
+		 *
+		 * \param[in] recordIndex record index
+		 * \return sequence
+		 */
+		std::string sequence(const size_t &recordIndex) const;
+		/** \brief Subset record indexes in a set order
+		 *
+		 * Finds the records listed in a vector of headers without copying them. Each record is included once, even if its header is listed several times.
+		 * The indexes can be passed to `header()`, `sequenceView()`, or `saveAsFASTA()`.
+		 *
+		 * \param[in] headerList vector of FASTA headers to extract
+		 * \param[in] order record order
+		 * \return record indexes
+		 */
+		std::vector<size_t> subsetIndexes(const std::vector<std::string> &headerList, const RecordOrder &order) const;
+		/** \brief Subset record indexes from a header set
+		 *
+		 * As the vector version, but takes a compact header set, which scales better to lists with millions of entries.
+		 * In input order, if the set is larger than the file, each record is looked up in the set rather than each set entry in the records.
+		 *
+		 * \param[in] headerSet set of FASTA headers to extract
+		 * \param[in] order record order
+		 * \return record indexes
+		 */
+		std::vector<size_t> subsetIndexes(const HeaderSet &headerSet, const RecordOrder &order) const;
+		/** \brief Subset the records 
+		 *
+		 * Return a subset of FASTA records according to a vector of headers.
+		 * The sequences are copied; use `subsetIndexes()` to avoid this.
+		 *
+		 * \param[in] headerList vector of FASTA headers to extract
+		 * \return record subset
+		 */
+		std::unordered_map<std::string, std::string> subset(const std::vector<std::string> &headerList) const;
+		/** \brief Subset the records from file 
+		 *
+		 * Return a subset of FASTA records according to the list in the provided file.
+		 * The list is loaded into a `HeaderSet`.
+		 *
+		 * \param[in] headerFileName name of the file with FASTA headers to extract
+		 * \return record subset
+		 */
+		std::unordered_map<std::string, std::string> subset(const std::string &headerFileName) const;
+		/** \brief Subset the records in a set order
+		 *
+		 * Return a subset of FASTA records according to a vector of headers, in input file or header list order.
+		 * Each record is included once, even if its header is listed several times. The sequences are copied; use `subsetIndexes()` to avoid this.
+		 *
+		 * \param[in] headerList vector of FASTA headers to extract
+		 * \param[in] order record order
+		 * \return header and sequence pairs
+		 */
+		std::vector< std::pair<std::string, std::string> > orderedSubset(const std::vector<std::string> &headerList, const RecordOrder &order) const;
+		/** \brief Subset the records from file in a set order
+		 *
+		 * Return a subset of FASTA records according to the list in the provided file, in input file or header list order.
+		 *
+		 * \param[in] headerFileName name of the file with FASTA headers to extract
+		 * \param[in] order record order
+		 * \return header and sequence pairs
+		 */
+		std::vector< std::pair<std::string, std::string> > orderedSubset(const std::string &headerFileName, const RecordOrder &order) const;
+		/** \brief Build the secondary header index
+		 *
+		 * Needed for accession and prefix matching in `matchHeaders()`.
+		 */
+		void buildHeaderIndex() {headerIndex_ = HeaderIndex(recordOrder_);};
+		/** \brief Expand a list of queries into headers
+		 *
+		 * Whole-header queries are returned unchanged. Accession and prefix queries require the secondary index (see `buildHeaderIndex()`)
+		 * and are replaced by the headers they match, in input file order for each query.
+		 *
+		 * \param[in] queries whole headers, accessions, or header prefixes
+		 * \param[in] match how the queries are matched
+		 * \return headers to pass to `subset()` or `orderedSubset()`
+		 */
+		std::vector<std::string> matchHeaders(const std::vector<std::string> &queries, const HeaderMatch &match) const;
+	protected:
+		/** \brief Sequence position in the arena */
+		struct SequenceSpan {
+			/** \brief Offset of the first byte */
+			size_t offset{0};
+			/** \brief Number of bytes */
+			size_t length{0};
+		};
+		/** \brief Headers in input file order, without duplicates */
+		std::vector<std::string> recordOrder_;
+		/** \brief Header to record index map */
+		std::unordered_map<std::string, size_t> recordIndex_;
+		/** \brief Sequences of all records, back to back; owned by the object or part of a mapped snapshot */
+		std::shared_ptr<const char> sequenceArena_;
+		/** \brief True if the arena is part of a mapped snapshot, so sequence bytes are read only when viewed */
+		bool snapshotArena_{false};
+		/** \brief Sequence positions in the arena, in record order */
+		std::vector<SequenceSpan> sequenceSpans_;
+		/** \brief Packed sequences in record order, used instead of the arena if packing is requested */
+		std::vector<PackedSequence> packedSequences_;
+		/** \brief Secondary header index; empty unless built on request */
+		HeaderIndex headerIndex_;
+		/** \brief Load records from a file
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of threads
+		 * \param[in] packSequences store packed sequences
+		 */
+		void loadFile_(const std::string &inFileName, const size_t &nThreads, const bool &packSequences);
+		/** \brief Load records from a snapshot
+		 *
+		 * Throws if a header or sequence of a current snapshot lies outside the mapped file.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \return false if there is no current snapshot
+		 */
+		bool loadSnapshot_(const std::string &inFileName);
+		/** \brief Save records to a snapshot
+		 *
+		 * Written to a temporary file that is then renamed, so that a partial snapshot is never read.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] sourceStamp source file stamp taken before parsing
+		 */
+		void saveSnapshot_(const std::string &inFileName, const std::array<uint64_t, 4> &sourceStamp) const;
+		/** \brief Parse a range of FASTA file bytes
+		 *
+		 * The range must start at the beginning of a header line. Lines are handled exactly as in the single-threaded constructor.
+		 * Each record is passed to `storeRecord`, a callable that takes the header, the scanner, and pointers to the start and one past the end
+		 * of the sequence bytes (with line breaks).
+		 *
+		 * \tparam RecordSinkT record storage callable type
+		 * \param[in] rangeStart pointer to the first byte
+		 * \param[in] rangeEnd pointer to one past the last byte
+		 * \param[in,out] storeRecord record storage callable
+		 */
+		template <typename RecordSinkT>
+		static void parseRange_(const char *rangeStart, const char *rangeEnd, RecordSinkT &storeRecord);
+	};
+
+	/** \brief Streaming FASTA record filter
+	 *
+	 * Extracts records from a FASTA file in a single pass, without loading the whole file.
+	 * Only the header list and the record currently being read are kept in memory, so memory use is bounded by the largest matching record.
+	 * The file is read ahead and the output written on separate threads, through fixed sets of recycled buffers, so input and output overlap with parsing.
+	 * By default, records are written in the order they appear in the input file. If a header occurs more than once, only the first record is written.
+	 */
+	class FastaFilter {
+	public:
+		/** \brief Default constructor */
+		FastaFilter() = default;
+		/** \brief Constructor with a header vector
+		 *
+		 * \param[in] headerList vector of FASTA headers to extract
+		 */
+		FastaFilter(const std::vector<std::string> &headerList);
+		/** \brief Constructor with a header list file
+		 *
+		 * The file must have one header per line, with or without the leading '>'.
+		 *
+		 * \param[in] headerFileName name of the file with FASTA headers to extract
+		 */
+		FastaFilter(const std::string &headerFileName);
+		/** \brief Constructor with a header vector and match type
+		 *
+		 * \param[in] headerList vector of whole headers, accessions, or header prefixes to extract
+		 * \param[in] match how list entries are matched to headers
+		 */
+		FastaFilter(const std::vector<std::string> &headerList, const HeaderMatch &match);
+		/** \brief Constructor with a header list file and match type
+		 *
+		 * The file must have one entry per line, with or without the leading '>'.
+		 *
+		 * \param[in] headerFileName name of the file with whole headers, accessions, or header prefixes to extract
+		 * \param[in] match how list entries are matched to headers
+		 */
+		FastaFilter(const std::string &headerFileName, const HeaderMatch &match);
+		/** \brief Copy constructor 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaFilter(const FastaFilter &toCopy) = default;
+		/** \brief Copy assignment operator 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaFilter& operator=(const FastaFilter &toCopy) = default;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaFilter(FastaFilter &&toMove) = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaFilter& operator=(FastaFilter &&toMove) = default;
+		/** \brief Number of headers to extract
+		 *
+		 * \return number of unique headers in the list
+		 */
+		size_t size() const {return headers_.size();};
+		/** \brief Filter a FASTA file
+		 *
+		 * Scans the input FASTA file once and writes each record with a listed header to the output file as soon as it is read.
+		 * If the output file exists, it is overwritten; throws if it is the input file.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] outFileName output FASTA file name
+		 * \return number of records written
+		 */
+		size_t filter(const std::string &inFileName, const std::string &outFileName) const {return this->filter(inFileName, outFileName, 1);};
+		/** \brief Filter a possibly compressed FASTA file
+		 *
+		 * As the two-argument version, but BGZF-compressed input is decompressed on `nThreads` threads.
+		 * gzip input is decompressed on the calling thread.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] outFileName output FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 * \return number of records written
+		 */
+		size_t filter(const std::string &inFileName, const std::string &outFileName, const size_t &nThreads) const {
+			return this->filter(inFileName, outFileName, nThreads, RecordOrder::input, 0);
+		};
+		/** \brief Filter a FASTA file with output options
+		 *
+		 * In input order, records are written as soon as they are read. In header list order, matching records are held in memory
+		 * until the input file is exhausted; records matched by the same list entry are then in input order.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] outFileName output FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 * \param[in] order output record order
+		 * \param[in] lineWidth maximal number of sequence characters per output line; 0 puts each sequence on one line
+		 * \return number of records written
+		 */
+		size_t filter(const std::string &inFileName, const std::string &outFileName, const size_t &nThreads, const RecordOrder &order, const size_t &lineWidth) const {
+			RunStatistics noStatistics;
+			return this->filter(inFileName, outFileName, nThreads, order, lineWidth, noStatistics);
+		};
+		/** \brief Filter a FASTA file and record statistics
+		 *
+		 * As the five-argument version, but also adds the numbers of records parsed and matched to `statistics`
+		 * and records the load factor of the header table. Counts are accumulated locally, so a disabled `statistics` object costs nothing per record.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] outFileName output FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 * \param[in] order output record order
+		 * \param[in] lineWidth maximal number of sequence characters per output line; 0 puts each sequence on one line
+		 * \param[in,out] statistics run statistics
+		 * \return number of records written
+		 */
+		size_t filter(const std::string &inFileName, const std::string &outFileName, const size_t &nThreads, const RecordOrder &order, const size_t &lineWidth,
+						RunStatistics &statistics) const {
+			return this->filter(inFileName, outFileName, nThreads, order, OutputFormat{lineWidth}, statistics);
+		};
+		/** \brief Filter a FASTA file into a given output format
+		 *
+		 * As the line width version, but the output may be BGZF-compressed on `format.nThreads` threads and indexed (see `FastaWriter`).
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] outFileName output FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 * \param[in] order output record order
+		 * \param[in] format output format
+		 * \param[in,out] statistics run statistics
+		 * \return number of records written
+		 */
+		size_t filter(const std::string &inFileName, const std::string &outFileName, const size_t &nThreads, const RecordOrder &order, const OutputFormat &format,
+						RunStatistics &statistics) const;
+		/** \brief Filter several FASTA files
+		 *
+		 * Filters a set of FASTA shards (e.g., one file per chromosome) concurrently. Shards are handed out to `nThreads` threads largest first,
+		 * and a thread that finishes a shard takes the next one, so all threads stay busy until the last shards.
+		 * With one output file, matches from all shards are merged: records are in input list order of the shards and then in input order within each shard
+		 * (or in header list order if requested, ties kept in the same shard order), and a header found in several shards is written once,
+		 * from the first shard that has it. In input order, the matches of each shard are written once all earlier shards are written, and then freed;
+		 * in header list order, matching records are held in memory until all shards are read.
+		 * With one output file per shard, each shard is filtered to its own file as by `filter()`, and duplicates across shards are kept.
+		 * Output file names must be distinct, and no output may be one of the input files.
+		 *
+		 * \param[in] inFileNames input FASTA file names
+		 * \param[in] outFileNames output FASTA file name, or one name per input file
+		 * \param[in] nThreads number of threads
+		 * \param[in] order output record order
+		 * \param[in] lineWidth maximal number of sequence characters per output line; 0 puts each sequence on one line
+		 * \param[in,out] statistics run statistics
+		 * \return number of records written
+		 */
+		size_t filterShards(const std::vector<std::string> &inFileNames, const std::vector<std::string> &outFileNames, const size_t &nThreads,
+						const RecordOrder &order, const size_t &lineWidth, RunStatistics &statistics) const {
+			return this->filterShards(inFileNames, outFileNames, nThreads, order, OutputFormat{lineWidth}, statistics);
+		};
+		/** \brief Filter several FASTA files into a given output format
+		 *
+		 * As the line width version, but the output may be BGZF-compressed and indexed (see `FastaWriter`).
+		 * A merged output is compressed on `format.nThreads` threads; per-shard outputs, already written concurrently, are each compressed on one thread.
+		 *
+		 * \param[in] inFileNames input FASTA file names
+		 * \param[in] outFileNames output FASTA file name, or one name per input file
+		 * \param[in] nThreads number of threads
+		 * \param[in] order output record order
+		 * \param[in] format output format
+		 * \param[in,out] statistics run statistics
+		 * \return number of records written
+		 */
+		size_t filterShards(const std::vector<std::string> &inFileNames, const std::vector<std::string> &outFileNames, const size_t &nThreads,
+						const RecordOrder &order, const OutputFormat &format, RunStatistics &statistics) const;
+		/** \brief Filter several FASTA files without statistics
+		 *
+		 * \param[in] inFileNames input FASTA file names
+		 * \param[in] outFileNames output FASTA file name, or one name per input file
+		 * \param[in] nThreads number of threads
+		 * \param[in] order output record order
+		 * \param[in] lineWidth maximal number of sequence characters per output line; 0 puts each sequence on one line
+		 * \return number of records written
+		 */
+		size_t filterShards(const std::vector<std::string> &inFileNames, const std::vector<std::string> &outFileNames, const size_t &nThreads,
+						const RecordOrder &order, const size_t &lineWidth) const {
+			RunStatistics noStatistics;
+			return this->filterShards(inFileNames, outFileNames, nThreads, order, lineWidth, noStatistics);
+		};
+	protected:
+		/** \brief Headers to extract, at the positions of their first occurrence in the list */
+		HeaderSet headers_;
+		/** \brief How list entries are matched to headers */
+		HeaderMatch match_{HeaderMatch::whole};
+		/** \brief Distinct list entry lengths, used for prefix matching */
+		std::vector<size_t> prefixLengths_;
+		/** \brief List position of the first entry that matches a header
+		 *
+		 * \param[in] header FASTA header
+		 * \return list position; the number of list entries if there is no match
+		 */
+		size_t listPosition_(const std::string &header) const;
+		/** \brief Find the distinct entry lengths for prefix matching */
+		void findPrefixLengths_();
+	};
+
+	/** \brief Streaming FASTA record router
+	 *
+	 * Distributes records from one FASTA file among several output files in a single pass.
+	 * Each output has its own header list, and a record is written to every output whose list contains its header.
+	 * Records are written in input file order by a separate thread, so writing overlaps with reading.
+	 * If a header occurs more than once in the input file, only the first record is written.
+	 */
+	class FastaDemultiplexer {
+	public:
+		/** \brief Default constructor */
+		FastaDemultiplexer() = default;
+		/** \brief Constructor with header list and output file name pairs
+		 *
+		 * Header list files must have one header per line, with or without the leading '>'.
+		 *
+		 * \param[in] listOutputPairs header list file and output FASTA file name pairs
+		 */
+		FastaDemultiplexer(const std::vector< std::pair<std::string, std::string> > &listOutputPairs);
+		/** \brief Constructor with a manifest file
+		 *
+		 * Each non-empty line of the manifest has a header list file name and an output FASTA file name, separated by white space.
+		 *
+		 * \param[in] manifestFileName manifest file name
+		 */
+		FastaDemultiplexer(const std::string &manifestFileName);
+		/** \brief Copy constructor 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaDemultiplexer(const FastaDemultiplexer &toCopy) = default;
+		/** \brief Copy assignment operator 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaDemultiplexer& operator=(const FastaDemultiplexer &toCopy) = default;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaDemultiplexer(FastaDemultiplexer &&toMove) = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaDemultiplexer& operator=(FastaDemultiplexer &&toMove) = default;
+		/** \brief Number of outputs
+		 *
+		 * \return number of output files
+		 */
+		size_t size() const {return outFileNames_.size();};
+		/** \brief Route records to outputs
+		 *
+		 * Scans the input FASTA file once. All output files are created, even if no records are routed to them. Throws if an output is the input file.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 * \param[in] lineWidth maximal number of sequence characters per output line; 0 puts each sequence on one line
+		 * \return number of records written to each output, in manifest order
+		 */
+		std::vector<size_t> demultiplex(const std::string &inFileName, const size_t &nThreads, const size_t &lineWidth) const {
+			RunStatistics noStatistics;
+			return this->demultiplex(inFileName, nThreads, lineWidth, noStatistics);
+		};
+		/** \brief Route records to outputs and record statistics
+		 *
+		 * As the three-argument version, but also adds the numbers of records parsed and matched to `statistics`
+		 * and records the load factor of the header table.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 * \param[in] lineWidth maximal number of sequence characters per output line; 0 puts each sequence on one line
+		 * \param[in,out] statistics run statistics
+		 * \return number of records written to each output, in manifest order
+		 */
+		std::vector<size_t> demultiplex(const std::string &inFileName, const size_t &nThreads, const size_t &lineWidth, RunStatistics &statistics) const;
+		/** \brief Number of distinct headers
+		 *
+		 * \return number of distinct headers across all header lists
+		 */
+		size_t nHeaders() const {return headerDestinations_.size();};
+		/** \brief Output file names
+		 *
+		 * \return output file names, in manifest order
+		 */
+		const std::vector<std::string>& outFileNames() const {return outFileNames_;};
+	protected:
+		/** \brief Output file names */
+		std::vector<std::string> outFileNames_;
+		/** \brief Headers to extract, with the index of their destination list */
+		std::unordered_map<std::string, size_t> headerDestinations_;
+		/** \brief Output indexes for each header, without duplicates */
+		std::vector< std::vector<size_t> > destinations_;
+		/** \brief Add an output
+		 *
+		 * Throws if the output file is already an output.
+		 *
+		 * \param[in] headerFileName name of the file with FASTA headers to extract
+		 * \param[in] outFileName output FASTA file name
+		 */
+		void addOutput_(const std::string &headerFileName, const std::string &outFileName);
+	};
+
+	/** \brief Memory-mapped FASTA file data
+	 *
+	 * Read-only FASTA data backed by a memory-mapped file. Only the offsets of headers and sequences are stored.
+	 * Headers and single-line sequences are served as views into the mapped file without copying.
+	 * Sequences that span several lines are stitched together only when requested.
+	 * Objects can be moved but not copied, and views are valid only while the object is alive.
+	 */
+	class MappedFasta {
+	public:
+		/** \brief Default constructor */
+		MappedFasta() = default;
+		/** \brief Constructor with input file name 
+		 *
+		 * Maps the input file and indexes record positions.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 */
+		MappedFasta(const std::string &inFileName);
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		MappedFasta(const MappedFasta &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		MappedFasta& operator=(const MappedFasta &toCopy) = delete;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 */
+		MappedFasta(MappedFasta &&toMove) = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		MappedFasta& operator=(MappedFasta &&toMove) = default;
+		/** \brief Number of input records
+		 *
+		 * Records with duplicate headers are counted separately, but only the first can be found by header.
+		 *
+		 * \return number of FASTA sequences in input
+		 */
+		size_t size() const {return records_.size();};
+		/** \brief Find a record
+		 *
+		 * \param[in] header FASTA header without the leading '>'
+		 * \return record index; equal to `size()` if the header is not found
+		 */
+		size_t find(const std::string &header) const;
+		/** \brief Record header
+		 *
+		 * \param[in] recordIndex record index
+		 * \return view of the header, without the leading '>'
+		 */
+		CharView header(const size_t &recordIndex) const;
+		/** \brief Is the sequence on a single line
+		 *
+		 * \param[in] recordIndex record index
+		 * \return true if the sequence has no internal line breaks
+		 */
+		bool isSingleLine(const size_t &recordIndex) const {return records_.at(recordIndex).nLines <= 1;};
+		/** \brief Single-line sequence view
+		 *
+		 * Zero-copy access to a sequence that is on a single line. Throws if the sequence spans several lines.
+		 *
+		 * \param[in] recordIndex record index
+		 * \return view of the sequence
+		 */
+		CharView sequenceView(const size_t &recordIndex) const;
+		/** \brief Record sequence
+		 *
+		 * Returns a copy of the sequence with line breaks removed.
+		 *
+		 * \param[in] recordIndex record index
+		 * \return sequence
+		 */
+		std::string sequence(const size_t &recordIndex) const;
 		/** \brief Subset the records 
 		 *
 		 * Return a subset of FASTA records according to a vector of headers.
@@ -98,6 +728,24 @@ namespace BayesicSpace {
 		 */
 		std::unordered_map<std::string, std::string> subset(const std::string &headerFileName) const;
 	protected:
-		std::unordered_map<std::string, std::string> fastaData_;
+		/** \brief Record position in the mapped file */
+		struct MappedRecord {
+			/** \brief Header start (after '>') */
+			size_t headerStart{0};
+			/** \brief Header length */
+			size_t headerLength{0};
+			/** \brief Sequence start */
+			size_t sequenceStart{0};
+			/** \brief One past the last sequence byte, not including the final line break */
+			size_t sequenceEnd{0};
+			/** \brief Number of sequence lines */
+			size_t nLines{0};
+		};
+		/** \brief Mapped FASTA file */
+		MappedFile fastaFile_;
+		/** \brief Record positions in file order */
+		std::vector<MappedRecord> records_;
+		/** \brief Header views indexing records */
+		std::unordered_map<CharView, size_t, CharViewHash> headerIndex_;
 	};
 }
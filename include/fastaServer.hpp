@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Resident FASTA server
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for the server that keeps FASTA files in memory and its client.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "fastaObj.hpp"
+#include "fastaWriter.hpp"
+#include "headerIndex.hpp"
+
+namespace BayesicSpace {
+	struct SubsetRequest;
+	class FastaServer;
+
+	/** \brief Subset request sent to a `FastaServer`
+	 *
+	 * On the wire, a request is a line with the tab-separated FASTA name, record order (`input` or `list`), match type (`whole`, `accession`, or `prefix`),
+	 * and line width, followed by one header per line. The client then shuts down its side of the connection.
+	 * The server answers with FASTA records, or with a line that starts with `ERROR:`, and closes the connection.
+	 */
+	struct SubsetRequest {
+		/** \brief FASTA file name as given to the server; empty for the first file */
+		std::string fastaName;
+		/** \brief Headers, accessions, or header prefixes to extract */
+		std::vector<std::string> headers;
+		/** \brief Output record order */
+		RecordOrder order{RecordOrder::input};
+		/** \brief How headers are matched */
+		HeaderMatch match{HeaderMatch::whole};
+		/** \brief Maximal number of sequence characters per line; 0 puts each sequence on one line */
+		size_t lineWidth{0};
+	};
+
+	/** \brief Send a subset request to a server
+	 *
+	 * Connects to a `FastaServer` listening on a Unix domain socket and saves the records it returns as they arrive.
+	 * If the output file exists, it is overwritten. Server errors are thrown.
+	 *
+	 * \param[in] socketPath server socket path
+	 * \param[in] request subset request
+	 * \param[in] outFileName output FASTA file name
+	 * \return number of bytes received
+	 */
+	size_t requestSubset(const std::string &socketPath, const SubsetRequest &request, const std::string &outFileName);
+
+	/** \brief Resident FASTA server
+	 *
+	 * Loads FASTA files once and answers subset requests (see `SubsetRequest`) on a Unix domain socket.
+	 * Each connection is answered on its own thread; the loaded `Fasta` objects are only read, so requests are served in parallel without locking.
+	 * Objects can be neither copied nor moved.
+	 */
+	class FastaServer {
+	public:
+		/** \brief Default constructor (deleted) */
+		FastaServer() = delete;
+		/** \brief Constructor
+		 *
+		 * Loads the FASTA files, builds their header indexes, and starts listening on the socket. A stale socket left at `socketPath` is replaced;
+		 * throws if the path is another kind of file or a server is still listening on it.
+		 * Clients can connect as soon as the object is constructed; their requests are answered once `serve()` is called.
+		 *
+		 * \param[in] socketPath socket path
+		 * \param[in] fastaFileNames FASTA file names; requests refer to the files by these names
+		 * \param[in] nThreads number of threads used to load each file
+		 * \param[in] packSequences store packed sequences
+		 */
+		FastaServer(const std::string &socketPath, const std::vector<std::string> &fastaFileNames, const size_t &nThreads, const bool &packSequences);
+		/** \brief Destructor
+		 *
+		 * Stops listening and removes the socket file.
+		 */
+		~FastaServer();
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		FastaServer(const FastaServer &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaServer& operator=(const FastaServer &toCopy) = delete;
+		/** \brief Move constructor (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 */
+		FastaServer(FastaServer &&toMove) = delete;
+		/** \brief Move assignment operator (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaServer& operator=(FastaServer &&toMove) = delete;
+		/** \brief Number of loaded files
+		 *
+		 * \return number of FASTA files
+		 */
+		size_t size() const {return fastaData_.size();};
+		/** \brief Answer requests
+		 *
+		 * Blocks until `stop()` is called, then waits for the requests being answered to finish.
+		 * `SIGPIPE` is ignored from the first call on, so that clients that disconnect early do not end the process.
+		 */
+		void serve();
+		/** \brief Stop answering requests
+		 *
+		 * Can be called from any thread.
+		 */
+		void stop();
+	private:
+		/** \brief Socket path */
+		std::string socketPath_;
+		/** \brief FASTA file names */
+		std::vector<std::string> fastaNames_;
+		/** \brief Loaded FASTA files */
+		std::vector<Fasta> fastaData_;
+		/** \brief Listening socket descriptor */
+		int listenDescriptor_{-1};
+		/** \brief True once `stop()` is called */
+		std::atomic<bool> stopping_{false};
+		/** \brief Active client count lock */
+		std::mutex clientMutex_;
+		/** \brief Signals that a client was answered */
+		std::condition_variable clientDone_;
+		/** \brief Number of clients being answered */
+		size_t nActiveClients_{0};
+		/** \brief Answer one request
+		 *
+		 * Closes the client descriptor.
+		 *
+		 * \param[in] clientDescriptor connected client socket descriptor
+		 */
+		void answer_(const int &clientDescriptor) const;
+		/** \brief Send an error message to a client
+		 *
+		 * Closes the client descriptor.
+		 *
+		 * \param[in] clientDescriptor connected client socket descriptor
+		 * \param[in] message error message
+		 */
+		static void answerError_(const int &clientDescriptor, const std::string &message) noexcept;
+	};
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Buffered FASTA output
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for the buffered FASTA writer.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <memory>
+
+#include "mappedFile.hpp"
+#include "inputStream.hpp"
+
+namespace BayesicSpace {
+	enum class RecordOrder : uint8_t;
+	struct OutputFormat;
+	class FastaWriter;
+
+	/** \brief Output record order */
+	enum class RecordOrder : uint8_t {
+		input, ///< the order of records in the input FASTA file
+		list   ///< the order of headers in the header list
+	};
+
+	/** \brief Output file format */
+	struct OutputFormat {
+		/** \brief Maximal number of sequence characters per line; 0 puts each sequence on one line */
+		size_t lineWidth{0};
+		/** \brief Output compression; any compression is written as BGZF, which gzip readers also accept */
+		Compression compression{Compression::none};
+		/** \brief Number of compression threads */
+		size_t nThreads{1};
+		/** \brief Write a `.fai` index, and a `.gzi` block index for compressed output, next to the output file */
+		bool writeIndexes{false};
+	};
+
+	/** \brief Buffered FASTA writer
+	 *
+	 * Assembles output records in a large page-aligned buffer and writes it out with `writev`.
+	 * Long unwrapped sequences are not copied: they are written directly from the caller's memory together with the buffered bytes.
+	 * Sequences can be wrapped to a fixed line width; lines are then copied whole.
+	 * Output can be BGZF-compressed: each full buffer is cut into independent blocks that are deflated on several threads and written in order.
+	 * Objects can be moved but not copied.
+	 */
+	class FastaWriter {
+	public:
+		/** \brief Default constructor */
+		FastaWriter() = default;
+		/** \brief Constructor with output file name
+		 *
+		 * Sequences are written on one line. If the file exists, it is overwritten.
+		 *
+		 * \param[in] outFileName output file name
+		 */
+		FastaWriter(const std::string &outFileName) : FastaWriter(outFileName, 0) {};
+		/** \brief Constructor with output file name and line width
+		 *
+		 * If the file exists, it is overwritten.
+		 *
+		 * \param[in] outFileName output file name
+		 * \param[in] lineWidth maximal number of sequence characters per line; 0 puts each sequence on one line
+		 */
+		FastaWriter(const std::string &outFileName, const size_t &lineWidth) : FastaWriter(outFileName, lineWidth, false) {};
+		/** \brief Constructor with output file name, line width, and optional background writing
+		 *
+		 * If `writeInBackground` is true, full buffers are handed to a separate thread that writes them out while the next buffer is filled.
+		 * A small fixed set of buffers is recycled between the threads, so memory use stays capped; long sequences are then copied rather than written directly.
+		 * Write errors on the background thread are thrown by a later `write()` or by `close()`.
+		 * If the file exists, it is overwritten.
+		 *
+		 * \param[in] outFileName output file name
+		 * \param[in] lineWidth maximal number of sequence characters per line; 0 puts each sequence on one line
+		 * \param[in] writeInBackground write on a separate thread
+		 */
+		FastaWriter(const std::string &outFileName, const size_t &lineWidth, const bool &writeInBackground) : FastaWriter(outFileName, OutputFormat{lineWidth}, writeInBackground) {};
+		/** \brief Constructor with output file name, format, and optional background writing
+		 *
+		 * Compressed output is always written in the background. The background thread cuts each full buffer into BGZF blocks
+		 * of up to 65280 bytes, deflates them on `format.nThreads` threads (counting itself), and writes them in order, ending the file with the standard empty block.
+		 * The output is readable by `bgzip -d`, and with indexes by `samtools faidx`. Indexes are written by `close()`, with records named by the first white space-delimited word of their headers.
+		 * If the file exists, it is overwritten.
+		 *
+		 * \param[in] outFileName output file name
+		 * \param[in] format output format
+		 * \param[in] writeInBackground write on a separate thread
+		 */
+		FastaWriter(const std::string &outFileName, const OutputFormat &format, const bool &writeInBackground);
+		/** \brief Constructor with an open file descriptor and line width
+		 *
+		 * The writer takes ownership of the descriptor (e.g., a socket) and closes it in `close()`.
+		 *
+		 * \param[in] outputDescriptor file descriptor open for writing
+		 * \param[in] lineWidth maximal number of sequence characters per line; 0 puts each sequence on one line
+		 */
+		FastaWriter(const int &outputDescriptor, const size_t &lineWidth);
+		/** \brief Destructor
+		 *
+		 * Writes out any buffered records. Errors are ignored; call `close()` to detect them.
+		 */
+		~FastaWriter();
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		FastaWriter(const FastaWriter &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		FastaWriter& operator=(const FastaWriter &toCopy) = delete;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 */
+		FastaWriter(FastaWriter &&toMove) noexcept;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		FastaWriter& operator=(FastaWriter &&toMove) noexcept;
+		/** \brief Write a record
+		 *
+		 * \param[in] header header without the leading '>'
+		 * \param[in] sequence sequence without line breaks
+		 */
+		void write(const std::string &header, const std::string &sequence) {
+			this->write( CharView{header.data(), header.size()}, CharView{sequence.data(), sequence.size()} );
+		};
+		/** \brief Write a record from views
+		 *
+		 * \param[in] header header without the leading '>'
+		 * \param[in] sequence sequence without line breaks
+		 */
+		void write(const CharView &header, const CharView &sequence);
+		/** \brief Write out buffered records and close the file
+		 *
+		 * Also saves the indexes if requested. Further writes are not allowed.
+		 */
+		void close();
+	private:
+		/** \brief Output file descriptor */
+		int outputDescriptor_{-1};
+		/** \brief Sequence line width; 0 for no wrapping */
+		size_t lineWidth_{0};
+		/** \brief Page-aligned output buffer */
+		std::unique_ptr<char, void(*)(void*)> buffer_{nullptr, free};
+		/** \brief Number of buffered bytes */
+		size_t bufferEnd_{0};
+		/** \brief Background writing state; null unless writing in the background */
+		struct BackgroundWriter;
+		/** \brief Background writing state, shared with the writing thread */
+		std::shared_ptr<BackgroundWriter> background_;
+		/** \brief Output index state; null unless indexes are written */
+		struct OutputIndex;
+		/** \brief Output index state */
+		std::unique_ptr<OutputIndex> outputIndex_;
+		/** \brief Add bytes to the buffer
+		 *
+		 * Writes the buffer out as it fills.
+		 *
+		 * \param[in] bytes pointer to the first byte
+		 * \param[in] nBytes number of bytes
+		 */
+		void append_(const char *bytes, size_t nBytes);
+		/** \brief Write out the buffer followed by extra bytes
+		 *
+		 * \param[in] extraBytes pointer to bytes written after the buffer contents
+		 * \param[in] nExtraBytes number of extra bytes
+		 */
+		void flush_(const char *extraBytes, const size_t &nExtraBytes);
+		/** \brief Add a record to the output index
+		 *
+		 * \param[in] header header without the leading '>'
+		 * \param[in] sequenceLength sequence length
+		 */
+		void indexRecord_(const CharView &header, const size_t &sequenceLength);
+	};
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Header lookup index
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for the secondary index that answers accession and prefix queries on FASTA headers.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <utility>
+
+namespace BayesicSpace {
+	enum class HeaderMatch : uint8_t;
+	class HeaderIndex;
+
+	/** \brief How list entries are matched to FASTA headers */
+	enum class HeaderMatch : uint8_t {
+		whole,     ///< the entry is the whole header
+		accession, ///< the entry is the first white space-delimited token of the header
+		prefix     ///< the entry is the beginning of the header
+	};
+
+	/** \brief Extract the accession
+	 *
+	 * \param[in] header FASTA header without the leading '>'
+	 * \return the header up to the first space or tab
+	 */
+	std::string accession(const std::string &header);
+
+	/** \brief Secondary header index
+	 *
+	 * Holds the headers in sorted order and a hash map from accessions to records,
+	 * so that prefix queries take \f$O(\log n + k)\f$ and accession queries \f$O(1 + k)\f$ time for \f$k\f$ matches.
+	 * Records are identified by their positions in the header vector used to build the index.
+	 */
+	class HeaderIndex {
+	public:
+		/** \brief Default constructor */
+		HeaderIndex() = default;
+		/** \brief Constructor with headers
+		 *
+		 * \param[in] headers FASTA headers in record order
+		 */
+		HeaderIndex(const std::vector<std::string> &headers);
+		/** \brief Copy constructor 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		HeaderIndex(const HeaderIndex &toCopy) = default;
+		/** \brief Copy assignment operator 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		HeaderIndex& operator=(const HeaderIndex &toCopy) = default;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		HeaderIndex(HeaderIndex &&toMove) = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		HeaderIndex& operator=(HeaderIndex &&toMove) = default;
+		/** \brief Number of indexed headers
+		 *
+		 * \return number of headers
+		 */
+		size_t size() const {return sortedHeaders_.size();};
+		/** \brief Find matching records
+		 *
+		 * \param[in] query whole header, accession, or header prefix
+		 * \param[in] match how the query is matched
+		 * \return positions of matching records in increasing order
+		 */
+		std::vector<size_t> find(const std::string &query, const HeaderMatch &match) const;
+		/** \brief Expand a list of queries into headers
+		 *
+		 * Matches each query in turn and returns the headers of matching records.
+		 * Headers matched by a query are in record order. Each header is returned once, for the first query that matches it.
+		 *
+		 * \param[in] queries whole headers, accessions, or header prefixes
+		 * \param[in] match how the queries are matched
+		 * \return matching headers
+		 */
+		std::vector<std::string> expand(const std::vector<std::string> &queries, const HeaderMatch &match) const;
+	private:
+		/** \brief Headers in lexicographic order, with their record positions */
+		std::vector< std::pair<std::string, size_t> > sortedHeaders_;
+		/** \brief Record positions in increasing order for each accession */
+		std::unordered_map< std::string, std::vector<size_t> > accessionIndex_;
+		/** \brief Headers in record order, as positions in `sortedHeaders_` */
+		std::vector<size_t> recordOrder_;
+	};
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Header list set
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for the compact set of header list entries.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedFile.hpp"
+
+namespace BayesicSpace {
+	class HeaderSet;
+
+	/** \brief Compact set of header list entries
+	 *
+	 * Holds a header list for fast membership tests on very long lists. All entry bytes are kept in one buffer (the arena);
+	 * when the list is read from a file, the arena is the file contents and entries refer to its lines in place.
+	 * Entries are found through a flat open-addressing table with linear probing, which stores a hash tag with each entry index,
+	 * and a Bloom filter that rejects most absent headers without touching the table.
+	 * Duplicate entries are stored once, at the position of their first occurrence.
+	 */
+	class HeaderSet {
+	public:
+		/** \brief Default constructor */
+		HeaderSet() = default;
+		/** \brief Constructor with a header vector
+		 *
+		 * \param[in] headerList vector of list entries
+		 */
+		HeaderSet(const std::vector<std::string> &headerList);
+		/** \brief Constructor with a header list file
+		 *
+		 * The file must have one entry per line, with or without the leading '>'; empty lines are skipped.
+		 * gzip and BGZF-compressed files are decompressed. A file that cannot be opened gives an empty set, as in `readHeaderList()`.
+		 *
+		 * \param[in] headerFileName name of the header list file
+		 */
+		HeaderSet(const std::string &headerFileName);
+		/** \brief Copy constructor 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		HeaderSet(const HeaderSet &toCopy) = default;
+		/** \brief Copy assignment operator 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		HeaderSet& operator=(const HeaderSet &toCopy) = default;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		HeaderSet(HeaderSet &&toMove) = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		HeaderSet& operator=(HeaderSet &&toMove) = default;
+		/** \brief Number of entries
+		 *
+		 * \return number of unique entries
+		 */
+		size_t size() const {return entries_.size();};
+		/** \brief Entry at a position
+		 *
+		 * \param[in] position entry position, in list order without duplicates
+		 * \return view of the entry
+		 */
+		CharView entry(const size_t &position) const {return CharView{arena_.data() + entries_.at(position).offset, entries_.at(position).length};};
+		/** \brief Find an entry
+		 *
+		 * \param[in] header header or part of a header
+		 * \return entry position; equal to `size()` if absent
+		 */
+		size_t find(const CharView &header) const;
+		/** \brief Find an entry given as a string
+		 *
+		 * \param[in] header header or part of a header
+		 * \return entry position; equal to `size()` if absent
+		 */
+		size_t find(const std::string &header) const {return this->find( CharView{header.data(), header.size()} );};
+		/** \brief Bloom filter test
+		 *
+		 * \param[in] header header or part of a header
+		 * \return false if the header is certainly absent
+		 */
+		bool mayContain(const CharView &header) const {return this->mayContain_( hashBytes(header) );};
+		/** \brief Table load factor
+		 *
+		 * \return fraction of occupied table slots
+		 */
+		double loadFactor() const {return ( slots_.empty() ? 0.0 : static_cast<double>( entries_.size() ) / static_cast<double>( slots_.size() ) );};
+		/** \brief Hash bytes
+		 *
+		 * Fast 64-bit hash that reads eight bytes at a time.
+		 *
+		 * \param[in] bytes bytes to hash
+		 * \return hash value
+		 */
+		static uint64_t hashBytes(const CharView &bytes) noexcept;
+	protected:
+		/** \brief Entry position in the arena */
+		struct Entry {
+			/** \brief Offset of the first byte */
+			size_t offset{0};
+			/** \brief Number of bytes */
+			size_t length{0};
+		};
+		/** \brief Entry bytes */
+		std::string arena_;
+		/** \brief Unique entries in list order */
+		std::vector<Entry> entries_;
+		/** \brief Table slots: the upper 32 hash bits and the entry position plus one; 0 marks an empty slot */
+		std::vector<uint64_t> slots_;
+		/** \brief Bloom filter bits */
+		std::vector<uint64_t> bloomBits_;
+		/** \brief Build the table and filter from the entries
+		 *
+		 * Removes duplicate entries.
+		 */
+		void build_();
+		/** \brief Bloom filter test for a hash
+		 *
+		 * \param[in] hash entry hash
+		 * \return false if the entry is certainly absent
+		 */
+		bool mayContain_(const uint64_t &hash) const;
+	};
+}
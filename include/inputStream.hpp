@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Plain and compressed input
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for byte streams that read plain, gzip, or BGZF-compressed files,
+ * and for random access to BGZF files.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+#include "spscQueue.hpp"
+
+namespace BayesicSpace {
+	enum class Compression : uint8_t;
+	class InputStream;
+	class PlainInputStream;
+	class GzipInputStream;
+	class BgzfInputStream;
+	class ReadAheadInputStream;
+	class BgzfIndex;
+	class BgzfReader;
+
+	/** \brief File compression formats */
+	enum class Compression : uint8_t {
+		none, ///< not compressed
+		gzip, ///< gzip, possibly with several members
+		bgzf  ///< blocked gzip, as produced by `bgzip`
+	};
+
+	/** \brief Detect file compression
+	 *
+	 * Examines the first bytes of the file: gzip files start with 0x1f 0x8b, and BGZF files also have a `BC` extra subfield.
+	 *
+	 * \param[in] fileName file name
+	 * \return compression format; `Compression::none` if the file cannot be read
+	 */
+	Compression detectCompression(const std::string &fileName);
+	/** \brief Open a file for reading
+	 *
+	 * Detects compression and returns the appropriate stream. BGZF files are decompressed on `nThreads` threads.
+	 *
+	 * \param[in] fileName file name
+	 * \param[in] nThreads number of decompression threads for BGZF files
+	 * \return input stream
+	 */
+	std::unique_ptr<InputStream> openInputStream(const std::string &fileName, const size_t &nThreads);
+	/** \brief Open a file for reading on a separate thread
+	 *
+	 * As `openInputStream()`, but the returned stream reads (and decompresses) ahead on its own thread (see `ReadAheadInputStream`),
+	 * so that reading overlaps with the caller's processing.
+	 *
+	 * \param[in] fileName file name
+	 * \param[in] nThreads number of decompression threads for BGZF files
+	 * \return input stream
+	 */
+	std::unique_ptr<InputStream> openReadAheadStream(const std::string &fileName, const size_t &nThreads);
+	/** \brief Read a whole file
+	 *
+	 * Reads and, if necessary, decompresses the whole file. Plain files are read into a buffer of their size.
+	 *
+	 * \param[in] fileName file name
+	 * \param[in] nThreads number of decompression threads for BGZF files
+	 * \return file contents
+	 */
+	std::string readWholeFile(const std::string &fileName, const size_t &nThreads);
+
+	/** \brief Byte input stream
+	 *
+	 * Base class for sequential readers of plain or compressed files.
+	 */
+	class InputStream {
+	public:
+		/** \brief Default constructor */
+		InputStream() = default;
+		/** \brief Destructor */
+		virtual ~InputStream() = default;
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		InputStream(const InputStream &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		InputStream& operator=(const InputStream &toCopy) = delete;
+		/** \brief Move constructor (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 */
+		InputStream(InputStream &&toMove) = delete;
+		/** \brief Move assignment operator (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		InputStream& operator=(InputStream &&toMove) = delete;
+		/** \brief Read bytes
+		 *
+		 * Reads up to `nBytes` (uncompressed) bytes. Fewer bytes are returned only at the end of input.
+		 *
+		 * \param[out] destination pointer to the destination buffer
+		 * \param[in] nBytes maximal number of bytes to read
+		 * \return number of bytes read; 0 at the end of input
+		 */
+		virtual size_t read(char *destination, const size_t &nBytes) = 0;
+	};
+
+	/** \brief Uncompressed file input */
+	class PlainInputStream final : public InputStream {
+	public:
+		/** \brief Constructor with file name
+		 *
+		 * \param[in] fileName file name
+		 */
+		PlainInputStream(const std::string &fileName);
+		/** \brief Destructor */
+		~PlainInputStream() override;
+		/** \brief Read bytes
+		 *
+		 * \param[out] destination pointer to the destination buffer
+		 * \param[in] nBytes maximal number of bytes to read
+		 * \return number of bytes read; 0 at the end of input
+		 */
+		size_t read(char *destination, const size_t &nBytes) override;
+	private:
+		/** \brief File descriptor */
+		int fileDescriptor_{-1};
+	};
+
+	/** \brief gzip-compressed file input
+	 *
+	 * Decompresses on the calling thread. Files with several concatenated gzip members (including BGZF) are read to the end.
+	 */
+	class GzipInputStream final : public InputStream {
+	public:
+		/** \brief Constructor with file name
+		 *
+		 * \param[in] fileName file name
+		 */
+		GzipInputStream(const std::string &fileName);
+		/** \brief Destructor */
+		~GzipInputStream() override;
+		/** \brief Read bytes
+		 *
+		 * \param[out] destination pointer to the destination buffer
+		 * \param[in] nBytes maximal number of bytes to read
+		 * \return number of bytes read; 0 at the end of input
+		 */
+		size_t read(char *destination, const size_t &nBytes) override;
+	private:
+		/** \brief File descriptor */
+		int fileDescriptor_{-1};
+		/** \brief Compressed input buffer */
+		std::vector<char> compressedBuffer_;
+		/** \brief zlib stream state (a `z_stream`) */
+		std::shared_ptr<void> zStream_;
+		/** \brief True if the compressed file is exhausted */
+		bool compressedEnd_{false};
+		/** \brief True if the current gzip member is complete */
+		bool memberEnd_{false};
+	};
+
+	/** \brief BGZF-compressed file input
+	 *
+	 * Reads batches of BGZF blocks and decompresses the blocks of each batch on several threads.
+	 * The next batch is read and decompressed in the background while the current one is consumed.
+	 */
+	class BgzfInputStream final : public InputStream {
+	public:
+		/** \brief Constructor with file name
+		 *
+		 * \param[in] fileName file name
+		 * \param[in] nThreads number of decompression threads
+		 */
+		BgzfInputStream(const std::string &fileName, const size_t &nThreads);
+		/** \brief Destructor */
+		~BgzfInputStream() override;
+		/** \brief Read bytes
+		 *
+		 * \param[out] destination pointer to the destination buffer
+		 * \param[in] nBytes maximal number of bytes to read
+		 * \return number of bytes read; 0 at the end of input
+		 */
+		size_t read(char *destination, const size_t &nBytes) override;
+	private:
+		/** \brief File descriptor */
+		int fileDescriptor_{-1};
+		/** \brief Number of decompression threads */
+		size_t nThreads_{1};
+		/** \brief True if all blocks have been read from the file; only accessed by the batch decoder */
+		bool compressedEnd_{false};
+		/** \brief Decompressed bytes of the current batch */
+		std::vector<char> currentBatch_;
+		/** \brief Position of the first unread byte in the current batch */
+		size_t batchPosition_{0};
+		/** \brief Batch being decompressed in the background */
+		std::future< std::vector<char> > nextBatch_;
+		/** \brief Read and decompress the next batch of blocks with data
+		 *
+		 * Skips batches that decompress to nothing, such as runs of empty blocks.
+		 *
+		 * \return decompressed bytes; empty only at the end of input
+		 */
+		std::vector<char> decodeBatch_();
+		/** \brief Read and decompress up to a batch of blocks
+		 *
+		 * \return decompressed bytes; empty if all the blocks read are empty
+		 */
+		std::vector<char> decodeBlocks_();
+	};
+
+	/** \brief Read-ahead input
+	 *
+	 * Reads another stream on a separate thread, in large blocks, into a fixed set of recycled buffers.
+	 * Filled and empty buffers are passed between the threads through lock-free queues, so reading overlaps with processing and memory use is capped.
+	 * Errors on the reading thread are thrown by `read()` once the data read before them are consumed.
+	 */
+	class ReadAheadInputStream final : public InputStream {
+	public:
+		/** \brief Constructor with the source stream
+		 *
+		 * \param[in] source stream to read from; its `read()` is only called on the read-ahead thread
+		 */
+		ReadAheadInputStream(std::unique_ptr<InputStream> source);
+		/** \brief Destructor
+		 *
+		 * Stops the read-ahead thread.
+		 */
+		~ReadAheadInputStream() override;
+		/** \brief Read bytes
+		 *
+		 * \param[out] destination pointer to the destination buffer
+		 * \param[in] nBytes maximal number of bytes to read
+		 * \return number of bytes read; 0 at the end of input
+		 */
+		size_t read(char *destination, const size_t &nBytes) override;
+	private:
+		/** \brief Block of bytes passed between the threads */
+		struct Block {
+			/** \brief Block storage */
+			std::unique_ptr<char[]> bytes;
+			/** \brief Number of bytes read into the block; 0 marks the end of input */
+			size_t size{0};
+		};
+		/** \brief Source stream */
+		std::unique_ptr<InputStream> source_;
+		/** \brief Blocks filled by the read-ahead thread */
+		SpscQueue<Block> filledBlocks_;
+		/** \brief Consumed blocks returned for reuse */
+		SpscQueue<Block> emptyBlocks_;
+		/** \brief Block being consumed */
+		Block currentBlock_;
+		/** \brief Position of the first unread byte in the current block */
+		size_t blockPosition_{0};
+		/** \brief True once the end-of-input block is received */
+		bool endOfInput_{false};
+		/** \brief Error on the read-ahead thread */
+		std::exception_ptr readError_{nullptr};
+		/** \brief Set to stop the read-ahead thread */
+		std::atomic<bool> cancelled_{false};
+		/** \brief Read-ahead thread */
+		std::thread readThread_;
+		/** \brief Read-ahead thread loop */
+		void readAhead_();
+	};
+
+	/** \brief BGZF block index
+	 *
+	 * Maps uncompressed file offsets to the BGZF blocks that contain them, in the `bgzip` `.gzi` format.
+	 * The index is stored next to the compressed file, with `.gzi` appended to its name.
+	 */
+	class BgzfIndex {
+	public:
+		/** \brief Default constructor */
+		BgzfIndex() = default;
+		/** \brief Constructor with BGZF file name
+		 *
+		 * Reads the `.gzi` index if it exists and is newer than the BGZF file.
+		 * Otherwise, indexes the block headers and attempts to save the index; failure to save is not an error.
+		 *
+		 * \param[in] bgzfFileName BGZF file name
+		 */
+		BgzfIndex(const std::string &bgzfFileName);
+		/** \brief Constructor with block offsets
+		 *
+		 * Used by writers that record block positions as they write them. Both vectors begin with the first block, at offset 0.
+		 *
+		 * \param[in] compressedOffsets file offsets of block starts
+		 * \param[in] uncompressedOffsets uncompressed offsets of block starts
+		 */
+		BgzfIndex(std::vector<uint64_t> compressedOffsets, std::vector<uint64_t> uncompressedOffsets);
+		/** \brief Number of indexed blocks
+		 *
+		 * \return number of blocks
+		 */
+		size_t size() const {return compressedOffsets_.size();};
+		/** \brief Find the block containing an uncompressed offset
+		 *
+		 * \param[in] uncompressedOffset offset in the uncompressed data
+		 * \param[out] compressedOffset file offset of the block start
+		 * \param[out] blockUncompressedOffset uncompressed offset of the first byte in the block
+		 */
+		void locate(const uint64_t &uncompressedOffset, uint64_t &compressedOffset, uint64_t &blockUncompressedOffset) const;
+		/** \brief Save the index
+		 *
+		 * \param[in] indexFileName output index file name
+		 */
+		void save(const std::string &indexFileName) const;
+	private:
+		/** \brief Compressed offsets of block starts, beginning with 0 */
+		std::vector<uint64_t> compressedOffsets_;
+		/** \brief Uncompressed offsets of block starts, beginning with 0 */
+		std::vector<uint64_t> uncompressedOffsets_;
+	};
+
+	/** \brief Random-access BGZF reader
+	 *
+	 * Reads ranges of uncompressed bytes by decompressing only the blocks that contain them. Objects can be moved but not copied.
+	 */
+	class BgzfReader {
+	public:
+		/** \brief Default constructor */
+		BgzfReader() = default;
+		/** \brief Constructor with file name
+		 *
+		 * Opens the file and reads or builds its block index.
+		 *
+		 * \param[in] bgzfFileName BGZF file name
+		 */
+		BgzfReader(const std::string &bgzfFileName);
+		/** \brief Destructor */
+		~BgzfReader();
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		BgzfReader(const BgzfReader &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		BgzfReader& operator=(const BgzfReader &toCopy) = delete;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 */
+		BgzfReader(BgzfReader &&toMove) noexcept;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		BgzfReader& operator=(BgzfReader &&toMove) noexcept;
+		/** \brief Read uncompressed bytes
+		 *
+		 * Safe to call from several threads at once.
+		 *
+		 * \param[in] uncompressedOffset offset of the first byte in the uncompressed data
+		 * \param[in] nBytes number of bytes to read
+		 * \param[out] destination pointer to the destination buffer
+		 * \return number of bytes read; less than `nBytes` only at the end of the data
+		 */
+		size_t read(const uint64_t &uncompressedOffset, const size_t &nBytes, char *destination) const;
+	private:
+		/** \brief File descriptor */
+		int fileDescriptor_{-1};
+		/** \brief Block index */
+		BgzfIndex index_;
+	};
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Read-only memory-mapped files
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for memory-mapped file access and non-owning character views.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace BayesicSpace {
+	struct CharView;
+	struct CharViewHash;
+	class MappedFile;
+
+	/** \brief Non-owning view of characters
+	 *
+	 * Points to a range of characters owned by some other object (e.g., a memory-mapped file).
+	 * The view is only valid while the owner is alive.
+	 */
+	struct CharView {
+		/** \brief Pointer to the first character */
+		const char *start{nullptr};
+		/** \brief Number of characters */
+		size_t length{0};
+		/** \brief Copy to a string
+		 *
+		 * \return string with a copy of the viewed characters
+		 */
+		std::string str() const {return {start, length};};
+	};
+	/** \brief Character view equality
+	 *
+	 * \param[in] lhs left-hand side view
+	 * \param[in] rhs right-hand side view
+	 * \return true if the viewed characters are the same
+	 */
+	bool operator==(const CharView &lhs, const CharView &rhs) noexcept;
+	/** \brief Character view hash
+	 *
+	 * FNV-1a hash of the viewed characters, for use in hash tables.
+	 */
+	struct CharViewHash {
+		/** \brief Hash function
+		 *
+		 * \param[in] view character view to hash
+		 * \return hash value
+		 */
+		size_t operator()(const CharView &view) const noexcept;
+	};
+
+	/** \brief Read-only memory-mapped file
+	 *
+	 * Maps the whole file into memory on construction and unmaps it on destruction.
+	 * Objects can be moved but not copied.
+	 */
+	class MappedFile {
+	public:
+		/** \brief Default constructor */
+		MappedFile() = default;
+		/** \brief Constructor with file name
+		 *
+		 * Maps the file read-only. An empty file results in a null data pointer and zero size.
+		 *
+		 * \param[in] fileName name of the file to map
+		 */
+		MappedFile(const std::string &fileName);
+		/** \brief Destructor */
+		~MappedFile();
+		/** \brief Copy constructor (deleted) 
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		MappedFile(const MappedFile &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		MappedFile& operator=(const MappedFile &toCopy) = delete;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 */
+		MappedFile(MappedFile &&toMove) noexcept;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		MappedFile& operator=(MappedFile &&toMove) noexcept;
+		/** \brief Pointer to the mapped bytes
+		 *
+		 * \return pointer to the first byte of the file
+		 */
+		const char* data() const noexcept {return data_;};
+		/** \brief File size
+		 *
+		 * \return number of mapped bytes
+		 */
+		size_t size() const noexcept {return size_;};
+	private:
+		/** \brief Mapped bytes */
+		const char *data_{nullptr};
+		/** \brief Mapped file size */
+		size_t size_{0};
+	};
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Compact nucleotide sequence storage
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for the class that stores nucleotide sequences with two bits per base.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BayesicSpace {
+	class PackedSequence;
+
+	/** \brief Packed nucleotide sequence
+	 *
+	 * Stores A, C, G, and T with two bits per base. Runs of any other characters (IUPAC ambiguity codes, gaps, etc.) are kept in a separate list,
+	 * and runs of lower-case letters are kept as a mask. Any sequence is reproduced exactly, but the savings are greatest for sequences of mostly ACGT.
+	 */
+	class PackedSequence {
+	public:
+		/** \brief Default constructor */
+		PackedSequence() = default;
+		/** \brief Constructor with a sequence
+		 *
+		 * \param[in] sequence sequence to pack
+		 */
+		PackedSequence(const std::string &sequence);
+		/** \brief Copy constructor 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		PackedSequence(const PackedSequence &toCopy) = default;
+		/** \brief Copy assignment operator 
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		PackedSequence& operator=(const PackedSequence &toCopy) = default;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		PackedSequence(PackedSequence &&toMove) = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		PackedSequence& operator=(PackedSequence &&toMove) = default;
+		/** \brief Sequence length
+		 *
+		 * \return number of bases
+		 */
+		size_t size() const noexcept {return static_cast<size_t>(length_);};
+		/** \brief Unpack the sequence
+		 *
+		 * \return the original sequence
+		 */
+		std::string unpack() const;
+		/** \brief Memory used
+		 *
+		 * \return number of heap bytes used by the packed representation
+		 */
+		size_t memoryBytes() const noexcept;
+	private:
+		/** \brief Run of identical characters */
+		struct CharacterRun {
+			/** \brief Position of the first character */
+			uint64_t start{0};
+			/** \brief Number of characters */
+			uint64_t length{0};
+			/** \brief The character (upper case for letters) */
+			char character{'N'};
+		};
+		/** \brief Sequence length */
+		uint64_t length_{0};
+		/** \brief Two-bit base codes, four bases per byte with the first base in the lowest bits */
+		std::vector<uint8_t> baseCodes_;
+		/** \brief Runs of characters other than A, C, G, or T */
+		std::vector<CharacterRun> exceptionRuns_;
+		/** \brief Runs of lower-case letters (the character field is unused) */
+		std::vector<CharacterRun> lowerCaseRuns_;
+	};
+}
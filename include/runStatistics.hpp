@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Run statistics
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for phase timing and resource use statistics.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <ostream>
+
+namespace BayesicSpace {
+	class RunStatistics;
+
+	/** \brief Run statistics
+	 *
+	 * Records wall time of named phases, integer counts (e.g., bytes and records), and real-valued measurements (e.g., hash table load factors).
+	 * A disabled object ignores all input, so instrumented code can call it unconditionally at the cost of one branch per call.
+	 * Entries are reported in the order they were first recorded.
+	 */
+	class RunStatistics {
+	public:
+		/** \brief Default constructor
+		 *
+		 * Creates a disabled object.
+		 */
+		RunStatistics() = default;
+		/** \brief Constructor with state
+		 *
+		 * \param[in] enabled record statistics if true
+		 */
+		explicit RunStatistics(const bool &enabled) : enabled_{enabled} {};
+		/** \brief Is recording enabled
+		 *
+		 * \return true if statistics are recorded
+		 */
+		bool enabled() const noexcept {return enabled_;};
+		/** \brief Start a phase
+		 *
+		 * Ends the current phase, if any. Time spent in phases with the same name is added up.
+		 *
+		 * \param[in] phaseName phase name
+		 */
+		void startPhase(const std::string &phaseName);
+		/** \brief End the current phase */
+		void endPhase();
+		/** \brief Add to a count
+		 *
+		 * \param[in] countName count name
+		 * \param[in] value value to add
+		 */
+		void addCount(const std::string &countName, const uint64_t &value);
+		/** \brief Set a measurement
+		 *
+		 * \param[in] valueName measurement name
+		 * \param[in] value measurement value
+		 */
+		void setValue(const std::string &valueName, const double &value);
+		/** \brief Phase time
+		 *
+		 * \param[in] phaseName phase name
+		 * \return total seconds spent in the phase; 0 if there is no such phase
+		 */
+		double phaseSeconds(const std::string &phaseName) const;
+		/** \brief Count value
+		 *
+		 * \param[in] countName count name
+		 * \return count; 0 if there is no such count
+		 */
+		uint64_t count(const std::string &countName) const;
+		/** \brief Write a human-readable report
+		 *
+		 * Includes the peak resident set size of the process.
+		 *
+		 * \param[in,out] outStream output stream
+		 */
+		void report(std::ostream &outStream) const;
+		/** \brief Statistics as JSON
+		 *
+		 * Includes the peak resident set size of the process.
+		 *
+		 * \return JSON object
+		 */
+		std::string json() const;
+		/** \brief Peak resident set size
+		 *
+		 * \return peak resident set size of the process so far, in kilobytes
+		 */
+		static int64_t peakRSS();
+		/** \brief Count bytes read
+		 *
+		 * Called by the library wherever file (or server) input is read, so the total is the number of bytes actually consumed:
+		 * compressed bytes for compressed input, and only the parts read for indexed or snapshot input.
+		 * Safe to call from any thread.
+		 *
+		 * \param[in] nBytes number of bytes read
+		 */
+		static void countBytesRead(const uint64_t &nBytes) noexcept;
+		/** \brief Count bytes written
+		 *
+		 * Called by the library wherever output is written, so the total is the number of bytes actually produced (compressed bytes for compressed output).
+		 * Safe to call from any thread.
+		 *
+		 * \param[in] nBytes number of bytes written
+		 */
+		static void countBytesWritten(const uint64_t &nBytes) noexcept;
+		/** \brief Bytes read
+		 *
+		 * \return number of bytes read by the process so far
+		 */
+		static uint64_t bytesRead() noexcept;
+		/** \brief Bytes written
+		 *
+		 * \return number of bytes written by the process so far
+		 */
+		static uint64_t bytesWritten() noexcept;
+	private:
+		/** \brief Record statistics if true */
+		bool enabled_{false};
+		/** \brief True while a phase is timed */
+		bool inPhase_{false};
+		/** \brief Index of the current phase in `phaseSeconds_` */
+		size_t currentPhase_{0};
+		/** \brief Start time of the current phase */
+		std::chrono::steady_clock::time_point phaseStart_;
+		/** \brief Phase names and times in seconds */
+		std::vector< std::pair<std::string, double> > phaseSeconds_;
+		/** \brief Count names and values */
+		std::vector< std::pair<std::string, uint64_t> > counts_;
+		/** \brief Measurement names and values */
+		std::vector< std::pair<std::string, double> > values_;
+	};
+}
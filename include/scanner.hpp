@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Block-oriented FASTA scanning
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and interface documentation for vectorized record boundary search and line break removal,
+ * and for a block-reading FASTA record reader that uses them.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "inputStream.hpp"
+
+namespace BayesicSpace {
+	enum class SimdLevel : uint8_t;
+	class FastaScanner;
+	class RecordReader;
+
+	/** \brief Vector instruction sets used by the scanner */
+	enum class SimdLevel : uint8_t {
+		portable, ///< no vector instructions beyond those used by the C library
+		sse2,     ///< 16-byte SSE2 vectors
+		avx2      ///< 32-byte AVX2 vectors
+	};
+
+	/** \brief FASTA byte scanner
+	 *
+	 * Finds record boundaries and copies sequence bytes without line breaks, processing 16 or 32 bytes at a time.
+	 * The instruction set is chosen at run time according to what the processor supports.
+	 */
+	class FastaScanner {
+	public:
+		/** \brief Default constructor
+		 *
+		 * Uses the best instruction set available.
+		 */
+		FastaScanner();
+		/** \brief Constructor with an instruction set
+		 *
+		 * Uses the requested instruction set or the best available, whichever is lower.
+		 *
+		 * \param[in] requestedLevel requested instruction set
+		 */
+		FastaScanner(const SimdLevel &requestedLevel);
+		/** \brief Instruction set in use
+		 *
+		 * \return instruction set
+		 */
+		SimdLevel simdLevel() const noexcept {return simdLevel_;};
+		/** \brief Find the start of the next record
+		 *
+		 * Looks for a '>' that immediately follows a line feed, with both characters in the range.
+		 * A '>' at `start` itself is not considered, since the preceding byte is outside the range.
+		 *
+		 * \param[in] start pointer to the first byte
+		 * \param[in] end pointer to one past the last byte
+		 * \return pointer to the '>'; `end` if none is found
+		 */
+		const char* findRecordStart(const char *start, const char *end) const {return findRecordStart_(start, end);};
+		/** \brief Copy without line breaks
+		 *
+		 * Copies the bytes in the range, skipping all line feeds and carriage returns.
+		 * The destination must have room for `end - start` bytes.
+		 * If the lines after the first have the same width, as in most FASTA files, line feed positions are computed rather than searched for
+		 * and each line is copied whole, with unrolled copies for widths of 60, 70, and 80. The general search takes over from the first line of a different width.
+		 *
+		 * \param[in] start pointer to the first byte
+		 * \param[in] end pointer to one past the last byte
+		 * \param[out] destination pointer to the first destination byte
+		 * \return number of bytes copied
+		 */
+		size_t copyStripped(const char *start, const char *end, char *destination) const;
+		/** \brief Best instruction set available
+		 *
+		 * \return best instruction set supported by the processor and the compiler
+		 */
+		static SimdLevel bestSimdLevel();
+	private:
+		/** \brief Instruction set in use */
+		SimdLevel simdLevel_{SimdLevel::portable};
+		/** \brief Record start search implementation */
+		const char* (*findRecordStart_)(const char *, const char *){nullptr};
+		/** \brief Line break removal implementation */
+		size_t (*copyStripped_)(const char *, const char *, char *){nullptr};
+		/** \brief Fixed-width line copy implementation */
+		size_t (*copyLines_)(const char *, const char *, const size_t &, char *, const char *&){nullptr};
+		/** \brief Smallest line width handled by `copyLines_` */
+		size_t minLineWidth_{8};
+	};
+
+	/** \brief Streaming FASTA record reader
+	 *
+	 * Reads a FASTA file in large blocks and returns one record at a time.
+	 * Only the current record (or, if its sequence is skipped, the current block) is kept in memory.
+	 * Line feeds and carriage returns are removed from sequences; a carriage return at the end of a header line is also removed.
+	 * Objects can be moved but not copied.
+	 */
+	class RecordReader {
+	public:
+		/** \brief Default constructor */
+		RecordReader() = default;
+		/** \brief Constructor with input file name
+		 *
+		 * Opens the file and checks that it starts with a header line.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 */
+		RecordReader(const std::string &inFileName) : RecordReader(inFileName, 1) {};
+		/** \brief Constructor with input file name and thread number
+		 *
+		 * Opens the file and checks that it starts with a header line.
+		 * gzip and BGZF-compressed files are decompressed on the fly; BGZF blocks are decompressed on `nThreads` threads.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 */
+		RecordReader(const std::string &inFileName, const size_t &nThreads) : RecordReader(inFileName, nThreads, false) {};
+		/** \brief Constructor with optional read-ahead
+		 *
+		 * If `readAhead` is true, the file is read (and decompressed) on a separate thread (see `ReadAheadInputStream`), so that reading overlaps with parsing.
+		 *
+		 * \param[in] inFileName input FASTA file name
+		 * \param[in] nThreads number of decompression threads
+		 * \param[in] readAhead read on a separate thread
+		 */
+		RecordReader(const std::string &inFileName, const size_t &nThreads, const bool &readAhead);
+		/** \brief Destructor */
+		~RecordReader() = default;
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		RecordReader(const RecordReader &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		RecordReader& operator=(const RecordReader &toCopy) = delete;
+		/** \brief Move constructor 
+		 *
+		 * \param[in] toMove object to move
+		 */
+		RecordReader(RecordReader &&toMove) noexcept = default;
+		/** \brief Move assignment operator 
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		RecordReader& operator=(RecordReader &&toMove) noexcept = default;
+		/** \brief Read the next header
+		 *
+		 * Must be followed by `readSequence()` or `skipSequence()` before the next call.
+		 *
+		 * \param[out] header record header without the leading '>'
+		 * \return false if there are no more records
+		 */
+		bool nextHeader(std::string &header);
+		/** \brief Read the sequence of the current record
+		 *
+		 * \param[out] sequence sequence with line breaks removed
+		 */
+		void readSequence(std::string &sequence);
+		/** \brief Skip the sequence of the current record */
+		void skipSequence();
+	private:
+		/** \brief Input stream */
+		std::unique_ptr<InputStream> input_;
+		/** \brief Read buffer */
+		std::vector<char> buffer_;
+		/** \brief Position of the first unprocessed byte in the buffer */
+		size_t bufferPosition_{0};
+		/** \brief One past the last filled byte in the buffer */
+		size_t bufferEnd_{0};
+		/** \brief True if the input is exhausted */
+		bool endOfInput_{false};
+		/** \brief True if the first unprocessed byte starts a line */
+		bool atLineStart_{true};
+		/** \brief Scanner */
+		FastaScanner scanner_;
+		/** \brief Read the next block
+		 *
+		 * Moves unprocessed bytes to the front of the buffer, enlarging it if it is full, and reads more input after them.
+		 *
+		 * \return number of bytes read
+		 */
+		size_t refill_();
+		/** \brief Process the current sequence
+		 *
+		 * \param[out] sequence pointer to the sequence to append to; skip the sequence if `nullptr`
+		 */
+		void consumeSequence_(std::string *sequence);
+	};
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Single-producer single-consumer queue
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Definitions and implementation of the bounded lock-free queue that connects pipeline stages.
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <utility>
+
+namespace BayesicSpace {
+	template <typename T>
+	class SpscQueue;
+
+	/** \brief Wait before retrying a queue operation
+	 *
+	 * Yields for the first few attempts and then sleeps briefly, so that a waiting stage uses little CPU when the other stage is slow (e.g., waiting for I/O).
+	 *
+	 * \param[in,out] nAttempts number of attempts so far; incremented
+	 */
+	inline void backOff(size_t &nAttempts) {
+		constexpr size_t nYields{64};
+		constexpr std::chrono::microseconds sleepTime{50};
+		if (nAttempts < nYields) {
+			std::this_thread::yield();
+		} else {
+			std::this_thread::sleep_for(sleepTime);
+		}
+		++nAttempts;
+	}
+
+	/** \brief Bounded lock-free queue
+	 *
+	 * Ring buffer that passes items from one producer thread to one consumer thread without locks.
+	 * The operations do not block; callers retry with `backOff()` when the queue is full or empty.
+	 * Objects can be neither copied nor moved.
+	 *
+	 * \tparam T item type; must be default-constructible and move-assignable
+	 */
+	template <typename T>
+	class SpscQueue {
+	public:
+		/** \brief Default constructor (deleted) */
+		SpscQueue() = delete;
+		/** \brief Constructor with capacity
+		 *
+		 * \param[in] capacity minimal number of items the queue can hold; rounded up to a power of two
+		 */
+		explicit SpscQueue(const size_t &capacity) {
+			size_t nSlots{1};
+			while (nSlots < capacity) {
+				nSlots <<= 1;
+			}
+			slots_.resize(nSlots);
+			mask_ = nSlots - 1;
+		};
+		/** \brief Destructor */
+		~SpscQueue() = default;
+		/** \brief Copy constructor (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 */
+		SpscQueue(const SpscQueue &toCopy) = delete;
+		/** \brief Copy assignment operator (deleted)
+		 *
+		 * \param[in] toCopy object to copy
+		 * \return copied object
+		 */
+		SpscQueue& operator=(const SpscQueue &toCopy) = delete;
+		/** \brief Move constructor (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 */
+		SpscQueue(SpscQueue &&toMove) = delete;
+		/** \brief Move assignment operator (deleted)
+		 *
+		 * \param[in] toMove object to move
+		 * \return moved object
+		 */
+		SpscQueue& operator=(SpscQueue &&toMove) = delete;
+		/** \brief Try to add an item
+		 *
+		 * Must only be called by the producer thread.
+		 *
+		 * \param[in,out] item item to add; moved from on success
+		 * \return false if the queue is full
+		 */
+		bool tryPush(T &item) {
+			const size_t tail = tail_.load(std::memory_order_relaxed);
+			if ( tail - head_.load(std::memory_order_acquire) == slots_.size() ) {
+				return false;
+			}
+			slots_[tail & mask_] = std::move(item);
+			tail_.store(tail + 1, std::memory_order_release);
+			return true;
+		};
+		/** \brief Try to remove an item
+		 *
+		 * Must only be called by the consumer thread.
+		 *
+		 * \param[out] item removed item
+		 * \return false if the queue is empty
+		 */
+		bool tryPop(T &item) {
+			const size_t head = head_.load(std::memory_order_relaxed);
+			if ( head == tail_.load(std::memory_order_acquire) ) {
+				return false;
+			}
+			item = std::move(slots_[head & mask_]);
+			head_.store(head + 1, std::memory_order_release);
+			return true;
+		};
+	private:
+		/** \brief Item slots */
+		std::vector<T> slots_;
+		/** \brief Slot index mask */
+		size_t mask_{0};
+		/** \brief Number of items removed; written by the consumer */
+		std::atomic<size_t> head_{0};
+		/** \brief Keeps `head_` and `tail_` on separate cache lines */
+		char padding_[64]{};
+		/** \brief Number of items added; written by the producer */
+		std::atomic<size_t> tail_{0};
+	};
+}
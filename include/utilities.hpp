@@ -27,12 +27,18 @@
  *
  */
 
+#include <cstddef>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include <utility>
 
 #pragma once
 
 namespace BayesicSpace {
+	class Fasta;
+	struct OutputFormat;
+
 	/** \brief Save the subset as FASTA 
 	 * 
 	 * Save the provided data as a multi-record FASTA file. Sequence portions on one line.
@@ -42,6 +48,89 @@ namespace BayesicSpace {
 	 * \param[in] outFileName name of the output file
 	 */
 	void saveAsFASTA(const std::unordered_map<std::string, std::string> &subsetRecords, const std::string &outFileName);
+	/** \brief Save ordered records as FASTA 
+	 * 
+	 * Save the provided records, in vector order, as a multi-record FASTA file with a buffered `FastaWriter`.
+	 * If the file with the given name exists, it is overwritten.
+	 *
+	 * \param[in] subsetRecords header and sequence pairs to be saved
+	 * \param[in] outFileName name of the output file
+	 * \param[in] lineWidth maximal number of sequence characters per line; 0 puts each sequence on one line
+	 */
+	void saveAsFASTA(const std::vector< std::pair<std::string, std::string> > &subsetRecords, const std::string &outFileName, const size_t &lineWidth);
+	/** \brief Save ordered records as FASTA in a given format
+	 * 
+	 * As the line width version, but the output may be BGZF-compressed and indexed (see `FastaWriter`).
+	 *
+	 * \param[in] subsetRecords header and sequence pairs to be saved
+	 * \param[in] outFileName name of the output file
+	 * \param[in] format output format
+	 */
+	void saveAsFASTA(const std::vector< std::pair<std::string, std::string> > &subsetRecords, const std::string &outFileName, const OutputFormat &format);
+	/** \brief Save indexed records as FASTA 
+	 * 
+	 * Save the records of `fastaData` with the provided indexes (e.g., from `Fasta::subsetIndexes()`), in vector order, as a multi-record FASTA file.
+	 * Unpacked sequences are written straight from the `Fasta` object without copying.
+	 * If the file with the given name exists, it is overwritten.
+	 *
+	 * \param[in] fastaData FASTA records
+	 * \param[in] recordIndexes indexes of the records to be saved
+	 * \param[in] outFileName name of the output file
+	 * \param[in] lineWidth maximal number of sequence characters per line; 0 puts each sequence on one line
+	 */
+	void saveAsFASTA(const Fasta &fastaData, const std::vector<size_t> &recordIndexes, const std::string &outFileName, const size_t &lineWidth);
+	/** \brief Save indexed records as FASTA in a given format
+	 * 
+	 * As the line width version, but the output may be BGZF-compressed and indexed (see `FastaWriter`).
+	 *
+	 * \param[in] fastaData FASTA records
+	 * \param[in] recordIndexes indexes of the records to be saved
+	 * \param[in] outFileName name of the output file
+	 * \param[in] format output format
+	 */
+	void saveAsFASTA(const Fasta &fastaData, const std::vector<size_t> &recordIndexes, const std::string &outFileName, const OutputFormat &format);
+	/** \brief Read a header list
+	 *
+	 * Reads one entry per non-empty line, removing the leading '>' if present.
+	 *
+	 * \param[in] headerFileName name of the header list file
+	 * \return list entries in file order
+	 */
+	std::vector<std::string> readHeaderList(const std::string &headerFileName);
+	/** \brief Input file names from a flag value
+	 *
+	 * The value is either a comma-separated list of file names or, if it starts with '@', the name of a file with one file name per line.
+	 * Empty names are skipped.
+	 *
+	 * \param[in] flagValue command line flag value
+	 * \return file names in the given order
+	 */
+	std::vector<std::string> inputFileNames(const std::string &flagValue);
+	/** \brief Output file name for a shard
+	 *
+	 * Prefixes the base name of the output file with the base name of the shard, without its directory, `.gz` or `.bgz` suffix, and last extension.
+	 * For example, shard `refs/chr1.fa.gz` and output `out/subset.fasta` give `out/chr1_subset.fasta`.
+	 *
+	 * \param[in] shardFileName input shard file name
+	 * \param[in] outFileName output file name
+	 * \return shard output file name
+	 */
+	std::string shardOutFileName(const std::string &shardFileName, const std::string &outFileName);
+	/** \brief File size
+	 *
+	 * \param[in] fileName file name
+	 * \return file size in bytes; 0 if the file does not exist
+	 */
+	size_t fileSize(const std::string &fileName);
+	/** \brief Do two names refer to the same file
+	 *
+	 * Compares device and inode numbers, so links and different paths to one file are recognized.
+	 *
+	 * \param[in] firstFileName first file name
+	 * \param[in] secondFileName second file name
+	 * \return true if both files exist and are the same file
+	 */
+	bool sameFile(const std::string &firstFileName, const std::string &secondFileName);
 	/** \brief Command line parser
 	 *
 	 * Maps flags to values. Flags assumed to be of the form `--flag-name value`.
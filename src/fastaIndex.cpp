@@ -0,0 +1,496 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// FASTA index for random access
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of `faidx`-compatible FASTA indexes and indexed record extraction.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fastaIndex.hpp"
+#include "mappedFile.hpp"
+#include "inputStream.hpp"
+#include "headerIndex.hpp"
+#include "runStatistics.hpp"
+#include "utilities.hpp"
+
+using namespace BayesicSpace;
+
+FastaIndex::FastaIndex(const std::string &fastaFileName) {
+	const std::string indexFileName = fastaFileName + std::string(".fai");
+	if ( FastaIndex::isFresh(fastaFileName, indexFileName) ) {
+		this->load_(indexFileName);
+		return;
+	}
+	this->build_(fastaFileName);
+	this->save(indexFileName);
+}
+
+FastaIndex::FastaIndex(std::vector<FaidxEntry> entries) : entries_{std::move(entries)} {
+	for (auto &eachEntry : entries_) {
+		eachEntry.name = accession(eachEntry.name);
+	}
+	nameIndex_.reserve( entries_.size() );
+	for (size_t iEntry = 0; iEntry < entries_.size(); ++iEntry) {
+		nameIndex_.emplace(entries_[iEntry].name, iEntry);
+	}
+}
+
+size_t FastaIndex::find(const std::string &name) const {
+	auto search = nameIndex_.find(name);
+	if ( search == nameIndex_.end() ) {
+		return entries_.size();
+	}
+	return search->second;
+}
+
+void FastaIndex::save(const std::string &indexFileName) const {
+	std::fstream outIndex;
+	outIndex.open(indexFileName, std::ios::out | std::ios::trunc);
+	for (const auto &eachEntry : entries_) {
+		outIndex << eachEntry.name << "\t" << eachEntry.length << "\t" << eachEntry.offset << "\t"
+			<< eachEntry.lineBases << "\t" << eachEntry.lineBytes << "\n";
+	}
+	const std::streamoff nIndexBytes = outIndex.tellp();
+	outIndex.close();
+	if (nIndexBytes > 0) {
+		RunStatistics::countBytesWritten( static_cast<uint64_t>(nIndexBytes) );
+	}
+}
+
+bool FastaIndex::isFresh(const std::string &fastaFileName, const std::string &indexFileName) {
+	struct stat fastaStatus{};
+	struct stat indexStatus{};
+	if ( (stat(fastaFileName.c_str(), &fastaStatus) != 0) || (stat(indexFileName.c_str(), &indexStatus) != 0) ) {
+		return false;
+	}
+	if (indexStatus.st_mtim.tv_sec != fastaStatus.st_mtim.tv_sec) {
+		return indexStatus.st_mtim.tv_sec > fastaStatus.st_mtim.tv_sec;
+	}
+	return indexStatus.st_mtim.tv_nsec >= fastaStatus.st_mtim.tv_nsec;
+}
+
+void FastaIndex::build_(const std::string &fastaFileName) {
+	// compressed files are indexed by uncompressed offsets, as with samtools
+	MappedFile mappedFile;
+	std::string decompressedFile;
+	const char *fileStart{nullptr};
+	size_t fileSize{0};
+	if (detectCompression(fastaFileName) == Compression::none) {
+		mappedFile = MappedFile(fastaFileName);
+		fileStart  = mappedFile.data();
+		fileSize   = mappedFile.size();
+		// the whole mapping is scanned
+		RunStatistics::countBytesRead(fileSize);
+	} else {
+		decompressedFile = readWholeFile(fastaFileName, 1);
+		fileStart        = decompressedFile.data();
+		fileSize         = decompressedFile.size();
+	}
+	const char *fileEnd = fileStart + fileSize;
+	if ( (fileSize == 0) || (*fileStart == '\n') ) {
+		throw std::string("ERROR: input FASTA file ") + fastaFileName + std::string(" empty in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (*fileStart != '>') {
+		throw std::string("ERROR: first line of a FASTA file must begin with '>' in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// once a line shorter than the first, or a blank line, is seen the record must end
+	bool recordMustEnd    = false;
+	const char *lineStart = fileStart;
+	while (lineStart < fileEnd) {
+		const auto *lineEnd = static_cast<const char*>( std::memchr( lineStart, '\n', static_cast<size_t>(fileEnd - lineStart) ) );
+		if (lineEnd == nullptr) {
+			lineEnd = fileEnd;
+		}
+		const char *contentEnd = lineEnd;
+		if ( (contentEnd > lineStart) && (*(contentEnd - 1) == '\r') ) {
+			--contentEnd;
+		}
+		if (*lineStart == '>') {
+			FaidxEntry newEntry;
+			newEntry.name = accession( std::string(lineStart + 1, contentEnd) );
+			newEntry.offset = std::min(static_cast<uint64_t>(lineEnd - fileStart) + 1, uint64_t{fileSize} );
+			entries_.emplace_back( std::move(newEntry) );
+			recordMustEnd = false;
+			lineStart     = lineEnd + 1;
+			continue;
+		}
+		const auto nBases = static_cast<uint64_t>(contentEnd - lineStart);
+		const auto nBytes = static_cast<uint64_t>(lineEnd - lineStart) + static_cast<uint64_t>(lineEnd < fileEnd);
+		FaidxEntry &currentEntry = entries_.back();
+		if (nBases == 0) {
+			recordMustEnd = true;
+			lineStart     = lineEnd + 1;
+			continue;
+		}
+		const bool irregularLine = recordMustEnd || ( (currentEntry.lineBases > 0) &&
+			( (nBases > currentEntry.lineBases) || ( (nBases == currentEntry.lineBases) && (nBytes != currentEntry.lineBytes) && (lineEnd < fileEnd) ) ) );
+		if (irregularLine) {
+			throw std::string("ERROR: record ") + currentEntry.name + std::string(" has lines of different lengths and cannot be indexed in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if (currentEntry.lineBases == 0) {
+			currentEntry.lineBases = nBases;
+			currentEntry.lineBytes = nBytes;
+		} else if (nBases < currentEntry.lineBases) {
+			recordMustEnd = true;
+		}
+		currentEntry.length += nBases;
+		lineStart            = lineEnd + 1;
+	}
+	nameIndex_.reserve( entries_.size() );
+	for (size_t iEntry = 0; iEntry < entries_.size(); ++iEntry) {
+		nameIndex_.emplace(entries_[iEntry].name, iEntry);
+	}
+}
+
+void FastaIndex::load_(const std::string &indexFileName) {
+	std::fstream inIndex;
+	inIndex.open(indexFileName, std::ios::in);
+	std::string eachLine;
+	while ( std::getline(inIndex, eachLine) ) {
+		if ( eachLine.empty() ) {
+			continue;
+		}
+		std::vector<std::string> fields;
+		size_t fieldStart = 0;
+		size_t tabPosition = 0;
+		while ( (tabPosition = eachLine.find('\t', fieldStart) ) != std::string::npos) {
+			fields.emplace_back( eachLine.substr(fieldStart, tabPosition - fieldStart) );
+			fieldStart = tabPosition + 1;
+		}
+		fields.emplace_back( eachLine.substr(fieldStart) );
+		constexpr size_t nFaiFields{5};
+		if (fields.size() < nFaiFields) {
+			throw std::string("ERROR: malformed line in index file ") + indexFileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		FaidxEntry newEntry;
+		try {
+			newEntry.name      = fields[0];
+			newEntry.length    = std::stoull(fields[1]);
+			newEntry.offset    = std::stoull(fields[2]);
+			newEntry.lineBases = std::stoull(fields[3]);
+			newEntry.lineBytes = std::stoull(fields[4]);
+		} catch(const std::exception &problem) {
+			throw std::string("ERROR: malformed number in index file ") + indexFileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		entries_.emplace_back( std::move(newEntry) );
+	}
+	inIndex.close();
+	RunStatistics::countBytesRead( fileSize(indexFileName) );
+	nameIndex_.reserve( entries_.size() );
+	for (size_t iEntry = 0; iEntry < entries_.size(); ++iEntry) {
+		nameIndex_.emplace(entries_[iEntry].name, iEntry);
+	}
+}
+
+IndexedFasta::IndexedFasta(const std::string &fastaFileName) {
+	const Compression compression = detectCompression(fastaFileName);
+	if (compression == Compression::gzip) {
+		throw std::string("ERROR: gzip-compressed file ") + fastaFileName + std::string(" cannot be indexed; compress it with bgzip instead in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	index_ = FastaIndex(fastaFileName);
+	if (compression == Compression::bgzf) {
+		bgzfReader_ = BgzfReader(fastaFileName);
+		return;
+	}
+	fastaDescriptor_ = open(fastaFileName.c_str(), O_RDONLY);
+	if (fastaDescriptor_ == -1) {
+		throw std::string("ERROR: cannot open file ") + fastaFileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+}
+
+IndexedFasta::~IndexedFasta() {
+	if (fastaDescriptor_ != -1) {
+		close(fastaDescriptor_);
+	}
+}
+
+IndexedFasta::IndexedFasta(IndexedFasta &&toMove) noexcept :
+		fastaDescriptor_{toMove.fastaDescriptor_}, index_{std::move(toMove.index_)}, bgzfReader_{std::move(toMove.bgzfReader_)},
+		headerIndex_{std::move(toMove.headerIndex_)} {
+	toMove.fastaDescriptor_ = -1;
+}
+
+IndexedFasta& IndexedFasta::operator=(IndexedFasta &&toMove) noexcept {
+	if (this != &toMove) {
+		if (fastaDescriptor_ != -1) {
+			close(fastaDescriptor_);
+		}
+		fastaDescriptor_        = toMove.fastaDescriptor_;
+		index_                  = std::move(toMove.index_);
+		bgzfReader_             = std::move(toMove.bgzfReader_);
+		headerIndex_            = std::move(toMove.headerIndex_);
+		toMove.fastaDescriptor_ = -1;
+	}
+	return *this;
+}
+
+std::string IndexedFasta::region(const std::string &name, const uint64_t &start, const uint64_t &end) const {
+	const size_t recordIndex = this->find_(name);
+	if ( recordIndex == index_.size() ) {
+		return std::string{};
+	}
+	const FaidxEntry &record = index_.entry(recordIndex);
+	const uint64_t firstBase = std::max(start, static_cast<uint64_t>(1)) - 1;
+	return this->readBases_( record, firstBase, std::min(end, record.length) );
+}
+
+bool IndexedFasta::fetch(const std::string &request, std::string &sequence) const {
+	sequence.clear();
+	size_t recordIndex = this->find_(request);
+	if ( recordIndex < index_.size() ) {
+		const FaidxEntry &record = index_.entry(recordIndex);
+		sequence = this->readBases_(record, 0, record.length);
+		return true;
+	}
+	const size_t colonPosition = request.rfind(':');
+	if (colonPosition == std::string::npos) {
+		return false;
+	}
+	recordIndex = this->find_( request.substr(0, colonPosition) );
+	if ( recordIndex == index_.size() ) {
+		return false;
+	}
+	std::string coordinates = request.substr(colonPosition + 1);
+	coordinates.erase(std::remove(coordinates.begin(), coordinates.end(), ','), coordinates.end());      // samtools allows thousands separators
+	const FaidxEntry &record = index_.entry(recordIndex);
+	uint64_t start{0};
+	uint64_t end{record.length};
+	try {
+		const size_t dashPosition = coordinates.find('-');
+		start = std::stoull( coordinates.substr(0, dashPosition) );
+		if ( (dashPosition != std::string::npos) && ( dashPosition + 1 < coordinates.size() ) ) {
+			end = std::stoull( coordinates.substr(dashPosition + 1) );
+		}
+	} catch(const std::exception &problem) {
+		return false;
+	}
+	// a region that starts past the sequence end, or ends before it starts, selects nothing
+	if ( ( start > record.length ) || ( end < std::max(start, static_cast<uint64_t>(1)) ) ) {
+		return false;
+	}
+	sequence = this->region(index_.entry(recordIndex).name, start, end);
+	return true;
+}
+
+std::unordered_map<std::string, std::string> IndexedFasta::subset(const std::vector<std::string> &requestList) const {
+	std::unordered_map<std::string, std::string> subset;
+	std::string sequence;
+	for (const auto &eachRequest : requestList) {
+		if ( ( subset.count(eachRequest) == 0 ) && this->fetch(eachRequest, sequence) ) {
+			subset.emplace(eachRequest, sequence);
+		}
+	}
+	return subset;
+}
+
+std::unordered_map<std::string, std::string> IndexedFasta::subset(const std::string &requestFileName) const {
+	std::fstream inSubsetList;
+	inSubsetList.open(requestFileName, std::ios::in);
+	std::vector<std::string> requests;
+	std::string eachLine;
+	while ( std::getline(inSubsetList, eachLine) ) {
+		if ( !eachLine.empty() ) {
+			requests.emplace_back( eachLine.substr( static_cast<size_t>(eachLine.at(0) == '>') ) );      // remove starting '>' if exists
+		}
+	}
+	inSubsetList.close();
+	RunStatistics::countBytesRead( fileSize(requestFileName) );
+	return this->subset(requests);
+}
+
+std::vector< std::pair<std::string, std::string> > IndexedFasta::orderedSubset(const std::vector<std::string> &requestList, const RecordOrder &order) const {
+	std::vector< std::pair<std::string, std::string> > subset;
+	std::unordered_set<std::string> requested;
+	std::vector<size_t> recordIndexes;
+	std::string sequence;
+	for (const auto &eachRequest : requestList) {
+		if ( requested.insert(eachRequest).second && this->fetch(eachRequest, sequence) ) {
+			subset.emplace_back( eachRequest, std::move(sequence) );
+			recordIndexes.push_back( this->recordIndex_(eachRequest) );
+		}
+	}
+	if (order == RecordOrder::list) {
+		return subset;
+	}
+	std::vector<size_t> sortOrder( subset.size() );
+	std::iota(sortOrder.begin(), sortOrder.end(), 0);
+	std::stable_sort(sortOrder.begin(), sortOrder.end(), [&recordIndexes](size_t first, size_t second){return recordIndexes[first] < recordIndexes[second];});
+	std::vector< std::pair<std::string, std::string> > sortedSubset;
+	sortedSubset.reserve( subset.size() );
+	for (const auto &eachIndex : sortOrder) {
+		sortedSubset.emplace_back( std::move(subset[eachIndex]) );
+	}
+	return sortedSubset;
+}
+
+std::vector< std::pair<std::string, std::string> > IndexedFasta::orderedSubset(const std::string &requestFileName, const RecordOrder &order) const {
+	std::fstream inSubsetList;
+	inSubsetList.open(requestFileName, std::ios::in);
+	std::vector<std::string> requests;
+	std::string eachLine;
+	while ( std::getline(inSubsetList, eachLine) ) {
+		if ( !eachLine.empty() ) {
+			requests.emplace_back( eachLine.substr( static_cast<size_t>(eachLine.at(0) == '>') ) );      // remove starting '>' if exists
+		}
+	}
+	inSubsetList.close();
+	RunStatistics::countBytesRead( fileSize(requestFileName) );
+	return this->orderedSubset(requests, order);
+}
+
+void IndexedFasta::buildHeaderIndex() {
+	// index names are only the first words, so the whole headers are read from the file
+	std::vector<std::string> names;
+	names.reserve( index_.size() );
+	for (size_t iEntry = 0; iEntry < index_.size(); ++iEntry) {
+		names.push_back( this->header_(iEntry) );
+	}
+	headerIndex_ = HeaderIndex(names);
+}
+
+std::vector<std::string> IndexedFasta::matchHeaders(const std::vector<std::string> &queries, const HeaderMatch &match) const {
+	if (match == HeaderMatch::whole) {
+		return queries;
+	}
+	if ( headerIndex_.size() != index_.size() ) {
+		throw std::string("ERROR: accession and prefix matching require the header index; call buildHeaderIndex() first in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return headerIndex_.expand(queries, match);
+}
+
+size_t IndexedFasta::find_(const std::string &name) const {
+	const size_t recordIndex = index_.find(name);
+	if ( recordIndex < index_.size() ) {
+		return recordIndex;
+	}
+	const std::string nameAccession{accession(name)};
+	if ( nameAccession.size() == name.size() ) {
+		return index_.size();
+	}
+	const size_t accessionIndex = index_.find(nameAccession);
+	if ( ( accessionIndex < index_.size() ) && (this->header_(accessionIndex) == name) ) {
+		return accessionIndex;
+	}
+	return index_.size();
+}
+
+std::string IndexedFasta::header_(const size_t &recordIndex) const {
+	uint64_t searchStart{0};
+	if (recordIndex > 0) {
+		const FaidxEntry &previous = index_.entry(recordIndex - 1);
+		searchStart                = previous.offset;
+		if ( (previous.length > 0) && (previous.lineBases > 0) ) {
+			const uint64_t nFullLines = (previous.length - 1) / previous.lineBases;
+			searchStart              += nFullLines * previous.lineBytes + previous.length - nFullLines * previous.lineBases;
+		}
+	}
+	const uint64_t sequenceStart = index_.entry(recordIndex).offset;
+	if (sequenceStart <= searchStart) {
+		return std::string{};
+	}
+	std::string headerBytes{this->readBytes_(searchStart, sequenceStart - searchStart)};
+	while ( !headerBytes.empty() && ( (headerBytes.back() == '\n') || (headerBytes.back() == '\r') ) ) {
+		headerBytes.pop_back();
+	}
+	// blank lines or line ends of the previous record may precede the header line
+	const size_t lastLineEnd = headerBytes.rfind('\n');
+	const size_t lineStart   = (lastLineEnd == std::string::npos ? 0 : lastLineEnd + 1);
+	if ( ( lineStart >= headerBytes.size() ) || (headerBytes[lineStart] != '>') ) {
+		return std::string{};
+	}
+	return headerBytes.substr(lineStart + 1);
+}
+
+std::string IndexedFasta::readBytes_(const uint64_t &byteStart, const uint64_t &nBytes) const {
+	std::string bytes(nBytes, '\0');
+	if (fastaDescriptor_ == -1) {
+		bytes.resize( bgzfReader_.read(byteStart, bytes.size(), &bytes[0]) );
+		return bytes;
+	}
+	size_t nRead{0};
+	while ( nRead < bytes.size() ) {
+		const ssize_t readResult = pread( fastaDescriptor_, &bytes[nRead], bytes.size() - nRead, static_cast<off_t>(byteStart + nRead) );
+		if (readResult < 0) {
+			throw std::string("ERROR: failed to read indexed FASTA file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if (readResult == 0) {
+			break;
+		}
+		nRead += static_cast<size_t>(readResult);
+	}
+	RunStatistics::countBytesRead(nRead);
+	bytes.resize(nRead);
+	return bytes;
+}
+
+size_t IndexedFasta::recordIndex_(const std::string &request) const {
+	const size_t recordIndex = this->find_(request);
+	if ( recordIndex < index_.size() ) {
+		return recordIndex;
+	}
+	const size_t colonPosition = request.rfind(':');
+	if (colonPosition == std::string::npos) {
+		return index_.size();
+	}
+	return this->find_( request.substr(0, colonPosition) );
+}
+
+std::string IndexedFasta::readBases_(const FaidxEntry &record, const uint64_t &firstBase, const uint64_t &lastBase) const {
+	if ( (lastBase <= firstBase) || (record.lineBases == 0) ) {
+		return std::string{};
+	}
+	const uint64_t lastIncluded = lastBase - 1;
+	const uint64_t byteStart    = record.offset + (firstBase / record.lineBases) * record.lineBytes + firstBase % record.lineBases;
+	const uint64_t byteEnd      = record.offset + (lastIncluded / record.lineBases) * record.lineBytes + lastIncluded % record.lineBases + 1;
+	std::string bases{this->readBytes_(byteStart, byteEnd - byteStart)};
+	if (bases.size() < byteEnd - byteStart) {
+		throw std::string("ERROR: failed to read indexed FASTA file (the index may be out of date) in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	bases.erase(std::remove_if(bases.begin(), bases.end(), [](char base){return (base == '\n') || (base == '\r');}), bases.end());
+	return bases;
+}
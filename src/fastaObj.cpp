@@ -28,52 +28,1086 @@
  */
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <fstream>
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <sstream>
+#include <memory>
+#include <array>
+#include <cstdio>
 
 #include "fastaObj.hpp"
+#include "scanner.hpp"
+#include "inputStream.hpp"
+#include "headerIndex.hpp"
+#include "headerSet.hpp"
+#include "utilities.hpp"
+#include "runStatistics.hpp"
+
+#include <sys/stat.h>
 
 using namespace BayesicSpace;
 
-Fasta::Fasta(const std::string &inFileName) {
-	std::fstream inFASTA;
-	std::string eachLine;
-	inFASTA.open(inFileName, std::ios::in);
-	std::getline(inFASTA, eachLine);
-	if ( eachLine.empty() ) {
+namespace {
+	/** \brief Record with the index of its destination list */
+	struct RoutedRecord {
+		/** \brief Header */
+		std::string header;
+		/** \brief Sequence */
+		std::string sequence;
+		/** \brief Destination list index */
+		size_t destinationIndex{0};
+	};
+
+	/** \brief Snapshot file identifier */
+	constexpr std::array<char, 8> snapshotMagic{ {'S', 'U', 'B', 'F', 'A', 'S', 'N', 'P'} };
+	/** \brief Snapshot format version; bump when the layout changes */
+	constexpr uint64_t snapshotVersion{1};
+	/** \brief Snapshot byte order marker, read back differently on a machine with another byte order */
+	constexpr uint64_t snapshotByteOrder{0x0102030405060708ULL};
+	/** \brief Number of 64-bit fields in the snapshot preamble after the identifier
+	 *
+	 * Version, byte order marker, source size, source modification seconds and nanoseconds, source checksum, number of records, header bytes, and sequence bytes.
+	 */
+	constexpr size_t snapshotFields{9};
+	/** \brief Snapshot preamble size in bytes */
+	constexpr size_t snapshotPreambleSize{sizeof(snapshotMagic) + snapshotFields * sizeof(uint64_t)};
+	/** \brief Number of bytes at each end of the source file included in the checksum */
+	constexpr size_t stampSampleSize{65536};
+
+	/** \brief Source file stamp
+	 *
+	 * Size, modification time seconds and nanoseconds, and a checksum of the first and last `stampSampleSize` bytes.
+	 * Reading the whole file for a checksum would cost as much as parsing it.
+	 *
+	 * \param[in] fileName file name
+	 * \return file stamp; all zeros if the file does not exist
+	 */
+	std::array<uint64_t, 4> sourceStamp(const std::string &fileName) {
+		std::array<uint64_t, 4> stamp{ {0, 0, 0, 0} };
+		struct stat fileStatus{};
+		if (stat(fileName.c_str(), &fileStatus) != 0) {
+			return stamp;
+		}
+		stamp[0] = static_cast<uint64_t>(fileStatus.st_size);
+		stamp[1] = static_cast<uint64_t>(fileStatus.st_mtim.tv_sec);
+		stamp[2] = static_cast<uint64_t>(fileStatus.st_mtim.tv_nsec);
+		std::fstream inFile(fileName, std::ios::in | std::ios::binary);
+		std::string sample(std::min(stampSampleSize, stamp[0]), '\0');
+		inFile.read( &sample[0], static_cast<std::streamsize>( sample.size() ) );
+		RunStatistics::countBytesRead( static_cast<uint64_t>( inFile.gcount() ) );
+		stamp[3] = HeaderSet::hashBytes( CharView{sample.data(), sample.size()} );
+		if (stamp[0] > sample.size()) {
+			inFile.seekg( static_cast<std::streamoff>( stamp[0] - sample.size() ) );
+			inFile.read( &sample[0], static_cast<std::streamsize>( sample.size() ) );
+			RunStatistics::countBytesRead( static_cast<uint64_t>( inFile.gcount() ) );
+			stamp[3] ^= HeaderSet::hashBytes( CharView{sample.data(), sample.size()} ) * 0x9E3779B97F4A7C15ULL;
+		}
+		return stamp;
+	}
+
+	/** \brief Read a 64-bit field
+	 *
+	 * \param[in] fieldStart pointer to the first byte of the field
+	 * \return field value
+	 */
+	uint64_t readField(const char *fieldStart) {
+		uint64_t value{0};
+		std::memcpy( &value, fieldStart, sizeof(value) );
+		return value;
+	}
+
+	/** \brief Read and check a snapshot preamble
+	 *
+	 * \param[in] snapshot mapped snapshot file
+	 * \param[in] stamp source file stamp
+	 * \param[out] fields preamble fields after the identifier
+	 * \return true if the snapshot is complete and matches the source stamp
+	 */
+	bool readSnapshotPreamble(const MappedFile &snapshot, const std::array<uint64_t, 4> &stamp, std::array<uint64_t, snapshotFields> &fields) {
+		if ( ( snapshot.size() < snapshotPreambleSize ) || (std::memcmp( snapshot.data(), snapshotMagic.data(), snapshotMagic.size() ) != 0) ) {
+			return false;
+		}
+		for (size_t iField = 0; iField < snapshotFields; ++iField) {
+			fields[iField] = readField(snapshot.data() + snapshotMagic.size() + iField * sizeof(uint64_t));
+		}
+		if ( (fields[0] != snapshotVersion) || (fields[1] != snapshotByteOrder) ||
+				(fields[2] != stamp[0]) || (fields[3] != stamp[1]) || (fields[4] != stamp[2]) || (fields[5] != stamp[3]) ) {
+			return false;
+		}
+		// header offsets, sequence spans, and header bytes padded to eight bytes precede the sequences; sizes are bounded first so the sum cannot overflow
+		const uint64_t nRecords = fields[6];
+		if ( ( nRecords > snapshot.size() / (3 * sizeof(uint64_t)) ) || ( fields[7] > snapshot.size() ) || ( fields[8] > snapshot.size() ) ) {
+			return false;
+		}
+		const uint64_t expectedSize = snapshotPreambleSize + (3 * nRecords + 1) * sizeof(uint64_t) + ( (fields[7] + 7) & ~uint64_t{7} ) + fields[8];
+		return snapshot.size() == expectedSize;
+	}
+
+	/** \brief Reject outputs that would overwrite inputs
+	 *
+	 * Outputs are truncated when opened, so an output that is also an input would be lost while it is read.
+	 *
+	 * \param[in] inFileNames input file names
+	 * \param[in] outFileNames output file names
+	 */
+	void checkOutputsAreNotInputs(const std::vector<std::string> &inFileNames, const std::vector<std::string> &outFileNames) {
+		for (const auto &eachOutput : outFileNames) {
+			for (const auto &eachInput : inFileNames) {
+				if ( sameFile(eachInput, eachOutput) ) {
+					throw std::string("ERROR: output file ") + eachOutput + std::string(" is the input file ") + eachInput + std::string(" in ")
+						+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+				}
+			}
+		}
+	}
+
+	/** \brief Matched record with the list position of its entry */
+	struct ListedRecord {
+		/** \brief Header */
+		std::string header;
+		/** \brief Sequence */
+		std::string sequence;
+		/** \brief Position of the first matching list entry */
+		size_t listPosition{0};
+	};
+
+	/** \brief Run a task on each shard with a shared work pool
+	 *
+	 * Shards are handed out largest first from a shared counter, so a thread that finishes early takes the next shard in line
+	 * and a few large shards do not leave the other threads idle at the end. The first exception stops the hand-out and is rethrown once all threads finish.
+	 *
+	 * \tparam TaskT callable type, taking the shard index
+	 * \param[in] shardSizes shard sizes used for scheduling
+	 * \param[in] nThreads number of threads
+	 * \param[in] task task to run on each shard
+	 */
+	template <typename TaskT>
+	void runShards(const std::vector<size_t> &shardSizes, const size_t &nThreads, TaskT task) {
+		std::vector<size_t> schedule( shardSizes.size() );
+		for (size_t iShard = 0; iShard < schedule.size(); ++iShard) {
+			schedule[iShard] = iShard;
+		}
+		std::stable_sort(schedule.begin(), schedule.end(), [&shardSizes](const size_t &first, const size_t &second){
+			return shardSizes[first] > shardSizes[second];
+		});
+		std::atomic<size_t> nextShard{0};
+		std::mutex errorMutex;
+		std::exception_ptr shardError{nullptr};
+		auto worker = [&schedule, &nextShard, &errorMutex, &shardError, &task]{
+			size_t scheduleIndex = nextShard.fetch_add(1);
+			while ( scheduleIndex < schedule.size() ) {
+				try {
+					task(schedule[scheduleIndex]);
+				} catch(...) {
+					std::lock_guard<std::mutex> errorLock(errorMutex);
+					if (shardError == nullptr) {
+						shardError = std::current_exception();
+					}
+					nextShard.store( schedule.size() );
+				}
+				scheduleIndex = nextShard.fetch_add(1);
+			}
+		};
+		const size_t nWorkers = std::max( std::min( nThreads, schedule.size() ), static_cast<size_t>(1) );
+		std::vector<std::thread> workers;
+		workers.reserve(nWorkers - 1);
+		for (size_t iWorker = 1; iWorker < nWorkers; ++iWorker) {
+			workers.emplace_back(worker);
+		}
+		worker();                                                                                       // the calling thread is one of the workers
+		for (auto &eachWorker : workers) {
+			eachWorker.join();
+		}
+		if (shardError != nullptr) {
+			std::rethrow_exception(shardError);
+		}
+	}
+
+	/** \brief Bounded record queue
+	 *
+	 * Passes records from one producer to one consumer thread. The producer blocks while the queued sequences exceed the byte limit.
+	 */
+	class RecordQueue {
+	public:
+		/** \brief Constructor with the byte limit
+		 *
+		 * \param[in] maxBytes maximal number of queued sequence bytes; one record is always accepted
+		 */
+		explicit RecordQueue(const size_t &maxBytes) : maxBytes_{maxBytes} {};
+		/** \brief Add a record
+		 *
+		 * \param[in] record record to add
+		 */
+		void push(RoutedRecord &&record) {
+			std::unique_lock<std::mutex> queueLock(mutex_);
+			notFull_.wait(queueLock, [this]{return records_.empty() || (queuedBytes_ < maxBytes_);});
+			queuedBytes_ += record.sequence.size();
+			records_.emplace_back( std::move(record) );
+			notEmpty_.notify_one();
+		};
+		/** \brief Remove a record
+		 *
+		 * Blocks until a record is available or the queue is closed.
+		 *
+		 * \param[out] record removed record
+		 * \return false if the queue is closed and empty
+		 */
+		bool pop(RoutedRecord &record) {
+			std::unique_lock<std::mutex> queueLock(mutex_);
+			notEmpty_.wait(queueLock, [this]{return !records_.empty() || closed_;});
+			if ( records_.empty() ) {
+				return false;
+			}
+			record        = std::move( records_.front() );
+			queuedBytes_ -= record.sequence.size();
+			records_.pop_front();
+			notFull_.notify_one();
+			return true;
+		};
+		/** \brief Signal that no more records will be added */
+		void close() {
+			std::lock_guard<std::mutex> queueLock(mutex_);
+			closed_ = true;
+			notEmpty_.notify_one();
+		};
+	private:
+		/** \brief Queue lock */
+		std::mutex mutex_;
+		/** \brief Signals that a record was removed */
+		std::condition_variable notFull_;
+		/** \brief Signals that a record was added or the queue closed */
+		std::condition_variable notEmpty_;
+		/** \brief Queued records */
+		std::deque<RoutedRecord> records_;
+		/** \brief Queued sequence bytes */
+		size_t queuedBytes_{0};
+		/** \brief Maximal number of queued sequence bytes */
+		size_t maxBytes_;
+		/** \brief True if no more records will be added */
+		bool closed_{false};
+	};
+}
+
+Fasta::Fasta(const std::string &inFileName) : Fasta(inFileName, 1) {
+}
+
+Fasta::Fasta(const std::string &inFileName, const size_t &nThreads) : Fasta(inFileName, nThreads, false) {
+}
+
+Fasta::Fasta(const std::string &inFileName, const size_t &nThreads, const bool &packSequences) : Fasta(inFileName, nThreads, packSequences, false) {
+}
+
+Fasta::Fasta(const std::string &inFileName, const size_t &nThreads, const bool &packSequences, const bool &useSnapshot) {
+	if (!useSnapshot || packSequences) {
+		this->loadFile_(inFileName, nThreads, packSequences);
+		return;
+	}
+	if ( this->loadSnapshot_(inFileName) ) {
+		return;
+	}
+	// the stamp is taken before parsing, so that a file changed while it is parsed does not match the snapshot
+	const std::array<uint64_t, 4> stamp{sourceStamp(inFileName)};
+	this->loadFile_(inFileName, nThreads, packSequences);
+	this->saveSnapshot_(inFileName, stamp);
+}
+
+bool Fasta::snapshotIsCurrent(const std::string &inFileName) {
+	const std::string snapshotName{snapshotFileName(inFileName)};
+	struct stat snapshotStatus{};
+	if (stat(snapshotName.c_str(), &snapshotStatus) != 0) {
+		return false;
+	}
+	std::array<uint64_t, snapshotFields> fields{};
+	return readSnapshotPreamble(MappedFile(snapshotName), sourceStamp(inFileName), fields);
+}
+
+void Fasta::loadFile_(const std::string &inFileName, const size_t &nThreads, const bool &packSequences) {
+	// compressed files are decompressed into memory; plain files are mapped
+	MappedFile mappedFile;
+	std::string decompressedFile;
+	const char *fileStart{nullptr};
+	size_t fileSize{0};
+	if (detectCompression(inFileName) == Compression::none) {
+		mappedFile = MappedFile(inFileName);
+		fileStart  = mappedFile.data();
+		fileSize   = mappedFile.size();
+		// the whole mapping is scanned
+		RunStatistics::countBytesRead(fileSize);
+	} else {
+		decompressedFile = readWholeFile(inFileName, nThreads);
+		fileStart        = decompressedFile.data();
+		fileSize         = decompressedFile.size();
+	}
+	if ( (fileSize == 0) || (*fileStart == '\n') ) {
 		throw std::string("ERROR: input FASTA file ") + inFileName + std::string(" empty in ")
 										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	if (eachLine.front() != '>') {
+	if (*fileStart != '>') {
 		throw std::string("ERROR: first line of a FASTA file must begin with '>' in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
 	}
-	std::string currentHeader = eachLine.substr(1); // remove the starting '>'
-	std::string sequence;
-	while ( std::getline(inFASTA, eachLine) ) {
-		if (eachLine.front() == '>') {
-			fastaData_.emplace(currentHeader, sequence);
-			currentHeader = eachLine.substr(1);
-			sequence.clear();
+	// there are never more chunks than bytes, so every chunk after the first starts past the first byte
+	const size_t nChunks = std::max(std::min(nThreads, fileSize), static_cast<size_t>(1));
+	// chunk boundaries are moved forward to the start of the next header line
+	std::vector<size_t> chunkStarts{0};
+	for (size_t iChunk = 1; iChunk < nChunks; ++iChunk) {
+		size_t boundary = std::max( {iChunk * fileSize / nChunks, chunkStarts.back(), static_cast<size_t>(1)} );
+		while (boundary < fileSize) {
+			if ( (fileStart[boundary] == '>') && (fileStart[boundary - 1] == '\n') ) {
+				break;
+			}
+			const auto *nextLineBreak = static_cast<const char*>( std::memchr( fileStart + boundary, '\n', fileSize - boundary ) );
+			boundary = (nextLineBreak == nullptr ? fileSize : static_cast<size_t>(nextLineBreak - fileStart) + 1);
+		}
+		chunkStarts.push_back(boundary);
+	}
+	chunkStarts.push_back( fileSize );
+	// each chunk strips its sequences into the arena starting at the chunk's own file offset;
+	// stripping headers and line breaks never makes a chunk longer, so chunks cannot overlap
+	std::shared_ptr<char> arenaOwner;
+	if (!packSequences) {
+		arenaOwner = std::shared_ptr<char>( new char[fileSize], std::default_delete<char[]>() );
+	}
+	char *arena = arenaOwner.get();
+	std::vector< std::vector< std::pair<std::string, SequenceSpan> > > chunkSpans(nChunks);
+	std::vector< std::vector< std::pair<std::string, PackedSequence> > > chunkPacked(nChunks);
+	std::vector<size_t> chunkArenaEnds( chunkStarts.cbegin(), chunkStarts.cend() - 1 );
+	auto parseChunk = [&chunkStarts, &chunkSpans, &chunkPacked, &chunkArenaEnds, fileStart, arena, packSequences](const size_t &iChunk) {
+		const char *rangeStart = fileStart + chunkStarts[iChunk];
+		const char *rangeEnd   = fileStart + chunkStarts[iChunk + 1];
+		if (packSequences) {
+			std::string sequence;
+			std::vector< std::pair<std::string, PackedSequence> > &records = chunkPacked[iChunk];
+			auto storePacked = [&sequence, &records](std::string &&header, const FastaScanner &scanner, const char *sequenceStart, const char *sequenceEnd) {
+				sequence.resize( static_cast<size_t>(sequenceEnd - sequenceStart) );
+				sequence.resize( scanner.copyStripped(sequenceStart, sequenceEnd, &sequence[0]) );
+				records.emplace_back( std::move(header), PackedSequence(sequence) );
+			};
+			parseRange_(rangeStart, rangeEnd, storePacked);
+			return;
+		}
+		size_t &arenaEnd = chunkArenaEnds[iChunk];
+		std::vector< std::pair<std::string, SequenceSpan> > &records = chunkSpans[iChunk];
+		auto storeSpan = [arena, &arenaEnd, &records](std::string &&header, const FastaScanner &scanner, const char *sequenceStart, const char *sequenceEnd) {
+			SequenceSpan span;
+			span.offset = arenaEnd;
+			span.length = scanner.copyStripped(sequenceStart, sequenceEnd, arena + arenaEnd);
+			arenaEnd   += span.length;
+			records.emplace_back(std::move(header), span);
+		};
+		parseRange_(rangeStart, rangeEnd, storeSpan);
+	};
+	std::vector<std::thread> chunkThreads;
+	chunkThreads.reserve(nChunks - 1);
+	for (size_t iChunk = 1; iChunk < nChunks; ++iChunk) {
+		chunkThreads.emplace_back(parseChunk, iChunk);
+	}
+	parseChunk(0);
+	for (auto &eachThread : chunkThreads) {
+		eachThread.join();
+	}
+	size_t nRecords{0};
+	for (size_t iChunk = 0; iChunk < nChunks; ++iChunk) {
+		nRecords += chunkSpans[iChunk].size() + chunkPacked[iChunk].size();
+	}
+	recordIndex_.reserve(nRecords);
+	recordOrder_.reserve(nRecords);
+	// merging in file order keeps the first of duplicated headers, as in the single-threaded constructor;
+	// chunks are moved down to close the gaps between them, but the sequences of dropped duplicates stay in the arena
+	size_t arenaSize{0};
+	for (size_t iChunk = 0; iChunk < nChunks; ++iChunk) {
+		if (packSequences) {
+			packedSequences_.reserve(nRecords);
+			for (auto &eachRecord : chunkPacked[iChunk]) {
+				if ( recordIndex_.emplace( eachRecord.first, recordOrder_.size() ).second ) {
+					recordOrder_.push_back( std::move(eachRecord.first) );
+					packedSequences_.push_back( std::move(eachRecord.second) );
+				}
+			}
+			chunkPacked[iChunk].clear();
 			continue;
 		}
-		sequence.append(eachLine);
+		sequenceSpans_.reserve(nRecords);
+		const size_t chunkLength = chunkArenaEnds[iChunk] - chunkStarts[iChunk];
+		if ( (chunkLength > 0) && (arenaSize < chunkStarts[iChunk]) ) {
+			std::memmove(arena + arenaSize, arena + chunkStarts[iChunk], chunkLength);
+		}
+		for (auto &eachRecord : chunkSpans[iChunk]) {
+			if ( recordIndex_.emplace( eachRecord.first, recordOrder_.size() ).second ) {
+				eachRecord.second.offset = eachRecord.second.offset - chunkStarts[iChunk] + arenaSize;
+				recordOrder_.push_back( std::move(eachRecord.first) );
+				sequenceSpans_.push_back(eachRecord.second);
+			}
+		}
+		arenaSize += chunkLength;
+		chunkSpans[iChunk].clear();
+	}
+	sequenceArena_ = std::move(arenaOwner);
+}
+
+bool Fasta::loadSnapshot_(const std::string &inFileName) {
+	const std::string snapshotName{snapshotFileName(inFileName)};
+	struct stat snapshotStatus{};
+	if (stat(snapshotName.c_str(), &snapshotStatus) != 0) {
+		return false;
+	}
+	auto snapshot = std::make_shared<MappedFile>(snapshotName);
+	std::array<uint64_t, snapshotFields> fields{};
+	if ( !readSnapshotPreamble(*snapshot, sourceStamp(inFileName), fields) ) {
+		return false;
+	}
+	const size_t nRecords      = fields[6];
+	const uint64_t nHeaderBytes   = fields[7];
+	const uint64_t nSequenceBytes = fields[8];
+	const char *headerOffsets = snapshot->data() + snapshotPreambleSize;
+	const char *spans         = headerOffsets + (nRecords + 1) * sizeof(uint64_t);
+	const char *headerBytes   = spans + 2 * nRecords * sizeof(uint64_t);
+	const char *sequenceBytes = headerBytes + ( (fields[7] + 7) & ~uint64_t{7} );
+	recordOrder_.reserve(nRecords);
+	recordIndex_.reserve(nRecords);
+	sequenceSpans_.resize(nRecords);
+	for (size_t iRecord = 0; iRecord < nRecords; ++iRecord) {
+		const uint64_t headerStart = readField(headerOffsets + iRecord * sizeof(uint64_t));
+		const uint64_t headerEnd   = readField(headerOffsets + (iRecord + 1) * sizeof(uint64_t));
+		if ( (headerStart > headerEnd) || (headerEnd > nHeaderBytes) ) {
+			throw std::string("ERROR: header ") + std::to_string(iRecord) + std::string(" is outside the header table of snapshot ") + snapshotName
+				+ std::string(" in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		recordOrder_.emplace_back(headerBytes + headerStart, headerEnd - headerStart);
+		recordIndex_.emplace(recordOrder_.back(), iRecord);
+		sequenceSpans_[iRecord].offset = readField(spans + 2 * iRecord * sizeof(uint64_t));
+		sequenceSpans_[iRecord].length = readField(spans + (2 * iRecord + 1) * sizeof(uint64_t));
+		if ( (sequenceSpans_[iRecord].offset > nSequenceBytes) || (sequenceSpans_[iRecord].length > nSequenceBytes - sequenceSpans_[iRecord].offset) ) {
+			throw std::string("ERROR: sequence ") + std::to_string(iRecord) + std::string(" is outside the sequences of snapshot ") + snapshotName
+				+ std::string(" in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+	}
+	// the arena points into the mapping and keeps it alive; sequence pages are read only when used
+	sequenceArena_ = std::shared_ptr<const char>(snapshot, sequenceBytes);
+	snapshotArena_ = true;
+	RunStatistics::countBytesRead( static_cast<uint64_t>(sequenceBytes - snapshot->data()) );
+	return true;
+}
+
+void Fasta::saveSnapshot_(const std::string &inFileName, const std::array<uint64_t, 4> &sourceStamp) const {
+	const std::string snapshotName{snapshotFileName(inFileName)};
+	const std::string temporaryName{snapshotName + ".tmp"};
+	std::fstream outSnapshot(temporaryName, std::ios::out | std::ios::trunc | std::ios::binary);
+	if ( !outSnapshot.is_open() ) {
+		return;
+	}
+	std::vector<uint64_t> headerOffsets{0};
+	headerOffsets.reserve(recordOrder_.size() + 1);
+	for (const auto &eachHeader : recordOrder_) {
+		headerOffsets.push_back( headerOffsets.back() + eachHeader.size() );
+	}
+	// sequences are written compactly in record order, leaving out those of dropped duplicates
+	std::vector<uint64_t> spans;
+	spans.reserve(2 * sequenceSpans_.size());
+	uint64_t sequenceBytes{0};
+	for (const auto &eachSpan : sequenceSpans_) {
+		spans.push_back(sequenceBytes);
+		spans.push_back(eachSpan.length);
+		sequenceBytes += eachSpan.length;
+	}
+	const std::array<uint64_t, snapshotFields> fields{
+		{snapshotVersion, snapshotByteOrder, sourceStamp[0], sourceStamp[1], sourceStamp[2], sourceStamp[3], recordOrder_.size(), headerOffsets.back(), sequenceBytes}
+	};
+	outSnapshot.write( snapshotMagic.data(), static_cast<std::streamsize>( snapshotMagic.size() ) );
+	outSnapshot.write( reinterpret_cast<const char*>( fields.data() ), static_cast<std::streamsize>( fields.size() * sizeof(uint64_t) ) );
+	outSnapshot.write( reinterpret_cast<const char*>( headerOffsets.data() ), static_cast<std::streamsize>( headerOffsets.size() * sizeof(uint64_t) ) );
+	outSnapshot.write( reinterpret_cast<const char*>( spans.data() ), static_cast<std::streamsize>( spans.size() * sizeof(uint64_t) ) );
+	for (const auto &eachHeader : recordOrder_) {
+		outSnapshot.write( eachHeader.data(), static_cast<std::streamsize>( eachHeader.size() ) );
+	}
+	const std::array<char, 8> padding{};
+	outSnapshot.write( padding.data(), static_cast<std::streamsize>( ( 8 - headerOffsets.back() % 8 ) % 8 ) );
+	for (const auto &eachSpan : sequenceSpans_) {
+		outSnapshot.write( sequenceArena_.get() + eachSpan.offset, static_cast<std::streamsize>(eachSpan.length) );
+	}
+	const std::streamoff nSnapshotBytes = outSnapshot.tellp();
+	outSnapshot.close();
+	if (nSnapshotBytes > 0) {
+		RunStatistics::countBytesWritten( static_cast<uint64_t>(nSnapshotBytes) );
+	}
+	if ( outSnapshot.fail() || (std::rename( temporaryName.c_str(), snapshotName.c_str() ) != 0) ) {
+		std::remove( temporaryName.c_str() );
+	}
+}
+
+size_t Fasta::find(const std::string &header) const {
+	auto search = recordIndex_.find(header);
+	return ( search == recordIndex_.end() ? recordOrder_.size() : search->second );
+}
+
+CharView Fasta::header(const size_t &recordIndex) const {
+	const std::string &header = recordOrder_.at(recordIndex);
+	return CharView{header.data(), header.size()};
+}
+
+CharView Fasta::sequenceView(const size_t &recordIndex) const {
+	if ( this->isPacked() ) {
+		throw std::string("ERROR: packed sequences cannot be viewed; use sequence() instead in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const SequenceSpan &span = sequenceSpans_.at(recordIndex);
+	if (snapshotArena_) {
+		RunStatistics::countBytesRead(span.length);
+	}
+	return CharView{sequenceArena_.get() + span.offset, span.length};
+}
+
+std::string Fasta::sequence(const size_t &recordIndex) const {
+	if ( this->isPacked() ) {
+		return packedSequences_.at(recordIndex).unpack();
+	}
+	return this->sequenceView(recordIndex).str();
+}
+
+std::vector<size_t> Fasta::subsetIndexes(const std::vector<std::string> &headerList, const RecordOrder &order) const {
+	std::vector<size_t> indexes;
+	indexes.reserve( std::min( headerList.size(), recordOrder_.size() ) );
+	if (order == RecordOrder::list) {
+		std::vector<bool> included(recordOrder_.size(), false);
+		for (const auto &eachHeader : headerList) {
+			const size_t recordIndex = this->find(eachHeader);
+			if ( (recordIndex < recordOrder_.size() ) && !included[recordIndex] ) {
+				included[recordIndex] = true;
+				indexes.push_back(recordIndex);
+			}
+		}
+		return indexes;
+	}
+	for (const auto &eachHeader : headerList) {
+		const size_t recordIndex = this->find(eachHeader);
+		if ( recordIndex < recordOrder_.size() ) {
+			indexes.push_back(recordIndex);
+		}
 	}
-	fastaData_.emplace(currentHeader, sequence);
-	inFASTA.close();
+	std::sort( indexes.begin(), indexes.end() );
+	indexes.erase( std::unique( indexes.begin(), indexes.end() ), indexes.end() );
+	return indexes;
 }
 
 std::unordered_map<std::string, std::string> Fasta::subset(const std::vector<std::string> &headerList) const {
+	std::unordered_map<std::string, std::string> subset;
+	for ( const auto &eachIndex : this->subsetIndexes(headerList, RecordOrder::list) ) {
+		subset.emplace( recordOrder_[eachIndex], this->sequence(eachIndex) );
+	}
+	return subset;
+}
+
+std::unordered_map<std::string, std::string> Fasta::subset(const std::string &headerFileName) const {
+	std::unordered_map<std::string, std::string> subset;
+	for ( const auto &eachIndex : this->subsetIndexes(HeaderSet(headerFileName), RecordOrder::input) ) {
+		subset.emplace( recordOrder_[eachIndex], this->sequence(eachIndex) );
+	}
+	return subset;
+}
+
+std::vector<size_t> Fasta::subsetIndexes(const HeaderSet &headerSet, const RecordOrder &order) const {
+	std::vector<size_t> indexes;
+	// in input order with a list longer than the file, each record is looked up in the list instead of the other way round
+	if ( (order == RecordOrder::input) && ( headerSet.size() > recordOrder_.size() ) ) {
+		for (size_t iRecord = 0; iRecord < recordOrder_.size(); ++iRecord) {
+			if ( headerSet.find(recordOrder_[iRecord]) < headerSet.size() ) {
+				indexes.push_back(iRecord);
+			}
+		}
+		return indexes;
+	}
+	// set entries are unique, so no record is found twice
+	std::string header;
+	for (size_t iEntry = 0; iEntry < headerSet.size(); ++iEntry) {
+		const CharView entry{headerSet.entry(iEntry)};
+		header.assign(entry.start, entry.length);
+		const size_t recordIndex = this->find(header);
+		if ( recordIndex < recordOrder_.size() ) {
+			indexes.push_back(recordIndex);
+		}
+	}
+	if (order == RecordOrder::input) {
+		std::sort( indexes.begin(), indexes.end() );
+	}
+	return indexes;
+}
+
+std::vector< std::pair<std::string, std::string> > Fasta::orderedSubset(const std::vector<std::string> &headerList, const RecordOrder &order) const {
+	std::vector< std::pair<std::string, std::string> > subset;
+	for ( const auto &eachIndex : this->subsetIndexes(headerList, order) ) {
+		subset.emplace_back( recordOrder_[eachIndex], this->sequence(eachIndex) );
+	}
+	return subset;
+}
+
+std::vector< std::pair<std::string, std::string> > Fasta::orderedSubset(const std::string &headerFileName, const RecordOrder &order) const {
+	std::vector< std::pair<std::string, std::string> > subset;
+	for ( const auto &eachIndex : this->subsetIndexes(HeaderSet(headerFileName), order) ) {
+		subset.emplace_back( recordOrder_[eachIndex], this->sequence(eachIndex) );
+	}
+	return subset;
+}
+
+std::vector<std::string> Fasta::matchHeaders(const std::vector<std::string> &queries, const HeaderMatch &match) const {
+	if (match == HeaderMatch::whole) {
+		return queries;
+	}
+	if ( headerIndex_.size() != recordOrder_.size() ) {
+		throw std::string("ERROR: accession and prefix matching require the header index; call buildHeaderIndex() first in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return headerIndex_.expand(queries, match);
+}
+
+template <typename RecordSinkT>
+void Fasta::parseRange_(const char *rangeStart, const char *rangeEnd, RecordSinkT &storeRecord) {
+	const FastaScanner scanner;
+	const char *recordStart = rangeStart;
+	while (recordStart < rangeEnd) {
+		const auto *lineFeed = static_cast<const char*>( std::memchr( recordStart, '\n', static_cast<size_t>(rangeEnd - recordStart) ) );
+		if (lineFeed == nullptr) {                                                                      // header on the last line
+			lineFeed = rangeEnd;
+		}
+		const char *headerEnd = lineFeed;
+		if ( (headerEnd > recordStart + 1) && (*(headerEnd - 1) == '\r') ) {
+			--headerEnd;
+		}
+		// searching from the line feed that ends the header catches records with empty sequences
+		const char *sequenceStart = (lineFeed == rangeEnd ? rangeEnd : lineFeed + 1);
+		const char *nextRecord    = scanner.findRecordStart(lineFeed, rangeEnd);
+		storeRecord(std::string(recordStart + 1, headerEnd), scanner, sequenceStart, nextRecord);
+		recordStart = nextRecord;
+	}
+}
+
+FastaFilter::FastaFilter(const std::vector<std::string> &headerList) : FastaFilter(headerList, HeaderMatch::whole) {
+}
+
+FastaFilter::FastaFilter(const std::string &headerFileName) : FastaFilter(headerFileName, HeaderMatch::whole) {
+}
+
+FastaFilter::FastaFilter(const std::vector<std::string> &headerList, const HeaderMatch &match) : headers_{headerList}, match_{match} {
+	this->findPrefixLengths_();
+}
+
+FastaFilter::FastaFilter(const std::string &headerFileName, const HeaderMatch &match) : headers_{headerFileName}, match_{match} {
+	this->findPrefixLengths_();
+}
+
+size_t FastaFilter::filter(const std::string &inFileName, const std::string &outFileName, const size_t &nThreads, const RecordOrder &order, const OutputFormat &format,
+						RunStatistics &statistics) const {
+	checkOutputsAreNotInputs(std::vector<std::string>{inFileName}, std::vector<std::string>{outFileName});
+	// reading, parsing, and writing run on separate threads
+	RecordReader fastaReader(inFileName, nThreads, true);
+	FastaWriter outFASTA(outFileName, format, true);
+	// headers already written; needed to keep only the first of duplicated records, as in Fasta
+	std::unordered_set<std::string> written;
+	// records held for header list order, indexed by the position of the list entry that matches them
+	std::vector< std::vector< std::pair<std::string, std::string> > > heldRecords(order == RecordOrder::list ? headers_.size() : 0);
+	std::string currentHeader;
+	std::string sequence;
+	uint64_t nParsed{0};
+	while ( fastaReader.nextHeader(currentHeader) ) {
+		++nParsed;
+		const size_t listPosition = this->listPosition_(currentHeader);
+		if ( ( listPosition < headers_.size() ) && written.insert(currentHeader).second ) {
+			fastaReader.readSequence(sequence);
+			if (order == RecordOrder::list) {
+				heldRecords[listPosition].emplace_back( currentHeader, std::move(sequence) );
+				continue;
+			}
+			outFASTA.write(currentHeader, sequence);
+			continue;
+		}
+		fastaReader.skipSequence();                                                                     // sequences of records not in the list are never copied
+	}
+	for (const auto &eachEntry : heldRecords) {
+		for (const auto &eachRecord : eachEntry) {
+			outFASTA.write(eachRecord.first, eachRecord.second);
+		}
+	}
+	outFASTA.close();
+	statistics.addCount("records parsed", nParsed);
+	statistics.addCount("records matched", written.size());
+	statistics.setValue( "header table load factor", headers_.loadFactor() );
+	return written.size();
+}
+
+size_t FastaFilter::filterShards(const std::vector<std::string> &inFileNames, const std::vector<std::string> &outFileNames, const size_t &nThreads,
+						const RecordOrder &order, const OutputFormat &format, RunStatistics &statistics) const {
+	if ( ( outFileNames.size() != 1 ) && ( outFileNames.size() != inFileNames.size() ) ) {
+		throw std::string("ERROR: there must be one output file or one per input file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if ( std::unordered_set<std::string>( outFileNames.begin(), outFileNames.end() ).size() != outFileNames.size() ) {
+		throw std::string("ERROR: output file names must be distinct in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	checkOutputsAreNotInputs(inFileNames, outFileNames);
+	statistics.addCount( "shards", inFileNames.size() );
+	if ( ( inFileNames.size() == 1 ) && ( outFileNames.size() == 1 ) ) {
+		return this->filter(inFileNames.front(), outFileNames.front(), nThreads, order, format, statistics);
+	}
+	std::vector<size_t> shardSizes;
+	shardSizes.reserve( inFileNames.size() );
+	for (const auto &eachFileName : inFileNames) {
+		shardSizes.push_back( fileSize(eachFileName) );
+	}
+	std::vector<uint64_t> nParsed(inFileNames.size(), 0);
+	// each shard goes to its own output file, with the same rules as a single file
+	if ( outFileNames.size() == inFileNames.size() ) {
+		std::vector<uint64_t> nMatched(inFileNames.size(), 0);
+		OutputFormat shardFormat{format};
+		shardFormat.nThreads = 1;
+		runShards(shardSizes, nThreads, [this, &inFileNames, &outFileNames, &order, &shardFormat, &nParsed, &nMatched](const size_t &shardIndex){
+			RunStatistics shardStatistics(true);
+			nMatched[shardIndex] = this->filter(inFileNames[shardIndex], outFileNames[shardIndex], 1, order, shardFormat, shardStatistics);
+			nParsed[shardIndex]  = shardStatistics.count("records parsed");
+		});
+		uint64_t nWritten{0};
+		for (size_t iShard = 0; iShard < inFileNames.size(); ++iShard) {
+			statistics.addCount("records parsed", nParsed[iShard]);
+			nWritten += nMatched[iShard];
+		}
+		statistics.addCount("records matched", nWritten);
+		statistics.setValue( "header table load factor", headers_.loadFactor() );
+		return nWritten;
+	}
+	// the matches of a shard are written, and freed, once all earlier shards in the input list are written, so the output does not depend on which thread finishes first
+	FastaWriter outFASTA(outFileNames.front(), format, true);
+	std::vector< std::vector<ListedRecord> > shardRecords( inFileNames.size() );
+	std::vector<bool> shardDone(inFileNames.size(), false);
+	size_t nextShard{0};
+	std::mutex outputMutex;
+	// a header found in several shards is written once, from the first shard in the input list
+	std::unordered_set<std::string> written;
+	// in header list order a later shard may match an earlier list entry, so records are held until all shards are read
+	std::vector<ListedRecord> heldRecords;
+	runShards(shardSizes, nThreads, [this, &inFileNames, &order, &nParsed, &shardRecords, &shardDone, &nextShard, &outputMutex, &written, &heldRecords, &outFASTA](const size_t &shardIndex){
+		RecordReader fastaReader(inFileNames[shardIndex], 1, true);
+		std::unordered_set<std::string> matched;
+		std::vector<ListedRecord> records;
+		ListedRecord record;
+		while ( fastaReader.nextHeader(record.header) ) {
+			++nParsed[shardIndex];
+			record.listPosition = this->listPosition_(record.header);
+			if ( ( record.listPosition < headers_.size() ) && matched.insert(record.header).second ) {
+				fastaReader.readSequence(record.sequence);
+				records.push_back( std::move(record) );
+				continue;
+			}
+			fastaReader.skipSequence();
+		}
+		std::lock_guard<std::mutex> outputLock(outputMutex);
+		shardRecords[shardIndex] = std::move(records);
+		shardDone[shardIndex]    = true;
+		while ( ( nextShard < shardDone.size() ) && shardDone[nextShard] ) {
+			for (auto &eachRecord : shardRecords[nextShard]) {
+				if ( !written.insert(eachRecord.header).second ) {
+					continue;
+				}
+				if (order == RecordOrder::list) {
+					heldRecords.push_back( std::move(eachRecord) );
+					continue;
+				}
+				outFASTA.write(eachRecord.header, eachRecord.sequence);
+			}
+			std::vector<ListedRecord>().swap(shardRecords[nextShard]);
+			++nextShard;
+		}
+	});
+	for (const auto &eachCount : nParsed) {
+		statistics.addCount("records parsed", eachCount);
+	}
+	std::stable_sort(heldRecords.begin(), heldRecords.end(), [](const ListedRecord &first, const ListedRecord &second){
+		return first.listPosition < second.listPosition;
+	});
+	for (const auto &eachRecord : heldRecords) {
+		outFASTA.write(eachRecord.header, eachRecord.sequence);
+	}
+	outFASTA.close();
+	statistics.addCount("records matched", written.size());
+	statistics.setValue( "header table load factor", headers_.loadFactor() );
+	return written.size();
+}
+
+size_t FastaFilter::listPosition_(const std::string &header) const {
+	if (match_ == HeaderMatch::whole) {
+		return headers_.find(header);
+	}
+	if (match_ == HeaderMatch::accession) {
+		return headers_.find( CharView{header.data(), std::min( header.find_first_of(" \t"), header.size() )} );
+	}
+	// each distinct entry length is tried in turn; there are usually few
+	size_t listPosition = headers_.size();
+	for (const auto &eachLength : prefixLengths_) {
+		if ( eachLength > header.size() ) {
+			break;
+		}
+		listPosition = std::min( listPosition, headers_.find( CharView{header.data(), eachLength} ) );
+	}
+	return listPosition;
+}
+
+void FastaFilter::findPrefixLengths_() {
+	prefixLengths_.clear();
+	if (match_ != HeaderMatch::prefix) {
+		return;
+	}
+	for (size_t iEntry = 0; iEntry < headers_.size(); ++iEntry) {
+		prefixLengths_.push_back(headers_.entry(iEntry).length);
+	}
+	std::sort( prefixLengths_.begin(), prefixLengths_.end() );
+	prefixLengths_.erase( std::unique( prefixLengths_.begin(), prefixLengths_.end() ), prefixLengths_.end() );
+}
+
+FastaDemultiplexer::FastaDemultiplexer(const std::vector< std::pair<std::string, std::string> > &listOutputPairs) {
+	for (const auto &eachPair : listOutputPairs) {
+		this->addOutput_(eachPair.first, eachPair.second);
+	}
+}
+
+FastaDemultiplexer::FastaDemultiplexer(const std::string &manifestFileName) {
+	std::fstream inManifest;
+	inManifest.open(manifestFileName, std::ios::in);
+	if ( !inManifest.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + manifestFileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	std::string eachLine;
+	while ( std::getline(inManifest, eachLine) ) {
+		std::stringstream lineStream(eachLine);
+		std::string headerFileName;
+		std::string outFileName;
+		if ( !(lineStream >> headerFileName) ) {                                                        // blank line
+			continue;
+		}
+		if ( !(lineStream >> outFileName) ) {
+			throw std::string("ERROR: manifest line '") + eachLine + std::string("' must have a header list and an output file name in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		this->addOutput_(headerFileName, outFileName);
+	}
+	RunStatistics::countBytesRead( fileSize(manifestFileName) );
+	inManifest.close();
+}
+
+std::vector<size_t> FastaDemultiplexer::demultiplex(const std::string &inFileName, const size_t &nThreads, const size_t &lineWidth, RunStatistics &statistics) const {
+	checkOutputsAreNotInputs(std::vector<std::string>{inFileName}, outFileNames_);
+	RecordReader fastaReader(inFileName, nThreads, true);
+	std::vector<FastaWriter> outFASTA;
+	outFASTA.reserve( outFileNames_.size() );
+	for (const auto &eachFileName : outFileNames_) {
+		outFASTA.emplace_back(eachFileName, lineWidth);
+	}
+	std::vector<size_t> nWritten(outFileNames_.size(), 0);
+	constexpr size_t maxQueuedBytes{67108864};                                                      // 64 MiB
+	RecordQueue recordQueue(maxQueuedBytes);
+	// errors on the writing thread are passed to this thread after the input is read
+	std::exception_ptr writeError{nullptr};
+	std::thread writerThread([&outFASTA, &nWritten, &recordQueue, &writeError, this]{
+		RoutedRecord record;
+		while ( recordQueue.pop(record) ) {
+			if (writeError != nullptr) {                                                                    // keep draining so that the reader never blocks
+				continue;
+			}
+			try {
+				for (const auto &eachOutput : destinations_[record.destinationIndex]) {
+					outFASTA[eachOutput].write(record.header, record.sequence);
+					++nWritten[eachOutput];
+				}
+			} catch(...) {
+				writeError = std::current_exception();
+			}
+		}
+		try {
+			for (auto &eachWriter : outFASTA) {
+				eachWriter.close();
+			}
+		} catch(...) {
+			if (writeError == nullptr) {
+				writeError = std::current_exception();
+			}
+		}
+	});
+	// headers already routed; needed to keep only the first of duplicated records, as in Fasta
+	std::vector<bool> routed(destinations_.size(), false);
+	uint64_t nParsed{0};
+	uint64_t nMatched{0};
+	try {
+		std::string currentHeader;
+		while ( fastaReader.nextHeader(currentHeader) ) {
+			++nParsed;
+			auto search = headerDestinations_.find(currentHeader);
+			if ( ( search != headerDestinations_.end() ) && !routed[search->second] ) {
+				routed[search->second] = true;
+				++nMatched;
+				RoutedRecord record;
+				record.header           = currentHeader;
+				record.destinationIndex = search->second;
+				fastaReader.readSequence(record.sequence);
+				recordQueue.push( std::move(record) );
+				continue;
+			}
+			fastaReader.skipSequence();
+		}
+	} catch(...) {
+		recordQueue.close();
+		writerThread.join();
+		throw;
+	}
+	recordQueue.close();
+	writerThread.join();
+	if (writeError != nullptr) {
+		std::rethrow_exception(writeError);
+	}
+	statistics.addCount("records parsed", nParsed);
+	statistics.addCount("records matched", nMatched);
+	statistics.setValue( "header table load factor", static_cast<double>( headerDestinations_.load_factor() ) );
+	return nWritten;
+}
+
+void FastaDemultiplexer::addOutput_(const std::string &headerFileName, const std::string &outFileName) {
+	std::fstream inSubsetList;
+	inSubsetList.open(headerFileName, std::ios::in);
+	if ( !inSubsetList.is_open() ) {
+		throw std::string("ERROR: cannot open file ") + headerFileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// writers opened twice on one file would overwrite each other's records
+	for (const auto &eachFileName : outFileNames_) {
+		if ( (eachFileName == outFileName) || sameFile(eachFileName, outFileName) ) {
+			throw std::string("ERROR: output file ") + outFileName + std::string(" is listed more than once in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+	}
+	const size_t outputIndex = outFileNames_.size();
+	outFileNames_.push_back(outFileName);
+	std::string eachLine;
+	while ( std::getline(inSubsetList, eachLine) ) {
+		if ( eachLine.empty() ) {
+			continue;
+		}
+		const auto insertResult = headerDestinations_.emplace( eachLine.substr( static_cast<size_t>(eachLine.at(0) == '>') ), destinations_.size() );      // remove starting '>' if exists
+		if (insertResult.second) {
+			destinations_.emplace_back();
+		}
+		std::vector<size_t> &headerOutputs = destinations_[insertResult.first->second];
+		if ( headerOutputs.empty() || (headerOutputs.back() != outputIndex) ) {                         // the header may be listed twice for the same output
+			headerOutputs.push_back(outputIndex);
+		}
+	}
+	inSubsetList.close();
+	RunStatistics::countBytesRead( fileSize(headerFileName) );
+}
+
+MappedFasta::MappedFasta(const std::string &inFileName) : fastaFile_(inFileName) {
+	const char *fileStart = fastaFile_.data();
+	const char *fileEnd   = fileStart + fastaFile_.size();
+	// the whole mapping is scanned
+	RunStatistics::countBytesRead( fastaFile_.size() );
+	if ( (fastaFile_.size() == 0) || (*fileStart == '\n') ) {
+		throw std::string("ERROR: input FASTA file ") + inFileName + std::string(" empty in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (*fileStart != '>') {
+		throw std::string("ERROR: first line of a FASTA file must begin with '>' in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const char *lineStart = fileStart;
+	while (lineStart < fileEnd) {
+		const auto *lineEnd = static_cast<const char*>( std::memchr( lineStart, '\n', static_cast<size_t>(fileEnd - lineStart) ) );
+		if (lineEnd == nullptr) {
+			lineEnd = fileEnd;
+		}
+		const char *contentEnd = lineEnd;
+		if ( (contentEnd > lineStart) && (*(contentEnd - 1) == '\r') ) {
+			--contentEnd;
+		}
+		if (*lineStart == '>') {
+			MappedRecord newRecord;
+			newRecord.headerStart   = static_cast<size_t>(lineStart - fileStart) + 1;
+			newRecord.headerLength  = std::max(static_cast<size_t>(contentEnd - lineStart), static_cast<size_t>(1)) - 1;
+			newRecord.sequenceStart = std::min(static_cast<size_t>(lineEnd - fileStart) + 1, fastaFile_.size());
+			newRecord.sequenceEnd   = newRecord.sequenceStart;
+			records_.push_back(newRecord);
+		} else if (contentEnd > lineStart) {                                                             // empty lines are skipped
+			MappedRecord &currentRecord = records_.back();
+			if (currentRecord.nLines == 0) {
+				currentRecord.sequenceStart = static_cast<size_t>(lineStart - fileStart);
+			}
+			currentRecord.sequenceEnd = static_cast<size_t>(contentEnd - fileStart);
+			++currentRecord.nLines;
+		}
+		lineStart = lineEnd + 1;
+	}
+	headerIndex_.reserve( records_.size() );
+	for (size_t iRecord = 0; iRecord < records_.size(); ++iRecord) {
+		headerIndex_.emplace(this->header(iRecord), iRecord);                                           // the first of duplicated headers wins, as in Fasta
+	}
+}
+
+size_t MappedFasta::find(const std::string &header) const {
+	CharView headerView;
+	headerView.start  = header.data();
+	headerView.length = header.size();
+	auto search = headerIndex_.find(headerView);
+	if ( search == headerIndex_.end() ) {
+		return records_.size();
+	}
+	return search->second;
+}
+
+CharView MappedFasta::header(const size_t &recordIndex) const {
+	const MappedRecord &record = records_.at(recordIndex);
+	CharView headerView;
+	headerView.start  = fastaFile_.data() + record.headerStart;
+	headerView.length = record.headerLength;
+	return headerView;
+}
+
+CharView MappedFasta::sequenceView(const size_t &recordIndex) const {
+	const MappedRecord &record = records_.at(recordIndex);
+	if (record.nLines > 1) {
+		throw std::string("ERROR: sequence spans several lines and cannot be viewed without copying in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	CharView sequenceView;
+	sequenceView.start  = fastaFile_.data() + record.sequenceStart;
+	sequenceView.length = record.sequenceEnd - record.sequenceStart;
+	return sequenceView;
+}
+
+std::string MappedFasta::sequence(const size_t &recordIndex) const {
+	const MappedRecord &record = records_.at(recordIndex);
+	const char *sequenceStart  = fastaFile_.data() + record.sequenceStart;
+	const char *sequenceEnd    = fastaFile_.data() + record.sequenceEnd;
+	std::string sequence(static_cast<size_t>(sequenceEnd - sequenceStart), '\0');
+	sequence.resize( FastaScanner().copyStripped(sequenceStart, sequenceEnd, &sequence[0]) );
+	return sequence;
+}
+
+std::unordered_map<std::string, std::string> MappedFasta::subset(const std::vector<std::string> &headerList) const {
 	std::unordered_map<std::string, std::string> subset;
 	for (const auto &eachHeader : headerList) {
-		auto search = fastaData_.find(eachHeader);
-		if ( search != fastaData_.end() ) {
-			subset.emplace(search->first, search->second);
+		const size_t recordIndex = this->find(eachHeader);
+		if ( recordIndex < records_.size() ) {
+			subset.emplace( eachHeader, this->sequence(recordIndex) );
 		}
 	}
 	return subset;
 }
-std::unordered_map<std::string, std::string> Fasta::subset(const std::string &headerFileName) const {
+
+std::unordered_map<std::string, std::string> MappedFasta::subset(const std::string &headerFileName) const {
 	std::fstream inSubsetList;
 	inSubsetList.open(headerFileName, std::ios::in);
 	std::vector<std::string> headers;
@@ -84,5 +1118,6 @@ std::unordered_map<std::string, std::string> Fasta::subset(const std::string &he
 		}
 	}
 	inSubsetList.close();
+	RunStatistics::countBytesRead( fileSize(headerFileName) );
 	return this->subset(headers);
 }
@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Resident FASTA server
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of the server that keeps FASTA files in memory and its client.
+ *
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <stdexcept>
+#include <exception>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fastaServer.hpp"
+#include "fastaObj.hpp"
+#include "fastaWriter.hpp"
+#include "headerIndex.hpp"
+#include "mappedFile.hpp"
+#include "runStatistics.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	constexpr size_t transferSize{65536};
+	constexpr int listenBacklog{128};
+
+	/** \brief Socket address from a path
+	 *
+	 * \param[in] socketPath socket path
+	 * \return socket address
+	 */
+	sockaddr_un socketAddress(const std::string &socketPath) {
+		sockaddr_un address{};
+		if ( socketPath.empty() || ( socketPath.size() >= sizeof(address.sun_path) ) ) {
+			throw std::string("ERROR: socket path '") + socketPath + std::string("' must be between 1 and ") + std::to_string(sizeof(address.sun_path) - 1)
+				+ std::string(" characters long in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		address.sun_family = AF_UNIX;
+		std::memcpy( address.sun_path, socketPath.data(), socketPath.size() );
+		return address;
+	}
+
+	/** \brief Send all bytes
+	 *
+	 * \param[in] socketDescriptor connected socket descriptor
+	 * \param[in] bytes bytes to send
+	 */
+	void sendAll(const int &socketDescriptor, const std::string &bytes) {
+		size_t nSent{0};
+		while ( nSent < bytes.size() ) {
+			const ssize_t nBytes = send(socketDescriptor, bytes.data() + nSent, bytes.size() - nSent, MSG_NOSIGNAL);
+			if ( (nBytes < 0) && (errno == EINTR) ) {
+				continue;
+			}
+			if (nBytes < 0) {
+				throw std::string("ERROR: failed to send data in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			nSent += static_cast<size_t>(nBytes);
+		}
+	}
+
+	/** \brief Write all bytes to a file
+	 *
+	 * \param[in] fileDescriptor open file descriptor
+	 * \param[in] bytes bytes to write
+	 * \param[in] nBytes number of bytes to write
+	 */
+	void writeAll(const int &fileDescriptor, const char *bytes, const size_t &nBytes) {
+		size_t nWritten{0};
+		while (nWritten < nBytes) {
+			const ssize_t nWrittenNow = write(fileDescriptor, bytes + nWritten, nBytes - nWritten);
+			if ( (nWrittenNow < 0) && (errno == EINTR) ) {
+				continue;
+			}
+			if (nWrittenNow < 0) {
+				throw std::string("ERROR: failed to write the output file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			nWritten += static_cast<size_t>(nWrittenNow);
+		}
+		RunStatistics::countBytesWritten(nWritten);
+	}
+
+	/** \brief Receive up to a chunk of bytes
+	 *
+	 * \param[in] socketDescriptor connected socket descriptor
+	 * \param[out] chunk receiving buffer
+	 * \return number of bytes received; 0 once the peer shuts down
+	 */
+	size_t receiveChunk(const int &socketDescriptor, std::vector<char> &chunk) {
+		while (true) {
+			const ssize_t nBytes = recv(socketDescriptor, chunk.data(), chunk.size(), 0);
+			if ( (nBytes < 0) && (errno == EINTR) ) {
+				continue;
+			}
+			if (nBytes < 0) {
+				throw std::string("ERROR: failed to receive data in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			RunStatistics::countBytesRead( static_cast<uint64_t>(nBytes) );
+			return static_cast<size_t>(nBytes);
+		}
+	}
+
+	/** \brief Receive bytes until the peer shuts down
+	 *
+	 * \param[in] socketDescriptor connected socket descriptor
+	 * \return received bytes
+	 */
+	std::string receiveAll(const int &socketDescriptor) {
+		std::string bytes;
+		std::vector<char> chunk(transferSize);
+		size_t nBytes{0};
+		while ( ( nBytes = receiveChunk(socketDescriptor, chunk) ) > 0 ) {
+			bytes.append(chunk.data(), nBytes);
+		}
+		return bytes;
+	}
+
+	/** \brief Remove a stale socket
+	 *
+	 * Throws if the path exists and is not a socket, or if a server still answers on it.
+	 *
+	 * \param[in] socketPath socket path
+	 * \param[in] address socket address
+	 */
+	void removeStaleSocket(const std::string &socketPath, const sockaddr_un &address) {
+		struct stat pathStatus{};
+		if (lstat(socketPath.c_str(), &pathStatus) != 0) {
+			return;                                                                                     // nothing to remove
+		}
+		if ( !S_ISSOCK(pathStatus.st_mode) ) {
+			throw std::string("ERROR: ") + socketPath + std::string(" exists and is not a socket in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		const int probeDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (probeDescriptor == -1) {
+			throw std::string("ERROR: cannot create a socket in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		const bool serverRunning = connect( probeDescriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address) ) == 0;
+		close(probeDescriptor);
+		if (serverRunning) {
+			throw std::string("ERROR: a server is already listening on ") + socketPath + std::string(" in ")
+				+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		unlink( socketPath.c_str() );                                                                   // a stale socket from an earlier run
+	}
+
+	/** \brief Parse a subset request
+	 *
+	 * \param[in] requestBytes request as received
+	 * \return parsed request
+	 */
+	SubsetRequest parseRequest(const std::string &requestBytes) {
+		std::stringstream requestStream(requestBytes);
+		std::string eachLine;
+		std::getline(requestStream, eachLine);
+		std::stringstream fieldStream(eachLine);
+		std::vector<std::string> fields;
+		std::string eachField;
+		while ( std::getline(fieldStream, eachField, '\t') ) {
+			fields.push_back(eachField);
+		}
+		constexpr size_t nFields{4};
+		if (fields.size() != nFields) {
+			throw std::string("ERROR: request line '") + eachLine + std::string("' must have four tab-separated fields in ")
+				+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		SubsetRequest request;
+		request.fastaName = fields[0];
+		if (fields[1] == "list") {
+			request.order = RecordOrder::list;
+		} else if (fields[1] != "input") {
+			throw std::string("ERROR: record order must be 'input' or 'list' in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if (fields[2] == "accession") {
+			request.match = HeaderMatch::accession;
+		} else if (fields[2] == "prefix") {
+			request.match = HeaderMatch::prefix;
+		} else if (fields[2] != "whole") {
+			throw std::string("ERROR: match type must be 'whole', 'accession', or 'prefix' in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		try {
+			if ( fields[3].empty() || (fields[3].front() == '-') ) {
+				throw std::invalid_argument("negative line width");
+			}
+			request.lineWidth = std::stoul(fields[3]);
+		} catch(const std::exception &problem) {
+			throw std::string("ERROR: line width must be a non-negative integer in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		while ( std::getline(requestStream, eachLine) ) {
+			if ( !eachLine.empty() ) {
+				request.headers.emplace_back( eachLine.substr( static_cast<size_t>(eachLine.at(0) == '>') ) );      // remove starting '>' if exists
+			}
+		}
+		return request;
+	}
+}
+
+size_t BayesicSpace::requestSubset(const std::string &socketPath, const SubsetRequest &request, const std::string &outFileName) {
+	const sockaddr_un address{socketAddress(socketPath)};
+	const int socketDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (socketDescriptor == -1) {
+		throw std::string("ERROR: cannot create a socket in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	int outDescriptor{-1};
+	size_t nReceived{0};
+	try {
+		if (connect( socketDescriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address) ) != 0) {
+			throw std::string("ERROR: cannot connect to the server at ") + socketPath + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		std::string requestBytes{request.fastaName};
+		requestBytes += (request.order == RecordOrder::list ? "\tlist\t" : "\tinput\t");
+		requestBytes += (request.match == HeaderMatch::whole ? "whole\t" : (request.match == HeaderMatch::accession ? "accession\t" : "prefix\t") );
+		requestBytes += std::to_string(request.lineWidth) + "\n";
+		for (const auto &eachHeader : request.headers) {
+			requestBytes += eachHeader + "\n";
+		}
+		sendAll(socketDescriptor, requestBytes);
+		shutdown(socketDescriptor, SHUT_WR);
+		// only the start of the response is held, to tell records from an error message
+		const std::string errorTag("ERROR:");
+		std::string responseStart;
+		std::vector<char> chunk(transferSize);
+		size_t nBytes{0};
+		while ( ( responseStart.size() < errorTag.size() ) && ( ( nBytes = receiveChunk(socketDescriptor, chunk) ) > 0 ) ) {
+			responseStart.append(chunk.data(), nBytes);
+		}
+		if (responseStart.compare(0, errorTag.size(), errorTag) == 0) {
+			std::string response{responseStart + receiveAll(socketDescriptor)};
+			if (response.back() == '\n') {
+				response.pop_back();
+			}
+			throw response;
+		}
+		outDescriptor = open(outFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (outDescriptor == -1) {
+			throw std::string("ERROR: cannot open file ") + outFileName + std::string(" for writing in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		writeAll( outDescriptor, responseStart.data(), responseStart.size() );
+		nReceived = responseStart.size();
+		while ( ( nBytes = receiveChunk(socketDescriptor, chunk) ) > 0 ) {
+			writeAll(outDescriptor, chunk.data(), nBytes);
+			nReceived += nBytes;
+		}
+	} catch(...) {
+		close(socketDescriptor);
+		if (outDescriptor != -1) {
+			close(outDescriptor);
+		}
+		throw;
+	}
+	close(socketDescriptor);
+	if (close(outDescriptor) != 0) {
+		throw std::string("ERROR: failed to close the output file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	return nReceived;
+}
+
+FastaServer::FastaServer(const std::string &socketPath, const std::vector<std::string> &fastaFileNames, const size_t &nThreads, const bool &packSequences) :
+		socketPath_{socketPath}, fastaNames_{fastaFileNames} {
+	if ( fastaFileNames.empty() ) {
+		throw std::string("ERROR: the server needs at least one FASTA file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	const sockaddr_un address{socketAddress(socketPath)};
+	removeStaleSocket(socketPath_, address);
+	fastaData_.reserve( fastaFileNames.size() );
+	for (const auto &eachFileName : fastaFileNames) {
+		fastaData_.emplace_back(eachFileName, nThreads, packSequences);
+		fastaData_.back().buildHeaderIndex();
+	}
+	listenDescriptor_ = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenDescriptor_ == -1) {
+		throw std::string("ERROR: cannot create a socket in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if ( (bind( listenDescriptor_, reinterpret_cast<const sockaddr*>(&address), sizeof(address) ) != 0) || (listen(listenDescriptor_, listenBacklog) != 0) ) {
+		close(listenDescriptor_);
+		throw std::string("ERROR: cannot listen on ") + socketPath_ + std::string(" in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+}
+
+FastaServer::~FastaServer() {
+	this->stop();
+	std::unique_lock<std::mutex> clientLock(clientMutex_);
+	clientDone_.wait(clientLock, [this]{return nActiveClients_ == 0;});
+	close(listenDescriptor_);
+	unlink( socketPath_.c_str() );
+}
+
+void FastaServer::serve() {
+	std::signal(SIGPIPE, SIG_IGN);
+	while (true) {
+		const int clientDescriptor = accept(listenDescriptor_, nullptr, nullptr);
+		if (clientDescriptor == -1) {
+			if (stopping_) {
+				break;
+			}
+			if ( (errno == EINTR) || (errno == ECONNABORTED) ) {
+				continue;
+			}
+			throw std::string("ERROR: failed to accept a connection in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		{
+			std::lock_guard<std::mutex> clientLock(clientMutex_);
+			++nActiveClients_;
+		}
+		try {
+			std::thread([this, clientDescriptor]{
+				this->answer_(clientDescriptor);
+				std::lock_guard<std::mutex> clientLock(clientMutex_);
+				--nActiveClients_;
+				clientDone_.notify_all();
+			}).detach();
+		} catch(const std::system_error &problem) {                                                   // no more threads; drop the connection
+			close(clientDescriptor);
+			std::lock_guard<std::mutex> clientLock(clientMutex_);
+			--nActiveClients_;
+		}
+	}
+	std::unique_lock<std::mutex> clientLock(clientMutex_);
+	clientDone_.wait(clientLock, [this]{return nActiveClients_ == 0;});
+}
+
+void FastaServer::stop() {
+	stopping_ = true;
+	shutdown(listenDescriptor_, SHUT_RDWR);                                                         // wakes up accept()
+}
+
+void FastaServer::answer_(const int &clientDescriptor) const {
+	const Fasta *fastaData{nullptr};
+	std::vector<size_t> recordIndexes;
+	size_t lineWidth{0};
+	try {
+		const SubsetRequest request{parseRequest( receiveAll(clientDescriptor) )};
+		size_t fastaIndex{0};
+		if ( !request.fastaName.empty() ) {
+			while ( ( fastaIndex < fastaNames_.size() ) && (fastaNames_[fastaIndex] != request.fastaName) ) {
+				++fastaIndex;
+			}
+			if ( fastaIndex == fastaNames_.size() ) {
+				throw std::string("ERROR: FASTA file ") + request.fastaName + std::string(" is not loaded in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+		}
+		fastaData     = &fastaData_[fastaIndex];
+		recordIndexes = fastaData->subsetIndexes(fastaData->matchHeaders(request.headers, request.match), request.order);
+		lineWidth     = request.lineWidth;
+	} catch(const std::string &problem) {
+		answerError_(clientDescriptor, problem);
+		return;
+	} catch(const std::exception &problem) {
+		answerError_( clientDescriptor, std::string("ERROR: ") + problem.what() + std::string(" in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) ) );
+		return;
+	} catch(...) {
+		answerError_( clientDescriptor, std::string("ERROR: unknown failure in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) ) );
+		return;
+	}
+	// the writer owns the descriptor from here on; write errors mean the client disconnected and are ignored
+	try {
+		FastaWriter outFASTA(clientDescriptor, lineWidth);
+		for (const auto &eachIndex : recordIndexes) {
+			if ( fastaData->isPacked() ) {
+				const std::string sequence{fastaData->sequence(eachIndex)};
+				outFASTA.write( fastaData->header(eachIndex), CharView{sequence.data(), sequence.size()} );
+				continue;
+			}
+			outFASTA.write( fastaData->header(eachIndex), fastaData->sequenceView(eachIndex) );
+		}
+		outFASTA.close();
+	} catch(const std::string &problem) {
+	} catch(const std::exception &problem) {
+	} catch(...) {
+	}
+}
+
+void FastaServer::answerError_(const int &clientDescriptor, const std::string &message) noexcept {
+	try {
+		sendAll(clientDescriptor, message + "\n");
+	} catch(...) {                                                                                  // the client is gone
+	}
+	close(clientDescriptor);
+}
@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Buffered FASTA output
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of the buffered FASTA writer.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <exception>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef SUBSETFA_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "fastaWriter.hpp"
+#include "fastaIndex.hpp"
+#include "headerIndex.hpp"
+#include "inputStream.hpp"
+#include "mappedFile.hpp"
+#include "spscQueue.hpp"
+#include "runStatistics.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	constexpr size_t writeBufferSize{4194304};                                                       // 4 MiB
+	constexpr size_t bufferAlignment{4096};
+	// unwrapped sequences at least this long are written from the caller's memory instead of being copied
+	constexpr size_t directWriteSize{65536};
+	// number of buffers in flight when writing in the background, in addition to the one being filled
+	constexpr size_t backgroundDepth{2};
+	constexpr size_t bgzfHeaderSize{18};
+	constexpr size_t bgzfFooterSize{8};
+	// uncompressed bytes per BGZF block, as in bgzip; leaves room for incompressible data within the 64 KiB block limit
+	constexpr size_t bgzfBlockDataSize{65280};
+	constexpr size_t bgzfMaxBlockSize{65536};
+	// empty block that marks the end of a BGZF file; its header is also the header of every other block, up to the block size field
+	constexpr std::array<unsigned char, 28> bgzfEndBlock{0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43, 0x02, 0x00,
+		0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+	/** \brief Output buffer passed to the background writing thread */
+	struct OutputBuffer {
+		/** \brief Buffer storage; null marks the end of output */
+		std::unique_ptr<char, void(*)(void*)> bytes{nullptr, free};
+		/** \brief Number of bytes to write */
+		size_t size{0};
+	};
+
+	/** \brief Allocate a page-aligned output buffer
+	 *
+	 * \return buffer of `writeBufferSize` bytes
+	 */
+	std::unique_ptr<char, void(*)(void*)> allocateBuffer() {
+		void *alignedBuffer{nullptr};
+		if (posix_memalign(&alignedBuffer, bufferAlignment, writeBufferSize) != 0) {
+			throw std::string("ERROR: cannot allocate the output buffer in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		return std::unique_ptr<char, void(*)(void*)>(static_cast<char*>(alignedBuffer), free);
+	}
+
+	/** \brief Write all bytes
+	 *
+	 * \param[in] outputDescriptor output file descriptor
+	 * \param[in] bytes pointer to the first byte
+	 * \param[in] nBytes number of bytes
+	 */
+	void writeAll(const int &outputDescriptor, const char *bytes, const size_t &nBytes) {
+		size_t nWritten{0};
+		while (nWritten < nBytes) {
+			const ssize_t writeResult = ::write(outputDescriptor, bytes + nWritten, nBytes - nWritten);
+			if ( (writeResult < 0) && (errno == EINTR) ) {
+				continue;
+			}
+			if (writeResult < 0) {
+				throw std::string("ERROR: failed to write the output file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			nWritten += static_cast<size_t>(writeResult);
+		}
+		RunStatistics::countBytesWritten(nWritten);
+	}
+
+	/** \brief Store a number in little-endian byte order
+	 *
+	 * \param[in] number number to store
+	 * \param[in] nBytes number of bytes to store
+	 * \param[out] destination pointer to the first byte
+	 */
+	void storeLittleEndian(uint64_t number, const size_t &nBytes, char *destination) {
+		for (size_t iByte = 0; iByte < nBytes; ++iByte) {
+			destination[iByte]   = static_cast<char>(number & 0xff);
+			number             >>= 8;
+		}
+	}
+#ifdef SUBSETFA_HAVE_ZLIB
+
+	/** \brief Compress one BGZF block
+	 *
+	 * \param[in,out] zStream raw deflate stream; reset before use
+	 * \param[in] bytes pointer to the first uncompressed byte
+	 * \param[in] nBytes number of uncompressed bytes; at most `bgzfBlockDataSize`
+	 * \param[out] block block storage of `bgzfMaxBlockSize` bytes
+	 * \return block size
+	 */
+	size_t deflateBgzfBlock(z_stream &zStream, const char *bytes, const size_t &nBytes, char *block) {
+		if (deflateReset(&zStream) != Z_OK) {
+			throw std::string("ERROR: cannot reset compression in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		constexpr size_t maxDataSize{bgzfMaxBlockSize - bgzfHeaderSize - bgzfFooterSize};
+		zStream.next_in   = reinterpret_cast<Bytef*>( const_cast<char*>(bytes) );
+		zStream.avail_in  = static_cast<uInt>(nBytes);
+		zStream.next_out  = reinterpret_cast<Bytef*>(block + bgzfHeaderSize);
+		zStream.avail_out = static_cast<uInt>(maxDataSize);
+		if (deflate(&zStream, Z_FINISH) != Z_STREAM_END) {
+			throw std::string("ERROR: compressed data do not fit in a BGZF block in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		const size_t blockSize = bgzfHeaderSize + (maxDataSize - zStream.avail_out) + bgzfFooterSize;
+		std::memcpy(block, bgzfEndBlock.data(), bgzfHeaderSize - 2);
+		storeLittleEndian(blockSize - 1, 2, block + bgzfHeaderSize - 2);
+		storeLittleEndian(crc32( crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(bytes), static_cast<uInt>(nBytes) ), 4, block + blockSize - bgzfFooterSize);
+		storeLittleEndian(nBytes, 4, block + blockSize - 4);
+		return blockSize;
+	}
+#endif
+}
+
+/** \brief Background writing state */
+struct FastaWriter::BackgroundWriter {
+	/** \brief Constructor */
+	BackgroundWriter() : filledBuffers(backgroundDepth + 2), emptyBuffers(backgroundDepth + 2) {};
+	/** \brief Buffers waiting to be written */
+	SpscQueue<OutputBuffer> filledBuffers;
+	/** \brief Written buffers returned for reuse */
+	SpscQueue<OutputBuffer> emptyBuffers;
+	/** \brief First write error; set before `failed` */
+	std::exception_ptr writeError{nullptr};
+	/** \brief True after a write error */
+	std::atomic<bool> failed{false};
+	/** \brief Writing thread */
+	std::thread writeThread;
+	/** \brief Number of BGZF compression threads; 0 for uncompressed output */
+	size_t nCompressionThreads{0};
+	/** \brief Compressed blocks of the current buffer, `bgzfMaxBlockSize` bytes apart */
+	std::vector<char> compressedBlocks;
+	/** \brief Sizes of the compressed blocks */
+	std::vector<size_t> blockSizes;
+	/** \brief File offsets of the written BGZF blocks */
+	std::vector<uint64_t> compressedOffsets;
+	/** \brief Uncompressed offsets of the written BGZF blocks */
+	std::vector<uint64_t> uncompressedOffsets;
+	/** \brief Number of compressed bytes written */
+	uint64_t nCompressedBytes{0};
+	/** \brief Number of uncompressed bytes written */
+	uint64_t nUncompressedBytes{0};
+	/** \brief Write out a buffer
+	 *
+	 * \param[in] outputDescriptor output file descriptor
+	 * \param[in] bytes pointer to the first byte
+	 * \param[in] nBytes number of bytes
+	 */
+	void writeOut(const int &outputDescriptor, const char *bytes, const size_t &nBytes);
+	/** \brief Finish the output
+	 *
+	 * Writes the end-of-file block of compressed output.
+	 *
+	 * \param[in] outputDescriptor output file descriptor
+	 */
+	void finish(const int &outputDescriptor);
+};
+
+/** \brief Output index state */
+struct FastaWriter::OutputIndex {
+	/** \brief Output file name */
+	std::string outFileName;
+	/** \brief Index entries of the records written so far */
+	std::vector<FaidxEntry> entries;
+	/** \brief Number of uncompressed bytes written so far */
+	uint64_t nBytes{0};
+};
+
+void FastaWriter::BackgroundWriter::writeOut(const int &outputDescriptor, const char *bytes, const size_t &nBytes) {
+	if (nCompressionThreads == 0) {
+		writeAll(outputDescriptor, bytes, nBytes);
+		return;
+	}
+#ifdef SUBSETFA_HAVE_ZLIB
+	const size_t nBlocks = (nBytes + bgzfBlockDataSize - 1) / bgzfBlockDataSize;
+	compressedBlocks.resize(nBlocks * bgzfMaxBlockSize);
+	blockSizes.resize(nBlocks);
+	// each thread compresses a contiguous run of blocks
+	auto deflateBlocks = [this, bytes, &nBytes](const size_t &firstBlock, const size_t &lastBlock){
+		z_stream zStream{};
+		// negative window bits: raw deflate data without a zlib or gzip wrapper
+		constexpr int rawWindowBits{-15};
+		constexpr int memoryLevel{8};
+		if (deflateInit2(&zStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, rawWindowBits, memoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+			throw std::string("ERROR: cannot initialize compression in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		try {
+			for (size_t iBlock = firstBlock; iBlock < lastBlock; ++iBlock) {
+				const size_t blockStart = iBlock * bgzfBlockDataSize;
+				blockSizes[iBlock]      = deflateBgzfBlock(zStream, bytes + blockStart, std::min(bgzfBlockDataSize, nBytes - blockStart),
+																compressedBlocks.data() + iBlock * bgzfMaxBlockSize);
+			}
+		} catch(...) {
+			deflateEnd(&zStream);
+			throw;
+		}
+		deflateEnd(&zStream);
+	};
+	const size_t nWorkers = std::min(nCompressionThreads, nBlocks);
+	std::vector< std::future<void> > workers;
+	for (size_t iWorker = 1; iWorker < nWorkers; ++iWorker) {
+		workers.emplace_back( std::async(std::launch::async, deflateBlocks, iWorker * nBlocks / nWorkers, (iWorker + 1) * nBlocks / nWorkers) );
+	}
+	deflateBlocks(0, nBlocks / nWorkers);
+	for (auto &eachWorker : workers) {
+		eachWorker.get();
+	}
+	// blocks are packed together and written in order with one call
+	size_t packedSize{0};
+	for (size_t iBlock = 0; iBlock < nBlocks; ++iBlock) {
+		compressedOffsets.push_back(nCompressedBytes + packedSize);
+		uncompressedOffsets.push_back(nUncompressedBytes + iBlock * bgzfBlockDataSize);
+		std::memmove(compressedBlocks.data() + packedSize, compressedBlocks.data() + iBlock * bgzfMaxBlockSize, blockSizes[iBlock]);
+		packedSize += blockSizes[iBlock];
+	}
+	writeAll(outputDescriptor, compressedBlocks.data(), packedSize);
+	nCompressedBytes   += packedSize;
+	nUncompressedBytes += nBytes;
+#endif
+}
+
+void FastaWriter::BackgroundWriter::finish(const int &outputDescriptor) {
+	if (nCompressionThreads > 0) {
+		writeAll( outputDescriptor, reinterpret_cast<const char*>( bgzfEndBlock.data() ), bgzfEndBlock.size() );
+	}
+}
+
+FastaWriter::FastaWriter(const std::string &outFileName, const OutputFormat &format, const bool &writeInBackground) : lineWidth_{format.lineWidth}, buffer_{allocateBuffer()} {
+	const bool compress{format.compression != Compression::none};
+#ifndef SUBSETFA_HAVE_ZLIB
+	if (compress) {
+		throw std::string("ERROR: compressed output requires zlib support in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+#endif
+	outputDescriptor_ = open(outFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (outputDescriptor_ == -1) {
+		throw std::string("ERROR: cannot open file ") + outFileName + std::string(" for writing in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (format.writeIndexes) {
+		outputIndex_.reset(new OutputIndex);
+		outputIndex_->outFileName = outFileName;
+	}
+	if (!writeInBackground && !compress) {
+		return;
+	}
+	try {
+		background_ = std::make_shared<BackgroundWriter>();
+		background_->nCompressionThreads = ( compress ? std::max(format.nThreads, size_t{1}) : 0 );
+		for (size_t iBuffer = 0; iBuffer < backgroundDepth; ++iBuffer) {
+			OutputBuffer emptyBuffer;
+			emptyBuffer.bytes = allocateBuffer();
+			background_->emptyBuffers.tryPush(emptyBuffer);
+		}
+	} catch(...) {
+		::close(outputDescriptor_);
+		outputDescriptor_ = -1;
+		throw;
+	}
+	BackgroundWriter *state = background_.get();
+	const int descriptor    = outputDescriptor_;
+	state->writeThread = std::thread([state, descriptor]{
+		OutputBuffer buffer;
+		while (true) {
+			size_t nAttempts{0};
+			while ( !state->filledBuffers.tryPop(buffer) ) {
+				backOff(nAttempts);
+			}
+			if (buffer.bytes == nullptr) {
+				if (!state->failed) {
+					try {
+						state->finish(descriptor);
+					} catch(...) {
+						state->writeError = std::current_exception();
+						state->failed     = true;
+					}
+				}
+				return;
+			}
+			// after an error, buffers are still recycled so that the filling thread never waits forever
+			if (!state->failed) {
+				try {
+					state->writeOut(descriptor, buffer.bytes.get(), buffer.size);
+				} catch(...) {
+					state->writeError = std::current_exception();
+					state->failed     = true;
+				}
+			}
+			buffer.size = 0;
+			state->emptyBuffers.tryPush(buffer);                                                        // there is always room for all buffers
+		}
+	});
+}
+
+FastaWriter::FastaWriter(const int &outputDescriptor, const size_t &lineWidth) : outputDescriptor_{outputDescriptor}, lineWidth_{lineWidth} {
+	if (outputDescriptor_ < 0) {
+		throw std::string("ERROR: invalid output file descriptor in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	try {
+		buffer_ = allocateBuffer();
+	} catch(...) {
+		outputDescriptor_ = -1;
+		throw;
+	}
+}
+
+FastaWriter::~FastaWriter() {
+	try {
+		this->close();
+	} catch(...) {                                                                                      // destructors must not throw
+	}
+}
+
+FastaWriter::FastaWriter(FastaWriter &&toMove) noexcept :
+		outputDescriptor_{toMove.outputDescriptor_}, lineWidth_{toMove.lineWidth_}, buffer_{std::move(toMove.buffer_)}, bufferEnd_{toMove.bufferEnd_},
+		background_{std::move(toMove.background_)}, outputIndex_{std::move(toMove.outputIndex_)} {
+	toMove.outputDescriptor_ = -1;
+	toMove.bufferEnd_        = 0;
+}
+
+FastaWriter& FastaWriter::operator=(FastaWriter &&toMove) noexcept {
+	if (this != &toMove) {
+		try {
+			this->close();
+		} catch(...) {
+		}
+		outputDescriptor_        = toMove.outputDescriptor_;
+		lineWidth_               = toMove.lineWidth_;
+		buffer_                  = std::move(toMove.buffer_);
+		bufferEnd_               = toMove.bufferEnd_;
+		background_              = std::move(toMove.background_);
+		outputIndex_             = std::move(toMove.outputIndex_);
+		toMove.outputDescriptor_ = -1;
+		toMove.bufferEnd_        = 0;
+	}
+	return *this;
+}
+
+void FastaWriter::write(const CharView &header, const CharView &sequence) {
+	if (outputDescriptor_ == -1) {
+		throw std::string("ERROR: the output file is closed in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (outputIndex_ != nullptr) {
+		this->indexRecord_(header, sequence.length);
+	}
+	const char headerStart{'>'};
+	const char lineEnd{'\n'};
+	this->append_(&headerStart, 1);
+	this->append_(header.start, header.length);
+	this->append_(&lineEnd, 1);
+	if ( (lineWidth_ == 0) || (sequence.length <= lineWidth_) ) {
+		if ( (sequence.length >= directWriteSize) && (background_ == nullptr) ) {
+			this->flush_(sequence.start, sequence.length);
+		} else {
+			this->append_(sequence.start, sequence.length);
+		}
+		this->append_(&lineEnd, 1);
+		return;
+	}
+	// whole lines are copied while they fit in the buffer
+	const char *lineStart   = sequence.start;
+	const char *sequenceEnd = sequence.start + sequence.length;
+	while (lineStart < sequenceEnd) {
+		const size_t nBases = std::min( lineWidth_, static_cast<size_t>(sequenceEnd - lineStart) );
+		if (bufferEnd_ + nBases + 1 > writeBufferSize) {
+			this->flush_(nullptr, 0);
+		}
+		if (nBases + 1 > writeBufferSize) {                                                             // line longer than the buffer
+			this->append_(lineStart, nBases);
+			this->append_(&lineEnd, 1);
+		} else {
+			std::memcpy(buffer_.get() + bufferEnd_, lineStart, nBases);
+			buffer_.get()[bufferEnd_ + nBases] = lineEnd;
+			bufferEnd_ += nBases + 1;
+		}
+		lineStart += nBases;
+	}
+}
+
+void FastaWriter::close() {
+	if (outputDescriptor_ == -1) {
+		return;
+	}
+	const int closingDescriptor = outputDescriptor_;
+	std::exception_ptr closeError{nullptr};
+	try {
+		this->flush_(nullptr, 0);
+	} catch(...) {
+		closeError = std::current_exception();
+	}
+	bool compressed{false};
+	std::vector<uint64_t> compressedOffsets;
+	std::vector<uint64_t> uncompressedOffsets;
+	// the background thread must finish before the descriptor is closed
+	if (background_ != nullptr) {
+		OutputBuffer endMarker;
+		size_t nAttempts{0};
+		while ( !background_->filledBuffers.tryPush(endMarker) ) {
+			backOff(nAttempts);
+		}
+		background_->writeThread.join();
+		if (closeError == nullptr) {
+			closeError = background_->writeError;
+		}
+		compressed          = (background_->nCompressionThreads > 0);
+		compressedOffsets   = std::move(background_->compressedOffsets);
+		uncompressedOffsets = std::move(background_->uncompressedOffsets);
+		background_.reset();
+	}
+	outputDescriptor_ = -1;
+	if (closeError != nullptr) {
+		::close(closingDescriptor);
+		std::rethrow_exception(closeError);
+	}
+	if (::close(closingDescriptor) != 0) {
+		throw std::string("ERROR: failed to close the output file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (outputIndex_ == nullptr) {
+		return;
+	}
+	// indexes are saved after the output file is closed, so that they are not older than it
+	const std::unique_ptr<OutputIndex> finishedIndex{std::move(outputIndex_)};
+	FastaIndex( std::move(finishedIndex->entries) ).save( finishedIndex->outFileName + std::string(".fai") );
+	if (compressed) {
+		BgzfIndex( std::move(compressedOffsets), std::move(uncompressedOffsets) ).save( finishedIndex->outFileName + std::string(".gzi") );
+	}
+}
+
+void FastaWriter::append_(const char *bytes, size_t nBytes) {
+	while (nBytes > 0) {
+		const size_t nToCopy = std::min(nBytes, writeBufferSize - bufferEnd_);
+		std::memcpy(buffer_.get() + bufferEnd_, bytes, nToCopy);
+		bufferEnd_ += nToCopy;
+		bytes      += nToCopy;
+		nBytes     -= nToCopy;
+		if (bufferEnd_ == writeBufferSize) {
+			this->flush_(nullptr, 0);
+		}
+	}
+}
+
+void FastaWriter::flush_(const char *extraBytes, const size_t &nExtraBytes) {
+	if (background_ != nullptr) {                                                                   // extra bytes are never passed in this mode
+		if (background_->failed) {
+			std::rethrow_exception(background_->writeError);
+		}
+		if (bufferEnd_ == 0) {
+			return;
+		}
+		OutputBuffer filledBuffer;
+		filledBuffer.bytes = std::move(buffer_);
+		filledBuffer.size  = bufferEnd_;
+		size_t nAttempts{0};
+		while ( !background_->filledBuffers.tryPush(filledBuffer) ) {
+			backOff(nAttempts);
+		}
+		OutputBuffer emptyBuffer;
+		nAttempts = 0;
+		while ( !background_->emptyBuffers.tryPop(emptyBuffer) ) {
+			backOff(nAttempts);
+		}
+		buffer_    = std::move(emptyBuffer.bytes);
+		bufferEnd_ = 0;
+		return;
+	}
+	std::array<iovec, 2> segments{};
+	segments[0].iov_base = buffer_.get();
+	segments[0].iov_len  = bufferEnd_;
+	segments[1].iov_base = const_cast<char*>(extraBytes);
+	segments[1].iov_len  = nExtraBytes;
+	size_t firstSegment{0};
+	// writev may write only part of the data; the segments are advanced past what was written and the rest is retried
+	while (firstSegment < segments.size()) {
+		if (segments[firstSegment].iov_len == 0) {
+			++firstSegment;
+			continue;
+		}
+		const ssize_t nWritten = writev( outputDescriptor_, segments.data() + firstSegment, static_cast<int>(segments.size() - firstSegment) );
+		if ( (nWritten < 0) && (errno == EINTR) ) {
+			continue;
+		}
+		if (nWritten < 0) {
+			throw std::string("ERROR: failed to write the output file in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		RunStatistics::countBytesWritten( static_cast<uint64_t>(nWritten) );
+		auto nRemaining = static_cast<size_t>(nWritten);
+		while ( (nRemaining > 0) && ( firstSegment < segments.size() ) ) {
+			const size_t nFromSegment       = std::min(nRemaining, segments[firstSegment].iov_len);
+			segments[firstSegment].iov_base = static_cast<char*>(segments[firstSegment].iov_base) + nFromSegment;
+			segments[firstSegment].iov_len -= nFromSegment;
+			nRemaining                     -= nFromSegment;
+			if (segments[firstSegment].iov_len == 0) {
+				++firstSegment;
+			}
+		}
+	}
+	bufferEnd_ = 0;
+}
+
+void FastaWriter::indexRecord_(const CharView &header, const size_t &sequenceLength) {
+	FaidxEntry newEntry;
+	// samtools names a record by the first white space-delimited word of its header
+	newEntry.name = accession( std::string(header.start, header.length) );
+	// the sequence starts after '>', the header, and its line break
+	newEntry.length    = sequenceLength;
+	newEntry.offset    = outputIndex_->nBytes + header.length + 2;
+	newEntry.lineBases = ( (lineWidth_ == 0) || (sequenceLength <= lineWidth_) ) ? sequenceLength : lineWidth_;
+	newEntry.lineBytes = (newEntry.lineBases == 0) ? 0 : newEntry.lineBases + 1;
+	// an empty sequence still ends with a line break
+	const uint64_t nLines = (newEntry.lineBases == 0) ? 1 : (sequenceLength + newEntry.lineBases - 1) / newEntry.lineBases;
+	outputIndex_->nBytes  = newEntry.offset + sequenceLength + nLines;
+	outputIndex_->entries.push_back( std::move(newEntry) );
+}
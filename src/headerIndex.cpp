@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Header lookup index
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of the secondary index that answers accession and prefix queries on FASTA headers.
+ *
+ */
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "headerIndex.hpp"
+
+using namespace BayesicSpace;
+
+std::string BayesicSpace::accession(const std::string &header) {
+	return header.substr( 0, header.find_first_of(" \t") );
+}
+
+HeaderIndex::HeaderIndex(const std::vector<std::string> &headers) {
+	sortedHeaders_.reserve( headers.size() );
+	accessionIndex_.reserve( headers.size() );
+	for (size_t iHeader = 0; iHeader < headers.size(); ++iHeader) {
+		sortedHeaders_.emplace_back(headers[iHeader], iHeader);
+		accessionIndex_[accession(headers[iHeader])].push_back(iHeader);
+	}
+	std::sort( sortedHeaders_.begin(), sortedHeaders_.end() );
+	recordOrder_.resize( sortedHeaders_.size() );
+	for (size_t iSorted = 0; iSorted < sortedHeaders_.size(); ++iSorted) {
+		recordOrder_[sortedHeaders_[iSorted].second] = iSorted;
+	}
+}
+
+std::vector<size_t> HeaderIndex::find(const std::string &query, const HeaderMatch &match) const {
+	std::vector<size_t> matches;
+	if (match == HeaderMatch::accession) {
+		auto search = accessionIndex_.find(query);
+		if ( search != accessionIndex_.end() ) {
+			matches = search->second;
+		}
+		return matches;
+	}
+	// headers that start with the query follow it immediately in sorted order
+	auto headerIt = std::lower_bound( sortedHeaders_.cbegin(), sortedHeaders_.cend(), query,
+		[](const std::pair<std::string, size_t> &entry, const std::string &value){return entry.first < value;} );
+	// exact matches sort before longer headers with the same start
+	while ( ( headerIt != sortedHeaders_.cend() ) && (headerIt->first.compare(0, query.size(), query) == 0) ) {
+		if ( (match == HeaderMatch::whole) && ( headerIt->first.size() != query.size() ) ) {
+			break;
+		}
+		matches.push_back(headerIt->second);
+		++headerIt;
+	}
+	std::sort( matches.begin(), matches.end() );
+	return matches;
+}
+
+std::vector<std::string> HeaderIndex::expand(const std::vector<std::string> &queries, const HeaderMatch &match) const {
+	std::vector<std::string> headers;
+	std::unordered_set<size_t> included;
+	for (const auto &eachQuery : queries) {
+		for ( const auto &eachPosition : this->find(eachQuery, match) ) {
+			if ( included.insert(eachPosition).second ) {
+				headers.push_back(sortedHeaders_[recordOrder_[eachPosition]].first);
+			}
+		}
+	}
+	return headers;
+}
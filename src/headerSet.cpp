@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Header list set
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of the compact set of header list entries.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+
+#include "headerSet.hpp"
+#include "mappedFile.hpp"
+#include "inputStream.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	constexpr uint64_t hashMultiplier1{0x9E3779B97F4A7C15ULL};
+	constexpr uint64_t hashMultiplier2{0xC2B2AE3D27D4EB4FULL};
+	constexpr uint64_t hashMultiplier3{0x165667B19E3779F9ULL};
+	constexpr unsigned int wordBits{64};
+	constexpr unsigned int tagShift{32};
+	constexpr uint64_t positionMask{0xFFFFFFFFULL};
+	// Bloom filter bits per entry and probes per query; about 2% false positives
+	constexpr size_t bloomBitsPerEntry{8};
+	constexpr size_t nBloomProbes{4};
+
+	/** \brief Mix a word
+	 *
+	 * \param[in] word word to mix
+	 * \return mixed word
+	 */
+	inline uint64_t mixWord(uint64_t word) noexcept {
+		constexpr unsigned int shift1{29};
+		word *= hashMultiplier2;
+		word ^= word >> shift1;
+		return word;
+	}
+
+	/** \brief Smallest power of two not less than a number
+	 *
+	 * \param[in] number number
+	 * \return power of two
+	 */
+	size_t powerOfTwo(const size_t &number) noexcept {
+		size_t power{1};
+		while (power < number) {
+			power <<= 1;
+		}
+		return power;
+	}
+}
+
+HeaderSet::HeaderSet(const std::vector<std::string> &headerList) {
+	size_t arenaSize{0};
+	for (const auto &eachHeader : headerList) {
+		arenaSize += eachHeader.size();
+	}
+	arena_.reserve(arenaSize);
+	entries_.reserve( headerList.size() );
+	for (const auto &eachHeader : headerList) {
+		Entry newEntry;
+		newEntry.offset = arena_.size();
+		newEntry.length = eachHeader.size();
+		arena_ += eachHeader;
+		entries_.push_back(newEntry);
+	}
+	this->build_();
+}
+
+HeaderSet::HeaderSet(const std::string &headerFileName) {
+	std::fstream listFile;
+	listFile.open(headerFileName, std::ios::in);
+	if ( !listFile.is_open() ) {
+		return;
+	}
+	listFile.close();
+	arena_ = readWholeFile(headerFileName, 1);
+	size_t lineStart{0};
+	while ( lineStart < arena_.size() ) {
+		const auto *lineFeed = static_cast<const char*>( std::memchr( arena_.data() + lineStart, '\n', arena_.size() - lineStart ) );
+		const size_t lineEnd = ( lineFeed == nullptr ? arena_.size() : static_cast<size_t>(lineFeed - arena_.data()) );
+		if (lineEnd > lineStart) {
+			Entry newEntry;
+			newEntry.offset = lineStart + static_cast<size_t>(arena_[lineStart] == '>');                   // remove starting '>' if exists
+			newEntry.length = lineEnd - newEntry.offset;
+			entries_.push_back(newEntry);
+		}
+		lineStart = lineEnd + 1;
+	}
+	this->build_();
+}
+
+size_t HeaderSet::find(const CharView &header) const {
+	if ( entries_.empty() ) {
+		return 0;
+	}
+	const uint64_t hash = hashBytes(header);
+	if ( !this->mayContain_(hash) ) {
+		return entries_.size();
+	}
+	const uint64_t tag = hash >> tagShift;
+	const size_t slotMask = slots_.size() - 1;
+	for (size_t iSlot = hash & slotMask; slots_[iSlot] != 0; iSlot = (iSlot + 1) & slotMask) {
+		if ( (slots_[iSlot] >> tagShift) != tag ) {
+			continue;
+		}
+		const size_t position = (slots_[iSlot] & positionMask) - 1;
+		const Entry &candidate = entries_[position];
+		if ( (candidate.length == header.length) && (std::memcmp(arena_.data() + candidate.offset, header.start, header.length) == 0) ) {
+			return position;
+		}
+	}
+	return entries_.size();
+}
+
+uint64_t HeaderSet::hashBytes(const CharView &bytes) noexcept {
+	constexpr size_t wordSize{sizeof(uint64_t)};
+	uint64_t hash = hashMultiplier3 ^ (bytes.length * hashMultiplier1);
+	const char *current = bytes.start;
+	size_t nRemaining   = bytes.length;
+	while (nRemaining >= wordSize) {
+		uint64_t word{0};
+		std::memcpy(&word, current, wordSize);
+		hash        = (hash ^ mixWord(word) ) * hashMultiplier1;
+		current    += wordSize;
+		nRemaining -= wordSize;
+	}
+	if (nRemaining > 0) {
+		uint64_t word{0};
+		std::memcpy(&word, current, nRemaining);
+		hash = (hash ^ mixWord(word) ) * hashMultiplier1;
+	}
+	constexpr unsigned int finalShift1{32};
+	constexpr unsigned int finalShift2{29};
+	hash ^= hash >> finalShift1;
+	hash *= hashMultiplier3;
+	hash ^= hash >> finalShift2;
+	return hash;
+}
+
+void HeaderSet::build_() {
+	if ( entries_.size() >= positionMask ) {
+		throw std::string("ERROR: header lists are limited to ") + std::to_string(positionMask - 1) + std::string(" entries in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	// load factor of at most one half keeps probe sequences short
+	slots_.assign(powerOfTwo( 2 * std::max(entries_.size(), static_cast<size_t>(1)) ), 0);
+	bloomBits_.assign(std::max(powerOfTwo(bloomBitsPerEntry * entries_.size()), static_cast<size_t>(wordBits)) / wordBits, 0);
+	const size_t slotMask  = slots_.size() - 1;
+	const size_t bloomMask = bloomBits_.size() * wordBits - 1;
+	size_t nUnique{0};
+	for (size_t iEntry = 0; iEntry < entries_.size(); ++iEntry) {
+		const Entry &current = entries_[iEntry];
+		const uint64_t hash  = hashBytes( CharView{arena_.data() + current.offset, current.length} );
+		const uint64_t tag   = hash >> tagShift;
+		size_t iSlot         = hash & slotMask;
+		bool isDuplicate{false};
+		while (slots_[iSlot] != 0) {
+			const Entry &stored = entries_[(slots_[iSlot] & positionMask) - 1];
+			if ( ( (slots_[iSlot] >> tagShift) == tag ) && (stored.length == current.length)
+					&& (std::memcmp(arena_.data() + stored.offset, arena_.data() + current.offset, current.length) == 0) ) {
+				isDuplicate = true;
+				break;
+			}
+			iSlot = (iSlot + 1) & slotMask;
+		}
+		if (isDuplicate) {
+			continue;
+		}
+		// unique entries are compacted towards the front, so positions are in list order without duplicates
+		entries_[nUnique] = current;
+		slots_[iSlot]     = (tag << tagShift) | (nUnique + 1);
+		++nUnique;
+		const uint64_t step = (hash >> tagShift) | 1;
+		for (size_t iProbe = 0; iProbe < nBloomProbes; ++iProbe) {
+			const uint64_t bit = (hash + iProbe * step) & bloomMask;
+			bloomBits_[bit / wordBits] |= (static_cast<uint64_t>(1) << (bit % wordBits));
+		}
+	}
+	entries_.resize(nUnique);
+	entries_.shrink_to_fit();
+}
+
+bool HeaderSet::mayContain_(const uint64_t &hash) const {
+	if ( bloomBits_.empty() ) {
+		return false;
+	}
+	const size_t bloomMask = bloomBits_.size() * wordBits - 1;
+	const uint64_t step    = (hash >> tagShift) | 1;
+	for (size_t iProbe = 0; iProbe < nBloomProbes; ++iProbe) {
+		const uint64_t bit = (hash + iProbe * step) & bloomMask;
+		if ( ( bloomBits_[bit / wordBits] & (static_cast<uint64_t>(1) << (bit % wordBits)) ) == 0 ) {
+			return false;
+		}
+	}
+	return true;
+}
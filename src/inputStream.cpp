@@ -0,0 +1,675 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Plain and compressed input
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of byte streams that read plain, gzip, or BGZF-compressed files, and of random access to BGZF files.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <fstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef SUBSETFA_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "inputStream.hpp"
+#include "fastaIndex.hpp"
+#include "utilities.hpp"
+#include "runStatistics.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	constexpr size_t gzipReadSize{262144};                                                           // 256 KiB
+	constexpr size_t bgzfHeaderSize{18};
+	constexpr size_t bgzfFooterSize{8};
+	constexpr size_t bgzfMaxBlockSize{65536};
+	constexpr size_t bgzfBlocksPerThread{64};
+	constexpr unsigned char gzipMagic1{0x1f};
+	constexpr unsigned char gzipMagic2{0x8b};
+	constexpr unsigned char extraFieldFlag{0x04};
+	constexpr size_t readAheadBlockSize{4194304};                                                    // 4 MiB
+	// number of read-ahead blocks; caps the memory used to 16 MiB
+	constexpr size_t readAheadDepth{4};
+
+	/** \brief Open a file for reading
+	 *
+	 * \param[in] fileName file name
+	 * \return file descriptor
+	 */
+	int openForReading(const std::string &fileName) {
+		const int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+		if (fileDescriptor == -1) {
+			throw std::string("ERROR: cannot open file ") + fileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		return fileDescriptor;
+	}
+
+	/** \brief Read bytes until the request is satisfied or the file ends
+	 *
+	 * \param[in] fileDescriptor file descriptor
+	 * \param[out] destination destination buffer
+	 * \param[in] nBytes number of bytes to read
+	 * \return number of bytes read
+	 */
+	size_t readFully(const int &fileDescriptor, char *destination, const size_t &nBytes) {
+		size_t nRead{0};
+		while (nRead < nBytes) {
+			const ssize_t readResult = ::read(fileDescriptor, destination + nRead, nBytes - nRead);
+			if (readResult < 0) {
+				throw std::string("ERROR: failed to read input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			if (readResult == 0) {
+				break;
+			}
+			nRead += static_cast<size_t>(readResult);
+		}
+		RunStatistics::countBytesRead(nRead);
+		return nRead;
+	}
+
+	/** \brief Read bytes at an offset until the request is satisfied or the file ends
+	 *
+	 * \param[in] fileDescriptor file descriptor
+	 * \param[out] destination destination buffer
+	 * \param[in] nBytes number of bytes to read
+	 * \param[in] offset file offset
+	 * \return number of bytes read
+	 */
+	size_t preadFully(const int &fileDescriptor, char *destination, const size_t &nBytes, const uint64_t &offset) {
+		size_t nRead{0};
+		while (nRead < nBytes) {
+			const ssize_t readResult = pread( fileDescriptor, destination + nRead, nBytes - nRead, static_cast<off_t>(offset + nRead) );
+			if (readResult < 0) {
+				throw std::string("ERROR: failed to read input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			if (readResult == 0) {
+				break;
+			}
+			nRead += static_cast<size_t>(readResult);
+		}
+		RunStatistics::countBytesRead(nRead);
+		return nRead;
+	}
+
+	/** \brief Little-endian unsigned integer from bytes
+	 *
+	 * \param[in] bytes pointer to the first byte
+	 * \param[in] nBytes number of bytes (at most 8)
+	 * \return the integer
+	 */
+	uint64_t littleEndian(const char *bytes, const size_t &nBytes) {
+		uint64_t value{0};
+		for (size_t iByte = 0; iByte < nBytes; ++iByte) {
+			value |= static_cast<uint64_t>( static_cast<unsigned char>(bytes[iByte]) ) << (8 * iByte);
+		}
+		return value;
+	}
+
+	/** \brief Total size of a BGZF block from its header
+	 *
+	 * Throws if the block is too small to hold its header and footer.
+	 *
+	 * \param[in] header the first `bgzfHeaderSize` bytes of the block
+	 * \return block size in bytes
+	 */
+	size_t bgzfBlockSize(const char *header) {
+		const bool isBGZF = (static_cast<unsigned char>(header[0]) == gzipMagic1) && (static_cast<unsigned char>(header[1]) == gzipMagic2)
+			&& ( (static_cast<unsigned char>(header[3]) & extraFieldFlag) != 0 ) && (header[12] == 'B') && (header[13] == 'C')
+			&& (littleEndian(header + 14, 2) == 2);
+		if (!isBGZF) {
+			throw std::string("ERROR: malformed BGZF block header in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		const size_t blockSize = littleEndian(header + 16, 2) + 1;
+		if (blockSize < bgzfHeaderSize + bgzfFooterSize) {
+			throw std::string("ERROR: malformed BGZF block in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		return blockSize;
+	}
+
+	/** \brief Uncompressed size of a BGZF block from its footer
+	 *
+	 * Throws if the size is larger than a BGZF block can hold.
+	 *
+	 * \param[in] footerEnd pointer one past the last byte of the block
+	 * \return uncompressed size in bytes
+	 */
+	size_t bgzfInflatedSize(const char *footerEnd) {
+		const size_t inflatedSize = littleEndian(footerEnd - 4, 4);
+		if (inflatedSize > bgzfMaxBlockSize) {
+			throw std::string("ERROR: malformed BGZF block in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		return inflatedSize;
+	}
+
+	/** \brief Decompress a BGZF block
+	 *
+	 * \param[in] block pointer to the first byte of the block
+	 * \param[in] blockSize block size in bytes
+	 * \param[out] destination destination buffer with room for the uncompressed size stored in the block footer
+	 */
+	void inflateBgzfBlock(const char *block, const size_t &blockSize, char *destination) {
+#ifdef SUBSETFA_HAVE_ZLIB
+		const size_t dataStart  = 12 + littleEndian(block + 10, 2);
+		const auto inflatedSize = static_cast<uInt>( bgzfInflatedSize(block + blockSize) );
+		const uLong expectedCRC = littleEndian(block + blockSize - bgzfFooterSize, 4);
+		if (dataStart + bgzfFooterSize > blockSize) {
+			throw std::string("ERROR: malformed BGZF block in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		z_stream zStream{};
+		// negative window bits: raw deflate data without a zlib or gzip wrapper
+		constexpr int rawWindowBits{-15};
+		if (inflateInit2(&zStream, rawWindowBits) != Z_OK) {
+			throw std::string("ERROR: cannot initialize decompression in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		zStream.next_in   = reinterpret_cast<Bytef*>( const_cast<char*>(block + dataStart) );
+		zStream.avail_in  = static_cast<uInt>(blockSize - dataStart - bgzfFooterSize);
+		// zlib rejects a null output pointer, which an empty block (e.g., the end-of-file marker of an empty file) may be given
+		Bytef emptyOutput{0};
+		zStream.next_out  = (inflatedSize == 0) ? &emptyOutput : reinterpret_cast<Bytef*>(destination);
+		zStream.avail_out = inflatedSize;
+		const int inflateResult = inflate(&zStream, Z_FINISH);
+		inflateEnd(&zStream);
+		if ( (inflateResult != Z_STREAM_END) || (zStream.avail_out != 0) ) {
+			throw std::string("ERROR: corrupt BGZF block in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		if (crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(destination), inflatedSize) != expectedCRC) {
+			throw std::string("ERROR: BGZF block checksum mismatch in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+#else
+		static_cast<void>(block);
+		static_cast<void>(blockSize);
+		static_cast<void>(destination);
+		throw std::string("ERROR: compressed input requires zlib support in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+#endif
+	}
+}
+
+Compression BayesicSpace::detectCompression(const std::string &fileName) {
+	const int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if (fileDescriptor == -1) {
+		return Compression::none;
+	}
+	std::array<char, bgzfHeaderSize> header{};
+	const size_t nRead = readFully( fileDescriptor, header.data(), header.size() );
+	close(fileDescriptor);
+	if ( (nRead < 2) || (static_cast<unsigned char>(header[0]) != gzipMagic1) || (static_cast<unsigned char>(header[1]) != gzipMagic2) ) {
+		return Compression::none;
+	}
+	const bool isBGZF = (nRead == bgzfHeaderSize) && ( (static_cast<unsigned char>(header[3]) & extraFieldFlag) != 0 )
+		&& (header[12] == 'B') && (header[13] == 'C');
+	return isBGZF ? Compression::bgzf : Compression::gzip;
+}
+
+std::unique_ptr<InputStream> BayesicSpace::openInputStream(const std::string &fileName, const size_t &nThreads) {
+	switch ( detectCompression(fileName) ) {
+		case Compression::bgzf:
+			return std::unique_ptr<InputStream>( new BgzfInputStream(fileName, nThreads) );
+		case Compression::gzip:
+			return std::unique_ptr<InputStream>( new GzipInputStream(fileName) );
+		default:
+			return std::unique_ptr<InputStream>( new PlainInputStream(fileName) );
+	}
+}
+
+std::unique_ptr<InputStream> BayesicSpace::openReadAheadStream(const std::string &fileName, const size_t &nThreads) {
+	return std::unique_ptr<InputStream>( new ReadAheadInputStream( openInputStream(fileName, nThreads) ) );
+}
+
+std::string BayesicSpace::readWholeFile(const std::string &fileName, const size_t &nThreads) {
+	std::unique_ptr<InputStream> input{openInputStream(fileName, nThreads)};
+	constexpr size_t minGrowth{65536};
+	// a plain file fits with one byte to spare, so the read that finds its end needs no reallocation; decompressed data grows the buffer geometrically
+	std::string contents(fileSize(fileName) + 1, '\0');
+	size_t nFilled{0};
+	while (true) {
+		if ( nFilled == contents.size() ) {
+			contents.resize( std::max(2 * contents.size(), minGrowth) );
+		}
+		const size_t nRead = input->read(&contents[nFilled], contents.size() - nFilled);
+		if (nRead == 0) {
+			break;
+		}
+		nFilled += nRead;
+	}
+	contents.resize(nFilled);
+	return contents;
+}
+
+PlainInputStream::PlainInputStream(const std::string &fileName) : fileDescriptor_{openForReading(fileName)} {
+	posix_fadvise(fileDescriptor_, 0, 0, POSIX_FADV_SEQUENTIAL);                                    // a hint only; failure is harmless
+}
+
+PlainInputStream::~PlainInputStream() {
+	close(fileDescriptor_);
+}
+
+size_t PlainInputStream::read(char *destination, const size_t &nBytes) {
+	return readFully(fileDescriptor_, destination, nBytes);
+}
+
+GzipInputStream::GzipInputStream(const std::string &fileName) : fileDescriptor_{openForReading(fileName)}, compressedBuffer_(gzipReadSize) {
+#ifdef SUBSETFA_HAVE_ZLIB
+	zStream_ = std::shared_ptr<void>( new z_stream{}, [](void *zStream){
+			inflateEnd( static_cast<z_stream*>(zStream) );
+			delete static_cast<z_stream*>(zStream);
+		}
+	);
+	// 16 added to the window bits: expect a gzip wrapper
+	constexpr int gzipWindowBits{15 + 16};
+	if (inflateInit2(static_cast<z_stream*>( zStream_.get() ), gzipWindowBits) != Z_OK) {
+		close(fileDescriptor_);
+		throw std::string("ERROR: cannot initialize decompression in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+#else
+	close(fileDescriptor_);
+	throw std::string("ERROR: compressed input requires zlib support in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+#endif
+}
+
+GzipInputStream::~GzipInputStream() {
+	close(fileDescriptor_);
+}
+
+size_t GzipInputStream::read(char *destination, const size_t &nBytes) {
+#ifdef SUBSETFA_HAVE_ZLIB
+	auto *zStream      = static_cast<z_stream*>( zStream_.get() );
+	size_t nDecoded{0};
+	while (nDecoded < nBytes) {
+		if ( (zStream->avail_in == 0) && !compressedEnd_ ) {
+			const size_t nRead = readFully( fileDescriptor_, compressedBuffer_.data(), compressedBuffer_.size() );
+			compressedEnd_     = (nRead == 0);
+			zStream->next_in   = reinterpret_cast<Bytef*>( compressedBuffer_.data() );
+			zStream->avail_in  = static_cast<uInt>(nRead);
+		}
+		if (zStream->avail_in == 0) {
+			if (!memberEnd_) {
+				throw std::string("ERROR: truncated gzip input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			break;
+		}
+		if (memberEnd_) {                                                                               // another gzip member follows
+			inflateReset(zStream);
+			memberEnd_ = false;
+		}
+		// a gzip stream can hold at most 4 GiB per call
+		const size_t nRequested = std::min(nBytes - nDecoded, static_cast<size_t>(UINT32_MAX));
+		zStream->next_out       = reinterpret_cast<Bytef*>(destination + nDecoded);
+		zStream->avail_out      = static_cast<uInt>(nRequested);
+		const int inflateResult = inflate(zStream, Z_NO_FLUSH);
+		nDecoded               += nRequested - zStream->avail_out;
+		if (inflateResult == Z_STREAM_END) {
+			memberEnd_ = true;
+		} else if ( (inflateResult != Z_OK) && (inflateResult != Z_BUF_ERROR) ) {
+			throw std::string("ERROR: corrupt gzip input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+	}
+	return nDecoded;
+#else
+	static_cast<void>(destination);
+	static_cast<void>(nBytes);
+	return 0;
+#endif
+}
+
+BgzfInputStream::BgzfInputStream(const std::string &fileName, const size_t &nThreads) :
+		fileDescriptor_{openForReading(fileName)}, nThreads_{std::max( nThreads, static_cast<size_t>(1) )} {
+	nextBatch_ = std::async(std::launch::async, &BgzfInputStream::decodeBatch_, this);
+}
+
+BgzfInputStream::~BgzfInputStream() {
+	if ( nextBatch_.valid() ) {
+		try {
+			nextBatch_.wait();
+		} catch(...) {                                                                                  // errors are reported by read()
+		}
+	}
+	close(fileDescriptor_);
+}
+
+size_t BgzfInputStream::read(char *destination, const size_t &nBytes) {
+	size_t nCopied{0};
+	while (nCopied < nBytes) {
+		if ( batchPosition_ == currentBatch_.size() ) {
+			if ( !nextBatch_.valid() ) {
+				break;
+			}
+			currentBatch_  = nextBatch_.get();
+			batchPosition_ = 0;
+			if ( currentBatch_.empty() ) {
+				break;
+			}
+			nextBatch_ = std::async(std::launch::async, &BgzfInputStream::decodeBatch_, this);
+		}
+		const size_t nToCopy = std::min(nBytes - nCopied, currentBatch_.size() - batchPosition_);
+		std::memcpy(destination + nCopied, currentBatch_.data() + batchPosition_, nToCopy);
+		nCopied        += nToCopy;
+		batchPosition_ += nToCopy;
+	}
+	return nCopied;
+}
+
+std::vector<char> BgzfInputStream::decodeBatch_() {
+	// a batch of only empty blocks decodes to nothing, so batches are read until one has data or the file ends
+	std::vector<char> decodedBatch;
+	while ( decodedBatch.empty() && !compressedEnd_ ) {
+		decodedBatch = this->decodeBlocks_();
+	}
+	return decodedBatch;
+}
+
+std::vector<char> BgzfInputStream::decodeBlocks_() {
+	std::vector<char> compressedBlocks;
+	std::vector<size_t> blockStarts;
+	std::vector<size_t> outputStarts{0};
+	const size_t maxBlocks = bgzfBlocksPerThread * nThreads_;
+	while ( !compressedEnd_ && (blockStarts.size() < maxBlocks) ) {
+		const size_t blockStart = compressedBlocks.size();
+		compressedBlocks.resize(blockStart + bgzfHeaderSize);
+		const size_t nHeaderBytes = readFully(fileDescriptor_, compressedBlocks.data() + blockStart, bgzfHeaderSize);
+		if (nHeaderBytes == 0) {
+			compressedBlocks.resize(blockStart);
+			compressedEnd_ = true;
+			break;
+		}
+		if (nHeaderBytes < bgzfHeaderSize) {
+			throw std::string("ERROR: truncated BGZF input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		const size_t blockSize = bgzfBlockSize(compressedBlocks.data() + blockStart);
+		compressedBlocks.resize(blockStart + blockSize);
+		if (readFully(fileDescriptor_, compressedBlocks.data() + blockStart + bgzfHeaderSize, blockSize - bgzfHeaderSize) < blockSize - bgzfHeaderSize) {
+			throw std::string("ERROR: truncated BGZF input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		blockStarts.push_back(blockStart);
+		outputStarts.push_back( outputStarts.back() + bgzfInflatedSize(compressedBlocks.data() + blockStart + blockSize) );
+	}
+	blockStarts.push_back( compressedBlocks.size() );
+	std::vector<char> decodedBatch( outputStarts.back() );
+	const size_t nBlocks = blockStarts.size() - 1;
+	// each thread decompresses a contiguous run of blocks
+	auto inflateBlocks = [&](const size_t &firstBlock, const size_t &lastBlock){
+		for (size_t iBlock = firstBlock; iBlock < lastBlock; ++iBlock) {
+			inflateBgzfBlock(compressedBlocks.data() + blockStarts[iBlock], blockStarts[iBlock + 1] - blockStarts[iBlock], decodedBatch.data() + outputStarts[iBlock]);
+		}
+	};
+	const size_t nWorkers = std::min(nThreads_, nBlocks);
+	std::vector< std::future<void> > workers;
+	for (size_t iWorker = 1; iWorker < nWorkers; ++iWorker) {
+		workers.emplace_back( std::async(std::launch::async, inflateBlocks, iWorker * nBlocks / nWorkers, (iWorker + 1) * nBlocks / nWorkers) );
+	}
+	inflateBlocks(0, nWorkers == 0 ? 0 : nBlocks / nWorkers);
+	for (auto &eachWorker : workers) {
+		eachWorker.get();
+	}
+	return decodedBatch;
+}
+
+ReadAheadInputStream::ReadAheadInputStream(std::unique_ptr<InputStream> source) :
+		source_{std::move(source)}, filledBlocks_(readAheadDepth), emptyBlocks_(readAheadDepth) {
+	for (size_t iBlock = 0; iBlock < readAheadDepth; ++iBlock) {
+		Block emptyBlock;
+		emptyBlock.bytes.reset(new char[readAheadBlockSize]);
+		emptyBlocks_.tryPush(emptyBlock);
+	}
+	readThread_ = std::thread(&ReadAheadInputStream::readAhead_, this);
+}
+
+ReadAheadInputStream::~ReadAheadInputStream() {
+	cancelled_ = true;
+	readThread_.join();
+}
+
+size_t ReadAheadInputStream::read(char *destination, const size_t &nBytes) {
+	size_t nRead{0};
+	while ( (nRead < nBytes) && !endOfInput_ ) {
+		if (blockPosition_ == currentBlock_.size) {
+			// the consumed block goes back to the reading thread; the queue has room for all blocks, so this cannot fail
+			if (currentBlock_.bytes != nullptr) {
+				emptyBlocks_.tryPush(currentBlock_);
+			}
+			size_t nAttempts{0};
+			while ( !filledBlocks_.tryPop(currentBlock_) ) {
+				backOff(nAttempts);
+			}
+			blockPosition_ = 0;
+			if (currentBlock_.size == 0) {
+				endOfInput_ = true;
+				if (readError_ != nullptr) {
+					std::rethrow_exception(readError_);
+				}
+				break;
+			}
+		}
+		const size_t nToCopy = std::min(nBytes - nRead, currentBlock_.size - blockPosition_);
+		std::memcpy(destination + nRead, currentBlock_.bytes.get() + blockPosition_, nToCopy);
+		blockPosition_ += nToCopy;
+		nRead          += nToCopy;
+	}
+	return nRead;
+}
+
+void ReadAheadInputStream::readAhead_() {
+	bool atEnd{false};
+	while (!atEnd) {
+		Block block;
+		size_t nAttempts{0};
+		while ( !emptyBlocks_.tryPop(block) ) {
+			if (cancelled_) {
+				return;
+			}
+			backOff(nAttempts);
+		}
+		try {
+			block.size = source_->read(block.bytes.get(), readAheadBlockSize);
+		} catch(...) {
+			readError_ = std::current_exception();                                                      // seen by the consumer after the end-of-input block
+			block.size = 0;
+		}
+		atEnd     = (block.size == 0);
+		nAttempts = 0;
+		while ( !filledBlocks_.tryPush(block) ) {
+			if (cancelled_) {
+				return;
+			}
+			backOff(nAttempts);
+		}
+	}
+}
+
+BgzfIndex::BgzfIndex(const std::string &bgzfFileName) {
+	const std::string indexFileName = bgzfFileName + std::string(".gzi");
+	if ( FastaIndex::isFresh(bgzfFileName, indexFileName) ) {
+		std::fstream inIndex;
+		inIndex.open(indexFileName, std::ios::in | std::ios::binary);
+		std::array<char, sizeof(uint64_t)> numberBytes{};
+		inIndex.read( numberBytes.data(), numberBytes.size() );
+		const uint64_t nEntries = littleEndian( numberBytes.data(), numberBytes.size() );
+		// the entry count must account for the rest of the file, so that a corrupt count cannot drive the reads below
+		const size_t indexSize = fileSize(indexFileName);
+		const bool sizeMatches = inIndex.good() && ( nEntries == (indexSize - numberBytes.size()) / (2 * numberBytes.size()) )
+			&& ( (indexSize - numberBytes.size()) % (2 * numberBytes.size()) == 0 );
+		compressedOffsets_.push_back(0);
+		uncompressedOffsets_.push_back(0);
+		for (uint64_t iEntry = 0; sizeMatches && (iEntry < nEntries); ++iEntry) {
+			inIndex.read( numberBytes.data(), numberBytes.size() );
+			compressedOffsets_.push_back( littleEndian( numberBytes.data(), numberBytes.size() ) );
+			inIndex.read( numberBytes.data(), numberBytes.size() );
+			uncompressedOffsets_.push_back( littleEndian( numberBytes.data(), numberBytes.size() ) );
+			if ( !inIndex.good() ) {
+				break;
+			}
+		}
+		if ( !sizeMatches || !inIndex.good() ) {
+			throw std::string("ERROR: malformed BGZF index file ") + indexFileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		RunStatistics::countBytesRead(indexSize);
+		return;
+	}
+	const int fileDescriptor = openForReading(bgzfFileName);
+	std::array<char, bgzfHeaderSize> header{};
+	std::array<char, 4> inflatedSize{};
+	uint64_t compressedOffset{0};
+	uint64_t uncompressedOffset{0};
+	try {
+		while (preadFully(fileDescriptor, header.data(), header.size(), compressedOffset) == header.size()) {
+			compressedOffsets_.push_back(compressedOffset);
+			uncompressedOffsets_.push_back(uncompressedOffset);
+			const size_t blockSize = bgzfBlockSize( header.data() );
+			if (preadFully(fileDescriptor, inflatedSize.data(), inflatedSize.size(), compressedOffset + blockSize - inflatedSize.size()) < inflatedSize.size()) {
+				throw std::string("ERROR: truncated BGZF input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+			}
+			compressedOffset   += blockSize;
+			uncompressedOffset += bgzfInflatedSize( inflatedSize.data() + inflatedSize.size() );
+		}
+	} catch(...) {
+		close(fileDescriptor);
+		throw;
+	}
+	close(fileDescriptor);
+	if ( compressedOffsets_.empty() ) {
+		compressedOffsets_.push_back(0);
+		uncompressedOffsets_.push_back(0);
+	}
+	this->save(indexFileName);
+}
+
+BgzfIndex::BgzfIndex(std::vector<uint64_t> compressedOffsets, std::vector<uint64_t> uncompressedOffsets) :
+		compressedOffsets_{std::move(compressedOffsets)}, uncompressedOffsets_{std::move(uncompressedOffsets)} {
+	if ( compressedOffsets_.size() != uncompressedOffsets_.size() ) {
+		throw std::string("ERROR: compressed and uncompressed offset vectors must be the same size in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if ( compressedOffsets_.empty() ) {
+		compressedOffsets_.push_back(0);
+		uncompressedOffsets_.push_back(0);
+	}
+}
+
+void BgzfIndex::locate(const uint64_t &uncompressedOffset, uint64_t &compressedOffset, uint64_t &blockUncompressedOffset) const {
+	const auto blockIt            = std::prev( std::upper_bound(uncompressedOffsets_.cbegin() + 1, uncompressedOffsets_.cend(), uncompressedOffset) );
+	const auto blockIndex         = static_cast<size_t>( blockIt - uncompressedOffsets_.cbegin() );
+	compressedOffset              = compressedOffsets_[blockIndex];
+	blockUncompressedOffset       = uncompressedOffsets_[blockIndex];
+}
+
+void BgzfIndex::save(const std::string &indexFileName) const {
+	std::fstream outIndex;
+	outIndex.open(indexFileName, std::ios::out | std::ios::trunc | std::ios::binary);
+	auto writeNumber = [&outIndex](uint64_t number){
+		std::array<char, sizeof(uint64_t)> numberBytes{};
+		for (auto &eachByte : numberBytes) {
+			eachByte   = static_cast<char>(number & 0xff);
+			number   >>= 8;
+		}
+		outIndex.write( numberBytes.data(), numberBytes.size() );
+	};
+	// the first block, at offset 0 in both files, is implicit
+	writeNumber(compressedOffsets_.size() - 1);
+	for (size_t iBlock = 1; iBlock < compressedOffsets_.size(); ++iBlock) {
+		writeNumber(compressedOffsets_[iBlock]);
+		writeNumber(uncompressedOffsets_[iBlock]);
+	}
+	const std::streamoff nIndexBytes = outIndex.tellp();
+	outIndex.close();
+	if (nIndexBytes > 0) {
+		RunStatistics::countBytesWritten( static_cast<uint64_t>(nIndexBytes) );
+	}
+}
+
+BgzfReader::BgzfReader(const std::string &bgzfFileName) : index_(bgzfFileName) {
+	fileDescriptor_ = openForReading(bgzfFileName);
+}
+
+BgzfReader::~BgzfReader() {
+	if (fileDescriptor_ != -1) {
+		close(fileDescriptor_);
+	}
+}
+
+BgzfReader::BgzfReader(BgzfReader &&toMove) noexcept : fileDescriptor_{toMove.fileDescriptor_}, index_{std::move(toMove.index_)} {
+	toMove.fileDescriptor_ = -1;
+}
+
+BgzfReader& BgzfReader::operator=(BgzfReader &&toMove) noexcept {
+	if (this != &toMove) {
+		if (fileDescriptor_ != -1) {
+			close(fileDescriptor_);
+		}
+		fileDescriptor_        = toMove.fileDescriptor_;
+		index_                 = std::move(toMove.index_);
+		toMove.fileDescriptor_ = -1;
+	}
+	return *this;
+}
+
+size_t BgzfReader::read(const uint64_t &uncompressedOffset, const size_t &nBytes, char *destination) const {
+	uint64_t compressedOffset{0};
+	uint64_t blockUncompressedOffset{0};
+	index_.locate(uncompressedOffset, compressedOffset, blockUncompressedOffset);
+	size_t nCopied{0};
+	std::vector<char> block;
+	std::vector<char> inflatedBlock;
+	std::array<char, bgzfHeaderSize> header{};
+	// blocks are decompressed in turn, starting with the one that holds the first requested byte
+	while (nCopied < nBytes) {
+		if (preadFully(fileDescriptor_, header.data(), header.size(), compressedOffset) < header.size()) {
+			break;
+		}
+		const size_t blockSize = bgzfBlockSize( header.data() );
+		block.resize(blockSize);
+		if (preadFully(fileDescriptor_, block.data(), blockSize, compressedOffset) < blockSize) {
+			throw std::string("ERROR: truncated BGZF input in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		inflatedBlock.resize( bgzfInflatedSize(block.data() + blockSize) );
+		inflateBgzfBlock(block.data(), blockSize, inflatedBlock.data());
+		const uint64_t firstWanted = uncompressedOffset + nCopied;
+		if ( firstWanted < blockUncompressedOffset + inflatedBlock.size() ) {
+			const size_t skip    = firstWanted - blockUncompressedOffset;
+			const size_t nToCopy = std::min(nBytes - nCopied, inflatedBlock.size() - skip);
+			std::memcpy(destination + nCopied, inflatedBlock.data() + skip, nToCopy);
+			nCopied += nToCopy;
+		}
+		compressedOffset        += blockSize;
+		blockUncompressedOffset += inflatedBlock.size();
+	}
+	return nCopied;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Read-only memory-mapped files
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of memory-mapped file access and non-owning character views.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mappedFile.hpp"
+
+using namespace BayesicSpace;
+
+bool BayesicSpace::operator==(const CharView &lhs, const CharView &rhs) noexcept {
+	return (lhs.length == rhs.length) && ( (lhs.length == 0) || (std::memcmp(lhs.start, rhs.start, lhs.length) == 0) );
+}
+
+size_t CharViewHash::operator()(const CharView &view) const noexcept {
+	constexpr uint64_t fnvOffset{14695981039346656037ULL};
+	constexpr uint64_t fnvPrime{1099511628211ULL};
+	uint64_t hash{fnvOffset};
+	for (size_t iChar = 0; iChar < view.length; ++iChar) {
+		hash ^= static_cast<unsigned char>(view.start[iChar]);
+		hash *= fnvPrime;
+	}
+	return hash;
+}
+
+MappedFile::MappedFile(const std::string &fileName) {
+	const int fileDescriptor = open(fileName.c_str(), O_RDONLY);
+	if (fileDescriptor == -1) {
+		throw std::string("ERROR: cannot open file ") + fileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	struct stat fileStatus{};
+	if (fstat(fileDescriptor, &fileStatus) != 0) {
+		close(fileDescriptor);
+		throw std::string("ERROR: cannot get the size of file ") + fileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	size_ = static_cast<size_t>(fileStatus.st_size);
+	if (size_ == 0) {
+		close(fileDescriptor);
+		return;
+	}
+	void *mapStart = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	close(fileDescriptor);                                                                                // the mapping stays valid after the descriptor is closed
+	if (mapStart == MAP_FAILED) {
+		size_ = 0;
+		throw std::string("ERROR: cannot map file ") + fileName + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	data_ = static_cast<const char*>(mapStart);
+}
+
+MappedFile::~MappedFile() {
+	if (data_ != nullptr) {
+		munmap( const_cast<char*>(data_), size_ );
+	}
+}
+
+MappedFile::MappedFile(MappedFile &&toMove) noexcept : data_{toMove.data_}, size_{toMove.size_} {
+	toMove.data_ = nullptr;
+	toMove.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile &&toMove) noexcept {
+	if (this != &toMove) {
+		if (data_ != nullptr) {
+			munmap( const_cast<char*>(data_), size_ );
+		}
+		data_        = toMove.data_;
+		size_        = toMove.size_;
+		toMove.data_ = nullptr;
+		toMove.size_ = 0;
+	}
+	return *this;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Compact nucleotide sequence storage
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of the class that stores nucleotide sequences with two bits per base.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <array>
+
+#include "packedSequence.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	constexpr uint8_t notACGT{4};
+	constexpr char caseBit{0x20};
+
+	/** \brief Two-bit codes for each byte; `notACGT` for everything other than A, C, G, and T in either case */
+	const std::array<uint8_t, 256> baseCodeTable = [](){
+		std::array<uint8_t, 256> table{};
+		table.fill(notACGT);
+		table[static_cast<uint8_t>('A')] = 0;
+		table[static_cast<uint8_t>('C')] = 1;
+		table[static_cast<uint8_t>('G')] = 2;
+		table[static_cast<uint8_t>('T')] = 3;
+		table[static_cast<uint8_t>('a')] = 0;
+		table[static_cast<uint8_t>('c')] = 1;
+		table[static_cast<uint8_t>('g')] = 2;
+		table[static_cast<uint8_t>('t')] = 3;
+		return table;
+	}();
+
+	/** \brief The four upper-case bases encoded by each packed byte, in sequence order */
+	const std::array<std::array<char, 4>, 256> byteDecodeTable = [](){
+		constexpr std::array<char, 4> bases{ {'A', 'C', 'G', 'T'} };
+		std::array<std::array<char, 4>, 256> table{};
+		for (size_t iByte = 0; iByte < table.size(); ++iByte) {
+			for (size_t iBase = 0; iBase < 4; ++iBase) {
+				table[iByte][iBase] = bases[(iByte >> (2 * iBase)) & 3];
+			}
+		}
+		return table;
+	}();
+}
+
+PackedSequence::PackedSequence(const std::string &sequence) : length_{sequence.size()}, baseCodes_( (sequence.size() + 3) / 4, 0 ) {
+	for (size_t iBase = 0; iBase < sequence.size(); ++iBase) {
+		const char base  = sequence[iBase];
+		const uint8_t code = baseCodeTable[static_cast<uint8_t>(base)];
+		if ( (base >= 'a') && (base <= 'z') ) {
+			if ( !lowerCaseRuns_.empty() && (lowerCaseRuns_.back().start + lowerCaseRuns_.back().length == iBase) ) {
+				++lowerCaseRuns_.back().length;
+			} else {
+				lowerCaseRuns_.push_back( CharacterRun{iBase, 1, ' '} );
+			}
+		}
+		if (code == notACGT) {
+			const char upperCase = ( (base >= 'a') && (base <= 'z') ? static_cast<char>(base & ~caseBit) : base );
+			if ( !exceptionRuns_.empty() && (exceptionRuns_.back().character == upperCase) && (exceptionRuns_.back().start + exceptionRuns_.back().length == iBase) ) {
+				++exceptionRuns_.back().length;
+			} else {
+				exceptionRuns_.push_back( CharacterRun{iBase, 1, upperCase} );
+			}
+			continue;
+		}
+		baseCodes_[iBase / 4] = static_cast<uint8_t>( baseCodes_[iBase / 4] | (code << ( 2 * (iBase % 4) ) ) );
+	}
+	exceptionRuns_.shrink_to_fit();
+	lowerCaseRuns_.shrink_to_fit();
+}
+
+std::string PackedSequence::unpack() const {
+	std::string sequence(static_cast<size_t>(length_), '\0');
+	const size_t nFullBytes = sequence.size() / 4;
+	for (size_t iByte = 0; iByte < nFullBytes; ++iByte) {
+		std::memcpy(&sequence[4 * iByte], byteDecodeTable[baseCodes_[iByte]].data(), 4);
+	}
+	for (size_t iBase = 4 * nFullBytes; iBase < sequence.size(); ++iBase) {
+		sequence[iBase] = byteDecodeTable[baseCodes_[nFullBytes]][iBase % 4];
+	}
+	for (const auto &eachRun : exceptionRuns_) {
+		std::memset(&sequence[eachRun.start], eachRun.character, eachRun.length);
+	}
+	for (const auto &eachRun : lowerCaseRuns_) {
+		for (uint64_t iBase = eachRun.start; iBase < eachRun.start + eachRun.length; ++iBase) {
+			sequence[iBase] = static_cast<char>(sequence[iBase] | caseBit);
+		}
+	}
+	return sequence;
+}
+
+size_t PackedSequence::memoryBytes() const noexcept {
+	return baseCodes_.capacity() + ( exceptionRuns_.capacity() + lowerCaseRuns_.capacity() ) * sizeof(CharacterRun);
+}
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Run statistics
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of phase timing and resource use statistics.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <ostream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+
+#include <sys/resource.h>
+
+#include "runStatistics.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	/** \brief Bytes read by the process */
+	std::atomic<uint64_t> nBytesRead{0};
+	/** \brief Bytes written by the process */
+	std::atomic<uint64_t> nBytesWritten{0};
+
+	/** \brief Find a named entry, adding it if absent
+	 *
+	 * \tparam ValueT value type
+	 * \param[in,out] entries named entries
+	 * \param[in] name entry name
+	 * \return reference to the entry value
+	 */
+	template <typename ValueT>
+	ValueT& namedEntry(std::vector< std::pair<std::string, ValueT> > &entries, const std::string &name) {
+		auto entryIt = std::find_if(entries.begin(), entries.end(), [&name](const std::pair<std::string, ValueT> &entry){return entry.first == name;});
+		if ( entryIt == entries.end() ) {
+			entries.emplace_back( name, ValueT{} );
+			return entries.back().second;
+		}
+		return entryIt->second;
+	}
+
+	/** \brief Value of a named entry
+	 *
+	 * \tparam ValueT value type
+	 * \param[in] entries named entries
+	 * \param[in] name entry name
+	 * \return entry value; default value if absent
+	 */
+	template <typename ValueT>
+	ValueT namedValue(const std::vector< std::pair<std::string, ValueT> > &entries, const std::string &name) {
+		auto entryIt = std::find_if(entries.cbegin(), entries.cend(), [&name](const std::pair<std::string, ValueT> &entry){return entry.first == name;});
+		return ( entryIt == entries.cend() ? ValueT{} : entryIt->second );
+	}
+}
+
+void RunStatistics::startPhase(const std::string &phaseName) {
+	if (!enabled_) {
+		return;
+	}
+	this->endPhase();
+	auto phaseIt = std::find_if(phaseSeconds_.cbegin(), phaseSeconds_.cend(), [&phaseName](const std::pair<std::string, double> &entry){return entry.first == phaseName;});
+	currentPhase_ = static_cast<size_t>( phaseIt - phaseSeconds_.cbegin() );
+	if ( phaseIt == phaseSeconds_.cend() ) {
+		phaseSeconds_.emplace_back(phaseName, 0.0);
+	}
+	inPhase_      = true;
+	phaseStart_   = std::chrono::steady_clock::now();
+}
+
+void RunStatistics::endPhase() {
+	if (!enabled_ || !inPhase_) {
+		return;
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - phaseStart_;
+	phaseSeconds_[currentPhase_].second += elapsed.count();
+	inPhase_ = false;
+}
+
+void RunStatistics::addCount(const std::string &countName, const uint64_t &value) {
+	if (!enabled_) {
+		return;
+	}
+	namedEntry(counts_, countName) += value;
+}
+
+void RunStatistics::setValue(const std::string &valueName, const double &value) {
+	if (!enabled_) {
+		return;
+	}
+	namedEntry(values_, valueName) = value;
+}
+
+double RunStatistics::phaseSeconds(const std::string &phaseName) const {
+	return namedValue(phaseSeconds_, phaseName);
+}
+
+uint64_t RunStatistics::count(const std::string &countName) const {
+	return namedValue(counts_, countName);
+}
+
+void RunStatistics::report(std::ostream &outStream) const {
+	outStream << "Phase times (s):\n";
+	for (const auto &eachPhase : phaseSeconds_) {
+		outStream << "  " << eachPhase.first << ": " << eachPhase.second << "\n";
+	}
+	outStream << "Counts:\n";
+	for (const auto &eachCount : counts_) {
+		outStream << "  " << eachCount.first << ": " << eachCount.second << "\n";
+	}
+	outStream << "Measurements:\n";
+	for (const auto &eachValue : values_) {
+		outStream << "  " << eachValue.first << ": " << eachValue.second << "\n";
+	}
+	outStream << "  peak RSS (kB): " << peakRSS() << "\n";
+}
+
+std::string RunStatistics::json() const {
+	std::stringstream jsonStream;
+	auto writeObject = [&jsonStream](const std::string &objectName, const auto &entries){
+		jsonStream << "  \"" << objectName << "\": {";
+		for (size_t iEntry = 0; iEntry < entries.size(); ++iEntry) {
+			jsonStream << (iEntry == 0 ? "" : ", ") << "\"" << entries[iEntry].first << "\": " << entries[iEntry].second;
+		}
+		jsonStream << "},\n";
+	};
+	jsonStream << "{\n";
+	writeObject("phaseSeconds", phaseSeconds_);
+	writeObject("counts", counts_);
+	writeObject("values", values_);
+	jsonStream << "  \"peakRSSkB\": " << peakRSS() << "\n}\n";
+	return jsonStream.str();
+}
+
+int64_t RunStatistics::peakRSS() {
+	struct rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+void RunStatistics::countBytesRead(const uint64_t &nBytes) noexcept {
+	nBytesRead.fetch_add(nBytes, std::memory_order_relaxed);
+}
+
+void RunStatistics::countBytesWritten(const uint64_t &nBytes) noexcept {
+	nBytesWritten.fetch_add(nBytes, std::memory_order_relaxed);
+}
+
+uint64_t RunStatistics::bytesRead() noexcept {
+	return nBytesRead.load(std::memory_order_relaxed);
+}
+
+uint64_t RunStatistics::bytesWritten() noexcept {
+	return nBytesWritten.load(std::memory_order_relaxed);
+}
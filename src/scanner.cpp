@@ -0,0 +1,548 @@
+/*
+ * Copyright (c) 2023 Anthony J. Greenberg
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER
+ * IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// Block-oriented FASTA scanning
+/** \file
+ * \author Anthony J. Greenberg
+ * \copyright Copyright (c) 2023 Anthony J. Greenberg
+ * \version 0.5
+ *
+ * Implementation of vectorized record boundary search and line break removal, and of the block-reading FASTA record reader.
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && ( defined(__GNUC__) || defined(__clang__) )
+#define SUBSETFA_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#include "scanner.hpp"
+#include "inputStream.hpp"
+
+using namespace BayesicSpace;
+
+namespace {
+	constexpr size_t readBlockSize{4194304};                                                         // 4 MiB
+
+	const char* findRecordStartPortable(const char *start, const char *end) {
+		const char *lineFeed = start;
+		while (lineFeed + 1 < end) {
+			lineFeed = static_cast<const char*>( std::memchr( lineFeed, '\n', static_cast<size_t>(end - lineFeed - 1) ) );
+			if (lineFeed == nullptr) {
+				return end;
+			}
+			if (lineFeed[1] == '>') {
+				return lineFeed + 1;
+			}
+			++lineFeed;
+		}
+		return end;
+	}
+
+	size_t copyStrippedPortable(const char *start, const char *end, char *destination) {
+		char *destinationStart = destination;
+		while (start < end) {
+			const auto *lineFeed = static_cast<const char*>( std::memchr( start, '\n', static_cast<size_t>(end - start) ) );
+			const char *runEnd   = (lineFeed == nullptr ? end : lineFeed);
+			if (std::memchr( start, '\r', static_cast<size_t>(runEnd - start) ) == nullptr) {
+				std::memcpy( destination, start, static_cast<size_t>(runEnd - start) );
+				destination += runEnd - start;
+			} else {
+				destination = std::remove_copy(start, runEnd, destination, '\r');
+			}
+			start = runEnd + 1;
+		}
+		return static_cast<size_t>(destination - destinationStart);
+	}
+
+	/** \brief Smallest range worth checking for fixed-width lines */
+	constexpr ptrdiff_t minFixedLineRange{256};
+
+	/** \brief Flag bytes equal to a value in an eight-byte word
+	 *
+	 * \param[in] word eight bytes
+	 * \param[in] byteValue value to look for
+	 * \return non-zero if any byte of `word` equals `byteValue`
+	 */
+	inline uint64_t hasByte(const uint64_t &word, const uint8_t &byteValue) {
+		constexpr uint64_t lowBits{0x0101010101010101ULL};
+		constexpr uint64_t highBits{0x8080808080808080ULL};
+		const uint64_t difference = word ^ (lowBits * byteValue);
+		return (difference - lowBits) & ~difference & highBits;
+	}
+
+	/** \brief Copy fixed-width lines, eight bytes at a time
+	 *
+	 * Copies consecutive lines of `lineWidth` bytes, each followed by a line feed, computing the line feed positions rather than searching for them.
+	 * Each line is checked for line breaks as it is copied; copying stops before the first line that is shorter, longer, or incomplete.
+	 * With a non-zero `fixedWidth`, the line width is a compile-time constant and the copy loop is unrolled.
+	 * The line width must be at least eight.
+	 *
+	 * \tparam fixedWidth line width; 0 to use `runtimeWidth`
+	 * \param[in] start pointer to the first byte of a line
+	 * \param[in] end pointer to one past the last byte
+	 * \param[in] runtimeWidth line width if `fixedWidth` is 0
+	 * \param[out] destination pointer to the first destination byte
+	 * \param[out] stop pointer to the first byte not copied
+	 * \return number of bytes copied
+	 */
+	template <size_t fixedWidth>
+	size_t copyLinesPortable(const char *start, const char *end, const size_t &runtimeWidth, char *destination, const char *&stop) {
+		constexpr size_t wordSize{sizeof(uint64_t)};
+		const size_t lineWidth = (fixedWidth == 0 ? runtimeWidth : fixedWidth);
+		char *destinationStart = destination;
+		while ( ( static_cast<size_t>(end - start) > lineWidth ) && (start[lineWidth] == '\n') ) {
+			uint64_t breaks{0};
+			uint64_t word{0};
+			for (size_t offset = 0; offset + wordSize < lineWidth; offset += wordSize) {
+				std::memcpy(&word, start + offset, wordSize);
+				breaks |= hasByte(word, '\n') | hasByte(word, '\r');
+				std::memcpy(destination + offset, &word, wordSize);
+			}
+			// the last word may overlap the previous one
+			std::memcpy(&word, start + lineWidth - wordSize, wordSize);
+			breaks |= hasByte(word, '\n') | hasByte(word, '\r');
+			std::memcpy(destination + lineWidth - wordSize, &word, wordSize);
+			if (breaks != 0) {
+				break;
+			}
+			start       += lineWidth + 1;
+			destination += lineWidth;
+		}
+		stop = start;
+		return static_cast<size_t>(destination - destinationStart);
+	}
+
+	/** \brief Copy fixed-width lines with the portable kernel
+	 *
+	 * Chooses an unrolled kernel for common line widths.
+	 *
+	 * \param[in] start pointer to the first byte of a line
+	 * \param[in] end pointer to one past the last byte
+	 * \param[in] lineWidth line width, at least eight
+	 * \param[out] destination pointer to the first destination byte
+	 * \param[out] stop pointer to the first byte not copied
+	 * \return number of bytes copied
+	 */
+	size_t copyLinesPortableDispatch(const char *start, const char *end, const size_t &lineWidth, char *destination, const char *&stop) {
+		switch (lineWidth) {
+			case 60:
+				return copyLinesPortable<60>(start, end, lineWidth, destination, stop);
+			case 70:
+				return copyLinesPortable<70>(start, end, lineWidth, destination, stop);
+			case 80:
+				return copyLinesPortable<80>(start, end, lineWidth, destination, stop);
+			default:
+				return copyLinesPortable<0>(start, end, lineWidth, destination, stop);
+		}
+	}
+
+	/** \brief Copy the bytes of a vector block that are not flagged in a bit mask
+	 *
+	 * \param[in] blockStart pointer to the first byte of the block
+	 * \param[in] blockSize number of bytes in the block
+	 * \param[in] breakMask bit mask of line break positions
+	 * \param[out] destination destination pointer, advanced past the copied bytes
+	 */
+	inline void copyMaskedBlock(const char *blockStart, const uint32_t &blockSize, uint32_t breakMask, char *&destination) {
+		uint32_t runStart{0};
+		while (breakMask != 0) {
+			const auto breakPosition = static_cast<uint32_t>( __builtin_ctz(breakMask) );
+			std::memcpy(destination, blockStart + runStart, breakPosition - runStart);
+			destination += breakPosition - runStart;
+			runStart     = breakPosition + 1;
+			breakMask   &= breakMask - 1;
+		}
+		std::memcpy(destination, blockStart + runStart, blockSize - runStart);
+		destination += blockSize - runStart;
+	}
+
+#ifdef SUBSETFA_X86_SIMD
+	const char* findRecordStartSSE2(const char *start, const char *end) {
+		constexpr ptrdiff_t vectorSize{16};
+		const __m128i lineFeeds   = _mm_set1_epi8('\n');
+		const __m128i recordMarks = _mm_set1_epi8('>');
+		const char *blockStart    = start;
+		while (end - blockStart > vectorSize) {
+			const __m128i currentBytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>(blockStart) );
+			const __m128i nextBytes    = _mm_loadu_si128( reinterpret_cast<const __m128i*>(blockStart + 1) );
+			const auto matchMask       = static_cast<uint32_t>( _mm_movemask_epi8( _mm_and_si128( _mm_cmpeq_epi8(currentBytes, lineFeeds), _mm_cmpeq_epi8(nextBytes, recordMarks) ) ) );
+			if (matchMask != 0) {
+				return blockStart + __builtin_ctz(matchMask) + 1;
+			}
+			blockStart += vectorSize;
+		}
+		return findRecordStartPortable(blockStart, end);
+	}
+
+	size_t copyStrippedSSE2(const char *start, const char *end, char *destination) {
+		constexpr uint32_t vectorSize{16};
+		const __m128i lineFeeds       = _mm_set1_epi8('\n');
+		const __m128i carriageReturns = _mm_set1_epi8('\r');
+		char *destinationStart        = destination;
+		while (end - start >= vectorSize) {
+			const __m128i bytes = _mm_loadu_si128( reinterpret_cast<const __m128i*>(start) );
+			const auto breakMask = static_cast<uint32_t>( _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8(bytes, lineFeeds), _mm_cmpeq_epi8(bytes, carriageReturns) ) ) );
+			if (breakMask == 0) {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), bytes);
+				destination += vectorSize;
+			} else {
+				copyMaskedBlock(start, vectorSize, breakMask, destination);
+			}
+			start += vectorSize;
+		}
+		destination += copyStrippedPortable(start, end, destination);
+		return static_cast<size_t>(destination - destinationStart);
+	}
+
+	/** \brief Copy fixed-width lines, 16 bytes at a time
+	 *
+	 * As `copyLinesPortable()`, but with SSE2 vectors. The line width must be at least 16.
+	 *
+	 * \tparam fixedWidth line width; 0 to use `runtimeWidth`
+	 * \param[in] start pointer to the first byte of a line
+	 * \param[in] end pointer to one past the last byte
+	 * \param[in] runtimeWidth line width if `fixedWidth` is 0
+	 * \param[out] destination pointer to the first destination byte
+	 * \param[out] stop pointer to the first byte not copied
+	 * \return number of bytes copied
+	 */
+	template <size_t fixedWidth>
+	size_t copyLinesSSE2(const char *start, const char *end, const size_t &runtimeWidth, char *destination, const char *&stop) {
+		constexpr size_t vectorSize{16};
+		const size_t lineWidth        = (fixedWidth == 0 ? runtimeWidth : fixedWidth);
+		const __m128i lineFeeds       = _mm_set1_epi8('\n');
+		const __m128i carriageReturns = _mm_set1_epi8('\r');
+		char *destinationStart        = destination;
+		while ( ( static_cast<size_t>(end - start) > lineWidth ) && (start[lineWidth] == '\n') ) {
+			__m128i breaks = _mm_setzero_si128();
+			__m128i bytes;
+			for (size_t offset = 0; offset + vectorSize < lineWidth; offset += vectorSize) {
+				bytes  = _mm_loadu_si128( reinterpret_cast<const __m128i*>(start + offset) );
+				breaks = _mm_or_si128( breaks, _mm_or_si128( _mm_cmpeq_epi8(bytes, lineFeeds), _mm_cmpeq_epi8(bytes, carriageReturns) ) );
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + offset), bytes);
+			}
+			bytes  = _mm_loadu_si128( reinterpret_cast<const __m128i*>(start + lineWidth - vectorSize) );
+			breaks = _mm_or_si128( breaks, _mm_or_si128( _mm_cmpeq_epi8(bytes, lineFeeds), _mm_cmpeq_epi8(bytes, carriageReturns) ) );
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + lineWidth - vectorSize), bytes);
+			if (_mm_movemask_epi8(breaks) != 0) {
+				break;
+			}
+			start       += lineWidth + 1;
+			destination += lineWidth;
+		}
+		stop = start;
+		return static_cast<size_t>(destination - destinationStart);
+	}
+
+	/** \brief Copy fixed-width lines with the SSE2 kernel
+	 *
+	 * \param[in] start pointer to the first byte of a line
+	 * \param[in] end pointer to one past the last byte
+	 * \param[in] lineWidth line width, at least 16
+	 * \param[out] destination pointer to the first destination byte
+	 * \param[out] stop pointer to the first byte not copied
+	 * \return number of bytes copied
+	 */
+	size_t copyLinesSSE2Dispatch(const char *start, const char *end, const size_t &lineWidth, char *destination, const char *&stop) {
+		switch (lineWidth) {
+			case 60:
+				return copyLinesSSE2<60>(start, end, lineWidth, destination, stop);
+			case 70:
+				return copyLinesSSE2<70>(start, end, lineWidth, destination, stop);
+			case 80:
+				return copyLinesSSE2<80>(start, end, lineWidth, destination, stop);
+			default:
+				return copyLinesSSE2<0>(start, end, lineWidth, destination, stop);
+		}
+	}
+
+	__attribute__((target("avx2"))) const char* findRecordStartAVX2(const char *start, const char *end) {
+		constexpr ptrdiff_t vectorSize{32};
+		const __m256i lineFeeds   = _mm256_set1_epi8('\n');
+		const __m256i recordMarks = _mm256_set1_epi8('>');
+		const char *blockStart    = start;
+		while (end - blockStart > vectorSize) {
+			const __m256i currentBytes = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(blockStart) );
+			const __m256i nextBytes    = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(blockStart + 1) );
+			const auto matchMask       = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_and_si256( _mm256_cmpeq_epi8(currentBytes, lineFeeds), _mm256_cmpeq_epi8(nextBytes, recordMarks) ) ) );
+			if (matchMask != 0) {
+				return blockStart + __builtin_ctz(matchMask) + 1;
+			}
+			blockStart += vectorSize;
+		}
+		return findRecordStartPortable(blockStart, end);
+	}
+
+	__attribute__((target("avx2"))) size_t copyStrippedAVX2(const char *start, const char *end, char *destination) {
+		constexpr uint32_t vectorSize{32};
+		const __m256i lineFeeds       = _mm256_set1_epi8('\n');
+		const __m256i carriageReturns = _mm256_set1_epi8('\r');
+		char *destinationStart        = destination;
+		while (end - start >= vectorSize) {
+			const __m256i bytes = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(start) );
+			const auto breakMask = static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_or_si256( _mm256_cmpeq_epi8(bytes, lineFeeds), _mm256_cmpeq_epi8(bytes, carriageReturns) ) ) );
+			if (breakMask == 0) {
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), bytes);
+				destination += vectorSize;
+			} else {
+				copyMaskedBlock(start, vectorSize, breakMask, destination);
+			}
+			start += vectorSize;
+		}
+		destination += copyStrippedPortable(start, end, destination);
+		return static_cast<size_t>(destination - destinationStart);
+	}
+
+	/** \brief Copy fixed-width lines, 32 bytes at a time
+	 *
+	 * As `copyLinesPortable()`, but with AVX2 vectors. The line width must be at least 32.
+	 *
+	 * \tparam fixedWidth line width; 0 to use `runtimeWidth`
+	 * \param[in] start pointer to the first byte of a line
+	 * \param[in] end pointer to one past the last byte
+	 * \param[in] runtimeWidth line width if `fixedWidth` is 0
+	 * \param[out] destination pointer to the first destination byte
+	 * \param[out] stop pointer to the first byte not copied
+	 * \return number of bytes copied
+	 */
+	template <size_t fixedWidth>
+	__attribute__((target("avx2"))) size_t copyLinesAVX2(const char *start, const char *end, const size_t &runtimeWidth, char *destination, const char *&stop) {
+		constexpr size_t vectorSize{32};
+		const size_t lineWidth        = (fixedWidth == 0 ? runtimeWidth : fixedWidth);
+		const __m256i lineFeeds       = _mm256_set1_epi8('\n');
+		const __m256i carriageReturns = _mm256_set1_epi8('\r');
+		char *destinationStart        = destination;
+		while ( ( static_cast<size_t>(end - start) > lineWidth ) && (start[lineWidth] == '\n') ) {
+			__m256i breaks = _mm256_setzero_si256();
+			__m256i bytes;
+			for (size_t offset = 0; offset + vectorSize < lineWidth; offset += vectorSize) {
+				bytes  = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(start + offset) );
+				breaks = _mm256_or_si256( breaks, _mm256_or_si256( _mm256_cmpeq_epi8(bytes, lineFeeds), _mm256_cmpeq_epi8(bytes, carriageReturns) ) );
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + offset), bytes);
+			}
+			bytes  = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(start + lineWidth - vectorSize) );
+			breaks = _mm256_or_si256( breaks, _mm256_or_si256( _mm256_cmpeq_epi8(bytes, lineFeeds), _mm256_cmpeq_epi8(bytes, carriageReturns) ) );
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + lineWidth - vectorSize), bytes);
+			if (_mm256_testz_si256(breaks, breaks) == 0) {
+				break;
+			}
+			start       += lineWidth + 1;
+			destination += lineWidth;
+		}
+		stop = start;
+		return static_cast<size_t>(destination - destinationStart);
+	}
+
+	/** \brief Copy fixed-width lines with the AVX2 kernel
+	 *
+	 * \param[in] start pointer to the first byte of a line
+	 * \param[in] end pointer to one past the last byte
+	 * \param[in] lineWidth line width, at least 32
+	 * \param[out] destination pointer to the first destination byte
+	 * \param[out] stop pointer to the first byte not copied
+	 * \return number of bytes copied
+	 */
+	__attribute__((target("avx2"))) size_t copyLinesAVX2Dispatch(const char *start, const char *end, const size_t &lineWidth, char *destination, const char *&stop) {
+		switch (lineWidth) {
+			case 60:
+				return copyLinesAVX2<60>(start, end, lineWidth, destination, stop);
+			case 70:
+				return copyLinesAVX2<70>(start, end, lineWidth, destination, stop);
+			case 80:
+				return copyLinesAVX2<80>(start, end, lineWidth, destination, stop);
+			default:
+				return copyLinesAVX2<0>(start, end, lineWidth, destination, stop);
+		}
+	}
+#endif
+}
+
+FastaScanner::FastaScanner() : FastaScanner( FastaScanner::bestSimdLevel() ) {
+}
+
+FastaScanner::FastaScanner(const SimdLevel &requestedLevel) : simdLevel_{std::min( requestedLevel, FastaScanner::bestSimdLevel() )} {
+	switch (simdLevel_) {
+#ifdef SUBSETFA_X86_SIMD
+		case SimdLevel::avx2:
+			findRecordStart_ = findRecordStartAVX2;
+			copyStripped_    = copyStrippedAVX2;
+			copyLines_       = copyLinesAVX2Dispatch;
+			minLineWidth_    = 32;
+			break;
+		case SimdLevel::sse2:
+			findRecordStart_ = findRecordStartSSE2;
+			copyStripped_    = copyStrippedSSE2;
+			copyLines_       = copyLinesSSE2Dispatch;
+			minLineWidth_    = 16;
+			break;
+#endif
+		default:
+			simdLevel_       = SimdLevel::portable;
+			findRecordStart_ = findRecordStartPortable;
+			copyStripped_    = copyStrippedPortable;
+			copyLines_       = copyLinesPortableDispatch;
+			minLineWidth_    = 8;
+			break;
+	}
+}
+
+size_t FastaScanner::copyStripped(const char *start, const char *end, char *destination) const {
+	if (end - start < minFixedLineRange) {
+		return copyStripped_(start, end, destination);
+	}
+	// the range may start mid-line, so the line width is taken from the second line
+	const auto *firstLineFeed = static_cast<const char*>( std::memchr( start, '\n', static_cast<size_t>(end - start) ) );
+	if (firstLineFeed == nullptr) {
+		return copyStripped_(start, end, destination);
+	}
+	const char *secondLineStart = firstLineFeed + 1;
+	const auto *secondLineFeed  = static_cast<const char*>( std::memchr( secondLineStart, '\n', static_cast<size_t>(end - secondLineStart) ) );
+	if (secondLineFeed == nullptr) {
+		return copyStripped_(start, end, destination);
+	}
+	const auto lineWidth = static_cast<size_t>(secondLineFeed - secondLineStart);
+	if (lineWidth < minLineWidth_) {
+		return copyStripped_(start, end, destination);
+	}
+	// lines after the first irregular one, and the last incomplete line, go through the general kernel
+	size_t nCopied = copyStripped_(start, secondLineStart, destination);
+	const char *stop{secondLineStart};
+	nCopied += copyLines_(secondLineStart, end, lineWidth, destination + nCopied, stop);
+	nCopied += copyStripped_(stop, end, destination + nCopied);
+	return nCopied;
+}
+
+SimdLevel FastaScanner::bestSimdLevel() {
+#ifdef SUBSETFA_X86_SIMD
+	static const SimdLevel bestLevel = [](){
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? SimdLevel::avx2 : SimdLevel::sse2;
+	}();
+	return bestLevel;
+#else
+	return SimdLevel::portable;
+#endif
+}
+
+RecordReader::RecordReader(const std::string &inFileName, const size_t &nThreads, const bool &readAhead) :
+		input_{readAhead ? openReadAheadStream(inFileName, nThreads) : openInputStream(inFileName, nThreads)}, buffer_(readBlockSize) {
+	this->refill_();
+	if ( (bufferEnd_ == 0) || (buffer_.front() == '\n') ) {
+		throw std::string("ERROR: input FASTA file ") + inFileName + std::string(" empty in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+	if (buffer_.front() != '>') {
+		throw std::string("ERROR: first line of a FASTA file must begin with '>' in ") + std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+	}
+}
+
+bool RecordReader::nextHeader(std::string &header) {
+	if ( (bufferPosition_ == bufferEnd_) && (this->refill_() == 0) ) {
+		return false;
+	}
+	// the sequence scan always stops at a '>' that starts a line
+	size_t searchStart = bufferPosition_ + 1;
+	const char *lineFeed{nullptr};
+	while (true) {
+		lineFeed = static_cast<const char*>( std::memchr(buffer_.data() + searchStart, '\n', bufferEnd_ - searchStart) );
+		if ( (lineFeed != nullptr) || endOfInput_ ) {
+			break;
+		}
+		const size_t nProcessed = bufferEnd_ - bufferPosition_;
+		if (this->refill_() == 0) {
+			break;
+		}
+		searchStart = nProcessed;
+	}
+	const char *headerEnd = (lineFeed == nullptr ? buffer_.data() + bufferEnd_ : lineFeed);
+	const char *lineEnd   = headerEnd;
+	if ( (headerEnd > buffer_.data() + bufferPosition_ + 1) && (*(headerEnd - 1) == '\r') ) {
+		--headerEnd;
+	}
+	const char *headerStart = buffer_.data() + bufferPosition_ + 1;
+	header.assign( headerStart, static_cast<size_t>( std::max(headerEnd, headerStart) - headerStart ) );
+	bufferPosition_ = std::min(static_cast<size_t>(lineEnd - buffer_.data()) + 1, bufferEnd_);
+	atLineStart_    = true;
+	return true;
+}
+
+void RecordReader::readSequence(std::string &sequence) {
+	sequence.clear();
+	this->consumeSequence_(&sequence);
+}
+
+void RecordReader::skipSequence() {
+	this->consumeSequence_(nullptr);
+}
+
+size_t RecordReader::refill_() {
+	if (endOfInput_) {
+		return 0;
+	}
+	if (bufferPosition_ > 0) {
+		std::memmove(buffer_.data(), buffer_.data() + bufferPosition_, bufferEnd_ - bufferPosition_);
+		bufferEnd_     -= bufferPosition_;
+		bufferPosition_ = 0;
+	}
+	if ( bufferEnd_ == buffer_.size() ) {
+		buffer_.resize(2 * buffer_.size());
+	}
+	const size_t nRead = input_->read(buffer_.data() + bufferEnd_, buffer_.size() - bufferEnd_);
+	if (nRead == 0) {
+		endOfInput_ = true;
+		return 0;
+	}
+	bufferEnd_ += nRead;
+	return nRead;
+}
+
+void RecordReader::consumeSequence_(std::string *sequence) {
+	while (true) {
+		if ( (bufferPosition_ == bufferEnd_) && (this->refill_() == 0) ) {
+			return;
+		}
+		const char *rangeStart = buffer_.data() + bufferPosition_;
+		const char *rangeEnd   = buffer_.data() + bufferEnd_;
+		if (atLineStart_ && (*rangeStart == '>') ) {
+			return;
+		}
+		const char *recordStart = scanner_.findRecordStart(rangeStart, rangeEnd);
+		if (sequence != nullptr) {
+			const size_t oldSize = sequence->size();
+			sequence->resize( oldSize + static_cast<size_t>(recordStart - rangeStart) );
+			const size_t nCopied = scanner_.copyStripped(rangeStart, recordStart, &(*sequence)[oldSize]);
+			sequence->resize(oldSize + nCopied);
+		}
+		bufferPosition_ = static_cast<size_t>(recordStart - buffer_.data());
+		if (recordStart < rangeEnd) {
+			atLineStart_ = true;
+			return;
+		}
+		atLineStart_ = (*(rangeEnd - 1) == '\n');
+	}
+}
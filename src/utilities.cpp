@@ -30,19 +30,134 @@
 #include <string>
 #include <array>
 #include <unordered_map>
+#include <vector>
+#include <utility>
 #include <fstream>
+#include <sstream>
+
+#include <sys/stat.h>
 
 #include "utilities.hpp"
+#include "fastaWriter.hpp"
+#include "fastaObj.hpp"
+#include "mappedFile.hpp"
+#include "runStatistics.hpp"
 
 void BayesicSpace::saveAsFASTA(const std::unordered_map<std::string, std::string> &subsetRecords, const std::string &outFileName) {
-	std::fstream outFASTA;
-	outFASTA.open(outFileName, std::ios::out | std::ios::trunc);
+	FastaWriter outFASTA(outFileName);
+	for (const auto &eachRecord : subsetRecords) {
+		outFASTA.write(eachRecord.first, eachRecord.second);
+	}
+	outFASTA.close();
+}
+
+void BayesicSpace::saveAsFASTA(const std::vector< std::pair<std::string, std::string> > &subsetRecords, const std::string &outFileName, const size_t &lineWidth) {
+	saveAsFASTA( subsetRecords, outFileName, OutputFormat{lineWidth} );
+}
+
+void BayesicSpace::saveAsFASTA(const std::vector< std::pair<std::string, std::string> > &subsetRecords, const std::string &outFileName, const OutputFormat &format) {
+	FastaWriter outFASTA(outFileName, format, false);
 	for (const auto &eachRecord : subsetRecords) {
-		outFASTA << ">" << eachRecord.first << "\n" << eachRecord.second << "\n";
+		outFASTA.write(eachRecord.first, eachRecord.second);
+	}
+	outFASTA.close();
+}
+
+void BayesicSpace::saveAsFASTA(const Fasta &fastaData, const std::vector<size_t> &recordIndexes, const std::string &outFileName, const size_t &lineWidth) {
+	saveAsFASTA( fastaData, recordIndexes, outFileName, OutputFormat{lineWidth} );
+}
+
+void BayesicSpace::saveAsFASTA(const Fasta &fastaData, const std::vector<size_t> &recordIndexes, const std::string &outFileName, const OutputFormat &format) {
+	FastaWriter outFASTA(outFileName, format, false);
+	if ( fastaData.isPacked() ) {
+		for (const auto &eachIndex : recordIndexes) {
+			const std::string sequence{fastaData.sequence(eachIndex)};
+			outFASTA.write( fastaData.header(eachIndex), CharView{sequence.data(), sequence.size()} );
+		}
+		outFASTA.close();
+		return;
+	}
+	for (const auto &eachIndex : recordIndexes) {
+		outFASTA.write( fastaData.header(eachIndex), fastaData.sequenceView(eachIndex) );
 	}
 	outFASTA.close();
 }
 
+std::vector<std::string> BayesicSpace::readHeaderList(const std::string &headerFileName) {
+	std::fstream inSubsetList;
+	inSubsetList.open(headerFileName, std::ios::in);
+	std::vector<std::string> headers;
+	std::string eachLine;
+	while ( std::getline(inSubsetList, eachLine) ) {
+		if ( !eachLine.empty() ) {
+			headers.emplace_back( eachLine.substr( static_cast<size_t>(eachLine.at(0) == '>') ) );      // remove starting '>' if exists
+		}
+	}
+	inSubsetList.close();
+	RunStatistics::countBytesRead( fileSize(headerFileName) );
+	return headers;
+}
+
+std::vector<std::string> BayesicSpace::inputFileNames(const std::string &flagValue) {
+	std::vector<std::string> fileNames;
+	std::string eachName;
+	if ( !flagValue.empty() && (flagValue.front() == '@') ) {
+		std::fstream inNameList;
+		inNameList.open(flagValue.substr(1), std::ios::in);
+		if ( !inNameList.is_open() ) {
+			throw std::string("ERROR: cannot open file ") + flagValue.substr(1) + std::string(" in ")
+										+ std::string( static_cast<const char*>(__PRETTY_FUNCTION__) );
+		}
+		while ( std::getline(inNameList, eachName) ) {
+			if ( !eachName.empty() ) {
+				fileNames.push_back(eachName);
+			}
+		}
+		inNameList.close();
+		RunStatistics::countBytesRead( fileSize( flagValue.substr(1) ) );
+		return fileNames;
+	}
+	std::stringstream nameStream(flagValue);
+	while ( std::getline(nameStream, eachName, ',') ) {
+		if ( !eachName.empty() ) {
+			fileNames.push_back(eachName);
+		}
+	}
+	return fileNames;
+}
+
+std::string BayesicSpace::shardOutFileName(const std::string &shardFileName, const std::string &outFileName) {
+	std::string shardStem{shardFileName.substr(shardFileName.find_last_of('/') + 1)};                // npos + 1 is 0
+	for ( const std::string eachSuffix : {".gz", ".bgz"} ) {
+		if ( ( shardStem.size() > eachSuffix.size() ) && (shardStem.compare(shardStem.size() - eachSuffix.size(), eachSuffix.size(), eachSuffix) == 0) ) {
+			shardStem.resize( shardStem.size() - eachSuffix.size() );
+		}
+	}
+	const size_t extensionStart = shardStem.find_last_of('.');
+	if ( (extensionStart != std::string::npos) && (extensionStart > 0) ) {
+		shardStem.resize(extensionStart);
+	}
+	const size_t baseStart = outFileName.find_last_of('/') + 1;
+	return outFileName.substr(0, baseStart) + shardStem + "_" + outFileName.substr(baseStart);
+}
+
+size_t BayesicSpace::fileSize(const std::string &fileName) {
+	struct stat fileStatus{};
+	if (stat(fileName.c_str(), &fileStatus) != 0) {
+		return 0;
+	}
+	return static_cast<size_t>(fileStatus.st_size);
+}
+
+bool BayesicSpace::sameFile(const std::string &firstFileName, const std::string &secondFileName) {
+	struct stat firstStatus{};
+	struct stat secondStatus{};
+	if ( (stat(firstFileName.c_str(), &firstStatus) != 0) || (stat(secondFileName.c_str(), &secondStatus) != 0) ) {
+		return false;
+	}
+	return (firstStatus.st_dev == secondStatus.st_dev) && (firstStatus.st_ino == secondStatus.st_ino);
+}
+
 
 void BayesicSpace::parseCL(int &argc, char **argv, std::unordered_map<std::string, std::string> &cli) {
 	// set to true after encountering a flag token (the characters after the dash)
@@ -66,14 +181,24 @@ void BayesicSpace::parseCL(int &argc, char **argv, std::unordered_map<std::strin
 			}
 		}
 	}
+	if (val) { // the last flag had no value
+		cli[curFlag] = "set";
+	}
 }
 
 void BayesicSpace::extractCLinfo(const std::unordered_map<std::string, std::string> &parsedCLI, std::unordered_map<std::string, std::string> &stringVariables) {
 	stringVariables.clear();
-	const std::array<std::string, 2> requiredStringVariables{"input-fasta", "header-list"};
-	const std::array<std::string, 1> optionalStringVariables{"out-file"};
+	// a batch manifest replaces the header list; a server needs no header list
+	const std::array<std::string, 2> requiredStringVariables{"input-fasta",
+		( parsedCLI.count("batch") > 0 ? "batch" : (parsedCLI.count("serve") > 0 ? "serve" : "header-list") )};
+	const std::array<std::string, 15> optionalStringVariables{"out-file", "use-index", "threads", "pack-sequences", "order", "line-width", "batch", "match", "stats",
+		"serve", "server", "shard-outputs", "snapshot", "out-compress", "out-index"};
 
-	const std::unordered_map<std::string, std::string> defaultStringValues{ {"out-file", "subset.fasta"} };
+	const std::unordered_map<std::string, std::string> defaultStringValues{
+		{"out-file", "subset.fasta"}, {"use-index", "unset"}, {"threads", "1"}, {"pack-sequences", "unset"}, {"order", "input"}, {"line-width", "0"},
+		{"batch", "unset"}, {"match", "whole"}, {"stats", "unset"}, {"serve", "unset"}, {"server", "unset"}, {"shard-outputs", "unset"}, {"snapshot", "unset"},
+		{"out-compress", "none"}, {"out-index", "unset"}
+	};
 
 	if ( parsedCLI.empty() ) {
 		throw std::string("No command line flags specified;");
@@ -27,12 +27,34 @@
  *
  */
 
+#include <cstdio>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <iterator>
+#include <thread>
+#include <memory>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 #include "fastaObj.hpp"
+#include "fastaIndex.hpp"
+#include "fastaServer.hpp"
+#include "fastaWriter.hpp"
+#include "headerIndex.hpp"
+#include "headerSet.hpp"
+#include "inputStream.hpp"
+#include "packedSequence.hpp"
+#include "runStatistics.hpp"
+#include "scanner.hpp"
+#include "spscQueue.hpp"
 #include "utilities.hpp"
 
 #include "catch2/catch_test_macros.hpp"
@@ -88,3 +110,1408 @@ TEST_CASE("Can subset FASTA records", "[subset]") {
 		);
 	}
 }
+
+TEST_CASE("Can stream-filter FASTA records", "[filter]") {
+	SECTION("Exceptions on wrong data") {
+		const BayesicSpace::FastaFilter listFilter("../tests/subsetList.txt");
+		REQUIRE_THROWS_WITH(listFilter.filter("../tests/empty.fasta", "filterTest.fasta"),
+				Catch::Matchers::StartsWith("ERROR: input FASTA file "));
+		REQUIRE_THROWS_WITH(listFilter.filter("../tests/wrong.fasta", "filterTest.fasta"),
+				Catch::Matchers::StartsWith("ERROR: first line of a FASTA file must begin with "));
+		// outputs are truncated when opened, so an output that is also an input is refused
+		const std::string selfFAfile("filterSelf.fasta");
+		{
+			std::fstream testFile("../tests/test.fasta", std::ios::in);
+			std::fstream outFASTA(selfFAfile, std::ios::out | std::ios::trunc);
+			outFASTA << testFile.rdbuf();
+		}
+		const size_t selfSize = BayesicSpace::fileSize(selfFAfile);
+		REQUIRE_THROWS_WITH(listFilter.filter(selfFAfile, "./" + selfFAfile),
+				Catch::Matchers::StartsWith("ERROR: output file ./filterSelf.fasta is the input file filterSelf.fasta"));
+		REQUIRE_THROWS_WITH(listFilter.filterShards(std::vector<std::string>{"../tests/test.fasta", selfFAfile}, std::vector<std::string>{selfFAfile, "filterTest.fasta"},
+				2, BayesicSpace::RecordOrder::input, 0), Catch::Matchers::StartsWith("ERROR: output file filterSelf.fasta is the input file filterSelf.fasta"));
+		const BayesicSpace::FastaDemultiplexer selfRouter( std::vector< std::pair<std::string, std::string> >{{"../tests/subsetList.txt", selfFAfile}} );
+		REQUIRE_THROWS_WITH(selfRouter.demultiplex(selfFAfile, 1, 0),
+				Catch::Matchers::StartsWith("ERROR: output file filterSelf.fasta is the input file filterSelf.fasta"));
+		REQUIRE(BayesicSpace::fileSize(selfFAfile) == selfSize);
+	}
+	SECTION("Filtering matches subsetting") {
+		const std::string testFAfile("../tests/test.fasta");
+		const BayesicSpace::Fasta testFA(testFAfile);
+		const BayesicSpace::FastaFilter listFilter("../tests/subsetList.txt");
+		const BayesicSpace::FastaFilter ngtFilter("../tests/subsetListNGT.txt");
+		constexpr size_t correctSubsetLen{9};
+		REQUIRE(listFilter.size() == correctSubsetLen);
+		REQUIRE(ngtFilter.size() == correctSubsetLen);
+		REQUIRE(listFilter.filter(testFAfile, "filterTest.fasta") == correctSubsetLen);
+
+		const BayesicSpace::Fasta filteredFA("filterTest.fasta");
+		REQUIRE(filteredFA.size() == correctSubsetLen);
+		const std::unordered_map<std::string, std::string> filteredRecords{filteredFA.subset("../tests/subsetList.txt")};
+		const std::unordered_map<std::string, std::string> subsetRecords{testFA.subset("../tests/subsetList.txt")};
+		REQUIRE(filteredRecords == subsetRecords);
+
+		const std::vector<std::string> subset{"B.FR.1983.LAI-J19.A07867", "randomValue"};
+		const BayesicSpace::FastaFilter vecFilter(subset);
+		REQUIRE(vecFilter.filter(testFAfile, "filterTest.fasta") == 1);
+		REQUIRE(BayesicSpace::Fasta("filterTest.fasta").subset(subset).at("B.FR.1983.LAI-J19.A07867") == testFA.subset(subset).at("B.FR.1983.LAI-J19.A07867"));
+	}
+}
+
+TEST_CASE("Can map FASTA files", "[mapped]") {
+	SECTION("Exceptions on wrong data") {
+		REQUIRE_THROWS_WITH(BayesicSpace::MappedFasta("../tests/empty.fasta"),
+				Catch::Matchers::StartsWith("ERROR: input FASTA file "));
+		REQUIRE_THROWS_WITH(BayesicSpace::MappedFasta("../tests/wrong.fasta"),
+				Catch::Matchers::StartsWith("ERROR: first line of a FASTA file must begin with "));
+		REQUIRE_THROWS_WITH(BayesicSpace::MappedFasta("../tests/noSuchFile.fasta"),
+				Catch::Matchers::StartsWith("ERROR: cannot open file "));
+	}
+	SECTION("Operation of malformed FASTA") {
+		const BayesicSpace::MappedFasta noSeqFA("../tests/noSeq.fasta");
+		REQUIRE(noSeqFA.size() == 1);
+		REQUIRE(noSeqFA.isSingleLine(0));
+		REQUIRE(noSeqFA.sequenceView(0).length == 0);
+		const BayesicSpace::MappedFasta headLastFA("../tests/headLast.fasta");
+		REQUIRE(headLastFA.size() == 2);
+		REQUIRE( headLastFA.sequence(1).empty() );
+	}
+	SECTION("Operation on correct data") {
+		const std::string testFAfile("../tests/test.fasta");
+		const BayesicSpace::Fasta testFA(testFAfile);
+		const BayesicSpace::MappedFasta mappedFA(testFAfile);
+		constexpr size_t correctNsequnces{18};
+		REQUIRE(mappedFA.size() == correctNsequnces);
+		REQUIRE(mappedFA.header(0).str() == std::string("B.FR.1983.IIIB_LAI.A04321"));
+		REQUIRE(mappedFA.find("randomValue") == mappedFA.size());
+		const size_t recordIndex = mappedFA.find("B.US.1997.ARES2.AB078005");
+		REQUIRE(recordIndex < mappedFA.size());
+		REQUIRE_FALSE( mappedFA.isSingleLine(recordIndex) );
+		REQUIRE_THROWS_WITH(mappedFA.sequenceView(recordIndex),
+				Catch::Matchers::StartsWith("ERROR: sequence spans several lines"));
+		REQUIRE(mappedFA.subset("../tests/subsetList.txt") == testFA.subset("../tests/subsetList.txt"));
+
+		const std::unordered_map<std::string, std::string> subsetRecords{testFA.subset("../tests/subsetListNGT.txt")};
+		BayesicSpace::saveAsFASTA(subsetRecords, "mappedTest.fasta");
+		const BayesicSpace::MappedFasta singleLineFA("mappedTest.fasta");
+		REQUIRE( singleLineFA.size() == subsetRecords.size() );
+		for (size_t iRecord = 0; iRecord < singleLineFA.size(); ++iRecord) {
+			REQUIRE( singleLineFA.isSingleLine(iRecord) );
+			REQUIRE( singleLineFA.sequenceView(iRecord).str() == subsetRecords.at( singleLineFA.header(iRecord).str() ) );
+		}
+	}
+}
+
+TEST_CASE("Can index FASTA files", "[index]") {
+	// work on a copy so that the index is not written next to the test data
+	const std::string indexedFAfile("indexTest.fasta");
+	{
+		std::fstream inFASTA("../tests/test.fasta", std::ios::in);
+		std::fstream outFASTA(indexedFAfile, std::ios::out | std::ios::trunc);
+		outFASTA << inFASTA.rdbuf();
+	}
+	std::remove( (indexedFAfile + ".fai").c_str() );
+	SECTION("Exceptions on wrong data") {
+		REQUIRE_THROWS_WITH(BayesicSpace::FastaIndex("../tests/wrong.fasta"),
+				Catch::Matchers::StartsWith("ERROR: first line of a FASTA file must begin with "));
+	}
+	SECTION("Index building and reuse") {
+		const BayesicSpace::FastaIndex testIndex(indexedFAfile);
+		constexpr size_t correctNsequnces{18};
+		REQUIRE(testIndex.size() == correctNsequnces);
+		REQUIRE( BayesicSpace::FastaIndex::isFresh(indexedFAfile, indexedFAfile + ".fai") );
+		const BayesicSpace::FaidxEntry &firstEntry = testIndex.entry(0);
+		constexpr uint64_t lineBases{80};
+		REQUIRE(firstEntry.name == std::string("B.FR.1983.IIIB_LAI.A04321"));
+		REQUIRE(firstEntry.offset == firstEntry.name.size() + 2);
+		REQUIRE(firstEntry.lineBases == lineBases);
+		REQUIRE(firstEntry.lineBytes == lineBases + 1);
+
+		const BayesicSpace::FastaIndex loadedIndex(indexedFAfile);
+		REQUIRE(loadedIndex.size() == correctNsequnces);
+		for (size_t iEntry = 0; iEntry < loadedIndex.size(); ++iEntry) {
+			REQUIRE(loadedIndex.entry(iEntry).name == testIndex.entry(iEntry).name);
+			REQUIRE(loadedIndex.entry(iEntry).length == testIndex.entry(iEntry).length);
+			REQUIRE(loadedIndex.entry(iEntry).offset == testIndex.entry(iEntry).offset);
+		}
+	}
+	SECTION("Record and region extraction") {
+		const BayesicSpace::Fasta testFA(indexedFAfile);
+		const BayesicSpace::IndexedFasta indexedFA(indexedFAfile);
+		REQUIRE(indexedFA.subset("../tests/subsetList.txt") == testFA.subset("../tests/subsetList.txt"));
+
+		const std::string fullSequence{testFA.subset( std::vector<std::string>{"B.US.1997.ARES2.AB078005"} ).at("B.US.1997.ARES2.AB078005")};
+		REQUIRE(indexedFA.region("B.US.1997.ARES2.AB078005", 75, 170) == fullSequence.substr(74, 96));
+		REQUIRE(indexedFA.region("B.US.1997.ARES2.AB078005", 1, fullSequence.size() + 10) == fullSequence);
+		REQUIRE( indexedFA.region("randomValue", 1, 10).empty() );
+		std::string regionSequence;
+		REQUIRE( indexedFA.fetch("B.US.1997.ARES2.AB078005:161-1,000", regionSequence) );
+		REQUIRE(regionSequence == fullSequence.substr(160, 840));
+		REQUIRE( indexedFA.fetch("B.US.1997.ARES2.AB078005:200", regionSequence) );
+		REQUIRE(regionSequence == fullSequence.substr(199));
+		REQUIRE_FALSE( indexedFA.fetch("randomValue:1-10", regionSequence) );
+		// regions outside the sequence are not found
+		REQUIRE_FALSE( indexedFA.fetch("B.US.1997.ARES2.AB078005:" + std::to_string(fullSequence.size() + 1) + "-" + std::to_string(fullSequence.size() + 10), regionSequence) );
+		REQUIRE( regionSequence.empty() );
+		REQUIRE_FALSE( indexedFA.fetch("B.US.1997.ARES2.AB078005:20-10", regionSequence) );
+		REQUIRE( indexedFA.fetch("B.US.1997.ARES2.AB078005:" + std::to_string( fullSequence.size() ), regionSequence) );
+		REQUIRE(regionSequence == fullSequence.substr(fullSequence.size() - 1));
+
+		const std::vector<std::string> requests{"B.US.1997.ARES2.AB078005:1-20", "randomValue", "B.FR.1983.LAI-J19.A07867"};
+		std::unordered_map<std::string, std::string> regionSubset{indexedFA.subset(requests)};
+		REQUIRE(regionSubset.size() == 2);
+		REQUIRE(regionSubset.at("B.US.1997.ARES2.AB078005:1-20") == std::string("caaggatccttccctgattg"));
+	}
+}
+
+TEST_CASE("Can load FASTA files in parallel", "[parallel]") {
+	SECTION("Exceptions on wrong data") {
+		constexpr size_t nThreads{3};
+		REQUIRE_THROWS_WITH(BayesicSpace::Fasta("../tests/empty.fasta", nThreads),
+				Catch::Matchers::StartsWith("ERROR: input FASTA file "));
+		REQUIRE_THROWS_WITH(BayesicSpace::Fasta("../tests/wrong.fasta", nThreads),
+				Catch::Matchers::StartsWith("ERROR: first line of a FASTA file must begin with "));
+	}
+	SECTION("Operation of malformed FASTA") {
+		constexpr size_t nThreads{4};
+		REQUIRE(BayesicSpace::Fasta("../tests/noSeq.fasta", nThreads).size() == 1);
+		REQUIRE(BayesicSpace::Fasta("../tests/headLast.fasta", nThreads).size() == 2);
+	}
+	SECTION("Parallel and serial results are identical") {
+		// append a duplicate of the first header; the first record must still win
+		const std::string duplicateFAfile("duplicateTest.fasta");
+		{
+			std::fstream inFASTA("../tests/test.fasta", std::ios::in);
+			std::fstream outFASTA(duplicateFAfile, std::ios::out | std::ios::trunc);
+			outFASTA << inFASTA.rdbuf() << ">B.FR.1983.IIIB_LAI.A04321\nacgt\n";
+		}
+		const BayesicSpace::MappedFasta mappedFA(duplicateFAfile);
+		std::vector<std::string> allHeaders;
+		for (size_t iRecord = 0; iRecord < mappedFA.size(); ++iRecord) {
+			allHeaders.emplace_back( mappedFA.header(iRecord).str() );
+		}
+		const BayesicSpace::Fasta serialFA(duplicateFAfile);
+		const std::unordered_map<std::string, std::string> serialRecords{serialFA.subset(allHeaders)};
+		constexpr size_t correctNsequnces{18};
+		REQUIRE(serialFA.size() == correctNsequnces);
+		REQUIRE(serialRecords.at("B.FR.1983.IIIB_LAI.A04321").substr(0, 20) == std::string("ggtctctcnngttagaccag"));
+		constexpr size_t maxThreads{7};
+		for (size_t nThreads = 0; nThreads <= maxThreads; ++nThreads) {
+			const BayesicSpace::Fasta parallelFA(duplicateFAfile, nThreads);
+			REQUIRE(parallelFA.size() == correctNsequnces);
+			REQUIRE(parallelFA.subset(allHeaders) == serialRecords);
+		}
+		constexpr size_t manyThreads{1000};
+		REQUIRE(BayesicSpace::Fasta(duplicateFAfile, manyThreads).subset(allHeaders) == serialRecords);
+	}
+	SECTION("More threads than bytes") {
+		const std::string tinyFAfile("tinyTest.fasta");
+		{
+			std::fstream outFASTA(tinyFAfile, std::ios::out | std::ios::trunc);
+			outFASTA << ">a\nACGT\n>b\nGG\n";
+		}
+		REQUIRE(BayesicSpace::fileSize(tinyFAfile) == 14);
+		BayesicSpace::OutputFormat compressedFormat;
+		compressedFormat.compression = BayesicSpace::Compression::bgzf;
+		BayesicSpace::saveAsFASTA(std::vector< std::pair<std::string, std::string> >{{"a", "ACGT"}, {"b", "GG"}}, tinyFAfile + ".gz", compressedFormat);
+		constexpr size_t manyThreads{64};
+		for (const auto &eachFileName : {tinyFAfile, tinyFAfile + ".gz"}) {
+			const BayesicSpace::Fasta tinyFA(eachFileName, manyThreads);
+			REQUIRE(tinyFA.size() == 2);
+			REQUIRE(tinyFA.sequence( tinyFA.find("a") ) == std::string("ACGT"));
+			REQUIRE(tinyFA.sequence( tinyFA.find("b") ) == std::string("GG"));
+		}
+	}
+}
+
+TEST_CASE("Can view FASTA records in the arena", "[arena]") {
+	const std::string testFAfile("../tests/test.fasta");
+	const BayesicSpace::MappedFasta mappedFA(testFAfile);
+	const std::vector<std::string> subset{"randomValue", mappedFA.header(5).str(), mappedFA.header(2).str(), mappedFA.header(5).str()};
+	SECTION("Views match the file") {
+		constexpr size_t nThreads{3};
+		const BayesicSpace::Fasta testFA(testFAfile, nThreads);
+		REQUIRE(testFA.size() == mappedFA.size());
+		REQUIRE( testFA.find("randomValue") == testFA.size() );
+		for (size_t iRecord = 0; iRecord < mappedFA.size(); ++iRecord) {
+			REQUIRE(testFA.find( mappedFA.header(iRecord).str() ) == iRecord);
+			REQUIRE(testFA.header(iRecord) == mappedFA.header(iRecord));
+			REQUIRE(testFA.sequenceView(iRecord).str() == mappedFA.sequence(iRecord));
+			REQUIRE(testFA.sequence(iRecord) == mappedFA.sequence(iRecord));
+		}
+		// copies share the arena
+		const BayesicSpace::Fasta copyFA(testFA);
+		REQUIRE(copyFA.sequenceView(1).start == testFA.sequenceView(1).start);
+		REQUIRE_THROWS_WITH(BayesicSpace::Fasta(testFAfile, 1, true).sequenceView(0),
+				Catch::Matchers::StartsWith("ERROR: packed sequences cannot be viewed"));
+	}
+	SECTION("Index subsets match copied subsets") {
+		const BayesicSpace::Fasta testFA(testFAfile);
+		const std::vector<size_t> correctInputOrder{2, 5};
+		const std::vector<size_t> correctListOrder{5, 2};
+		REQUIRE(testFA.subsetIndexes(subset, BayesicSpace::RecordOrder::input) == correctInputOrder);
+		REQUIRE(testFA.subsetIndexes(subset, BayesicSpace::RecordOrder::list) == correctListOrder);
+		constexpr size_t lineWidth{70};
+		for (const auto &packSequences : {false, true}) {
+			const BayesicSpace::Fasta eachFA(testFAfile, 1, packSequences);
+			BayesicSpace::saveAsFASTA(eachFA, eachFA.subsetIndexes(subset, BayesicSpace::RecordOrder::list), "arenaViewTest.fasta", lineWidth);
+			BayesicSpace::saveAsFASTA(eachFA.orderedSubset(subset, BayesicSpace::RecordOrder::list), "arenaCopyTest.fasta", lineWidth);
+			std::fstream viewFile("arenaViewTest.fasta", std::ios::in);
+			std::fstream copyFile("arenaCopyTest.fasta", std::ios::in);
+			const std::string viewBytes{std::istreambuf_iterator<char>(viewFile), std::istreambuf_iterator<char>()};
+			const std::string copyBytes{std::istreambuf_iterator<char>(copyFile), std::istreambuf_iterator<char>()};
+			REQUIRE_FALSE( viewBytes.empty() );
+			REQUIRE(viewBytes == copyBytes);
+		}
+	}
+}
+
+TEST_CASE("Can scan FASTA bytes", "[scanner]") {
+	SECTION("Vectorized and portable scanners agree") {
+		constexpr size_t bufferLength{5000};
+		constexpr uint32_t seed{20230517};
+		std::mt19937 generator(seed);
+		const std::string alphabet{"acgtn>\n\r"};
+		std::uniform_int_distribution<size_t> letterIndex(0, alphabet.size() - 1);
+		std::string buffer;
+		for (size_t iByte = 0; iByte < bufferLength; ++iByte) {
+			buffer.push_back( alphabet[letterIndex(generator)] );
+		}
+		const BayesicSpace::FastaScanner portableScanner(BayesicSpace::SimdLevel::portable);
+		REQUIRE(portableScanner.simdLevel() == BayesicSpace::SimdLevel::portable);
+		std::string expected;
+		std::remove_copy_if(buffer.cbegin(), buffer.cend(), std::back_inserter(expected), [](char letter){return (letter == '\n') || (letter == '\r');});
+		for (const auto &eachLevel : {BayesicSpace::SimdLevel::portable, BayesicSpace::SimdLevel::sse2, BayesicSpace::SimdLevel::avx2}) {
+			const BayesicSpace::FastaScanner scanner(eachLevel);
+			REQUIRE(scanner.simdLevel() <= eachLevel);
+			// every starting offset exercises the scalar tails
+			constexpr size_t nOffsets{70};
+			for (size_t offset = 0; offset < nOffsets; ++offset) {
+				const char *start = buffer.data() + offset;
+				const char *end   = buffer.data() + buffer.size();
+				REQUIRE(scanner.findRecordStart(start, end) == portableScanner.findRecordStart(start, end));
+				std::string stripped(buffer.size() - offset, ' ');
+				stripped.resize( scanner.copyStripped( start, end, &stripped[0] ) );
+				std::string portableStripped(buffer.size() - offset, ' ');
+				portableStripped.resize( portableScanner.copyStripped( start, end, &portableStripped[0] ) );
+				REQUIRE(stripped == portableStripped);
+			}
+			std::string stripped(buffer.size(), ' ');
+			stripped.resize( scanner.copyStripped( buffer.data(), buffer.data() + buffer.size(), &stripped[0] ) );
+			REQUIRE(stripped == expected);
+			const std::string noRecords(bufferLength, 'a');
+			REQUIRE(scanner.findRecordStart( noRecords.data(), noRecords.data() + noRecords.size() ) == noRecords.data() + noRecords.size());
+			const std::string recordAtEnd{noRecords + "\n>"};
+			REQUIRE(scanner.findRecordStart( recordAtEnd.data(), recordAtEnd.data() + recordAtEnd.size() ) == recordAtEnd.data() + recordAtEnd.size() - 1);
+		}
+	}
+	SECTION("Fixed-width lines") {
+		constexpr uint32_t seed{20231017};
+		std::mt19937 generator(seed);
+		const std::string bases{"ACGTN"};
+		std::uniform_int_distribution<size_t> baseIndex(0, bases.size() - 1);
+		// widths around each kernel's vector size and the unrolled widths
+		for (const auto &eachWidth : {7, 8, 9, 15, 16, 17, 31, 32, 33, 59, 60, 61, 70, 80, 120}) {
+			const auto lineWidth = static_cast<size_t>(eachWidth);
+			std::vector<std::string> inputs(4);
+			for (size_t iLine = 0; iLine < 40; ++iLine) {
+				std::string line;
+				for (size_t iBase = 0; iBase < lineWidth; ++iBase) {
+					line.push_back( bases[baseIndex(generator)] );
+				}
+				inputs[0] += line + "\n";                                                             // regular
+				inputs[1] += line + "\r\n";                                                           // Windows line endings
+				inputs[2] += (iLine == 25 ? line.substr(0, lineWidth / 2) + "\n" + line.substr(lineWidth / 2) : line) + "\n"; // a line split in two
+				inputs[3] += (iLine == 30 ? line + "AC" : line) + "\n";                               // a longer line
+			}
+			inputs[0] += "ACG";                                                                         // incomplete last line
+			for (const auto &eachInput : inputs) {
+				std::string expected;
+				std::remove_copy_if(eachInput.cbegin(), eachInput.cend(), std::back_inserter(expected), [](char letter){return (letter == '\n') || (letter == '\r');});
+				for (const auto &eachLevel : {BayesicSpace::SimdLevel::portable, BayesicSpace::SimdLevel::sse2, BayesicSpace::SimdLevel::avx2}) {
+					const BayesicSpace::FastaScanner scanner(eachLevel);
+					// starting mid-line, as when a record continues into a new read block
+					for (size_t offset = 0; offset < lineWidth + 2; offset += 3) {
+						std::string stripped(eachInput.size() - offset, ' ');
+						stripped.resize( scanner.copyStripped( eachInput.data() + offset, eachInput.data() + eachInput.size(), &stripped[0] ) );
+						std::string expectedTail;
+						std::remove_copy_if(eachInput.cbegin() + static_cast<std::ptrdiff_t>(offset), eachInput.cend(), std::back_inserter(expectedTail),
+							[](char letter){return (letter == '\n') || (letter == '\r');});
+						REQUIRE(stripped == expectedTail);
+					}
+				}
+			}
+		}
+	}
+	SECTION("Windows line endings are removed") {
+		const std::string crlfFAfile("crlfTest.fasta");
+		{
+			std::fstream inFASTA("../tests/test.fasta", std::ios::in);
+			std::fstream outFASTA(crlfFAfile, std::ios::out | std::ios::trunc);
+			std::string eachLine;
+			while ( std::getline(inFASTA, eachLine) ) {
+				outFASTA << eachLine << "\r\n";
+			}
+		}
+		const BayesicSpace::Fasta testFA("../tests/test.fasta");
+		const std::unordered_map<std::string, std::string> subsetRecords{testFA.subset("../tests/subsetList.txt")};
+		constexpr size_t nThreads{3};
+		REQUIRE(BayesicSpace::Fasta(crlfFAfile).subset("../tests/subsetList.txt") == subsetRecords);
+		REQUIRE(BayesicSpace::Fasta(crlfFAfile, nThreads).subset("../tests/subsetList.txt") == subsetRecords);
+		REQUIRE(BayesicSpace::MappedFasta(crlfFAfile).subset("../tests/subsetList.txt") == subsetRecords);
+		BayesicSpace::FastaFilter("../tests/subsetList.txt").filter(crlfFAfile, "crlfFilterTest.fasta");
+		REQUIRE(BayesicSpace::Fasta("crlfFilterTest.fasta").subset("../tests/subsetList.txt") == subsetRecords);
+	}
+	SECTION("Records spanning read blocks") {
+		// larger than the reader block, with unique headers
+		const std::string largeFAfile("largeTest.fasta");
+		constexpr size_t nCopies{30};
+		std::vector<std::string> allHeaders;
+		{
+			std::fstream inFASTA("../tests/test.fasta", std::ios::in);
+			std::stringstream testContent;
+			testContent << inFASTA.rdbuf();
+			std::fstream outFASTA(largeFAfile, std::ios::out | std::ios::trunc);
+			std::string eachLine;
+			for (size_t iCopy = 0; iCopy < nCopies; ++iCopy) {
+				testContent.clear();
+				testContent.seekg(0);
+				while ( std::getline(testContent, eachLine) ) {
+					if (eachLine.front() == '>') {
+						eachLine += "_" + std::to_string(iCopy);
+						allHeaders.push_back( eachLine.substr(1) );
+					}
+					outFASTA << eachLine << "\n";
+				}
+			}
+		}
+		const BayesicSpace::Fasta largeFA(largeFAfile);
+		REQUIRE( largeFA.size() == allHeaders.size() );
+		const std::unordered_map<std::string, std::string> allRecords{largeFA.subset(allHeaders)};
+		REQUIRE(BayesicSpace::FastaFilter(allHeaders).filter(largeFAfile, "largeFilterTest.fasta") == allHeaders.size());
+		REQUIRE(BayesicSpace::Fasta("largeFilterTest.fasta").subset(allHeaders) == allRecords);
+
+		BayesicSpace::RecordReader largeReader(largeFAfile);
+		std::string header;
+		std::string sequence;
+		size_t nRecords{0};
+		while ( largeReader.nextHeader(header) ) {
+			REQUIRE(header == allHeaders.at(nRecords));
+			if (nRecords % 2 == 0) {
+				largeReader.readSequence(sequence);
+				REQUIRE( sequence == allRecords.at(header) );
+			} else {
+				largeReader.skipSequence();
+			}
+			++nRecords;
+		}
+		REQUIRE( nRecords == allHeaders.size() );
+	}
+}
+
+TEST_CASE("Can pack sequences", "[packed]") {
+	SECTION("Packing round trip") {
+		REQUIRE( BayesicSpace::PackedSequence( std::string{} ).unpack().empty() );
+		const std::string mixedSequence{"ACGTacgtNNNNnnnnRYKM-*acgTTGcaXx\x80Ngt"};
+		for (size_t length = 0; length <= mixedSequence.size(); ++length) {
+			const std::string eachSequence{mixedSequence.substr(0, length)};
+			const BayesicSpace::PackedSequence packed(eachSequence);
+			REQUIRE(packed.size() == length);
+			REQUIRE(packed.unpack() == eachSequence);
+		}
+		constexpr size_t sequenceLength{100003};
+		constexpr uint32_t seed{1999};
+		std::mt19937 generator(seed);
+		const std::string alphabet{"ACGTacgtNn"};
+		std::uniform_int_distribution<size_t> letterIndex(0, alphabet.size() - 1);
+		std::string randomSequence;
+		for (size_t iBase = 0; iBase < sequenceLength; ++iBase) {
+			randomSequence.push_back( alphabet[letterIndex(generator)] );
+		}
+		REQUIRE(BayesicSpace::PackedSequence(randomSequence).unpack() == randomSequence);
+	}
+	SECTION("Memory savings") {
+		const BayesicSpace::Fasta testFA("../tests/test.fasta");
+		const std::string sequence{testFA.subset( std::vector<std::string>{"B.US.1997.ARES2.AB078005"} ).at("B.US.1997.ARES2.AB078005")};
+		const BayesicSpace::PackedSequence packed(sequence);
+		REQUIRE(packed.unpack() == sequence);
+		constexpr size_t overheadBytes{64};
+		REQUIRE(packed.memoryBytes() <= sequence.size() / 4 + overheadBytes);
+	}
+	SECTION("Packed Fasta objects") {
+		const std::string testFAfile("../tests/test.fasta");
+		const BayesicSpace::Fasta testFA(testFAfile);
+		REQUIRE_FALSE( testFA.isPacked() );
+		constexpr size_t nThreads{3};
+		const BayesicSpace::Fasta packedFA(testFAfile, nThreads, true);
+		REQUIRE( packedFA.isPacked() );
+		REQUIRE( packedFA.size() == testFA.size() );
+		REQUIRE(packedFA.subset("../tests/subsetList.txt") == testFA.subset("../tests/subsetList.txt"));
+		REQUIRE(BayesicSpace::Fasta("../tests/noSeq.fasta", 1, true).size() == 1);
+	}
+}
+
+#ifdef SUBSETFA_HAVE_ZLIB
+TEST_CASE("Can read compressed FASTA files", "[compressed]") {
+	const std::string plainFAfile("../tests/test.fasta");
+	const BayesicSpace::Fasta testFA(plainFAfile);
+	const BayesicSpace::MappedFasta mappedFA(plainFAfile);
+	std::vector<std::string> allHeaders;
+	for (size_t iRecord = 0; iRecord < mappedFA.size(); ++iRecord) {
+		allHeaders.emplace_back( mappedFA.header(iRecord).str() );
+	}
+	const std::unordered_map<std::string, std::string> allRecords{testFA.subset(allHeaders)};
+	SECTION("Compression detection and decompression") {
+		REQUIRE(BayesicSpace::detectCompression(plainFAfile) == BayesicSpace::Compression::none);
+		REQUIRE(BayesicSpace::detectCompression("../tests/test.fasta.gz") == BayesicSpace::Compression::gzip);
+		REQUIRE(BayesicSpace::detectCompression("../tests/test.fasta.bgz") == BayesicSpace::Compression::bgzf);
+		const std::string plainContents{BayesicSpace::readWholeFile(plainFAfile, 1)};
+		REQUIRE(BayesicSpace::readWholeFile("../tests/test.fasta.gz", 1) == plainContents);
+		constexpr size_t maxThreads{4};
+		for (size_t nThreads = 1; nThreads <= maxThreads; ++nThreads) {
+			REQUIRE(BayesicSpace::readWholeFile("../tests/test.fasta.bgz", nThreads) == plainContents);
+		}
+		// concatenated gzip members are read to the end
+		const std::string multiMemberFile("multiMember.fasta.gz");
+		{
+			std::fstream inGzip("../tests/test.fasta.gz", std::ios::in | std::ios::binary);
+			std::stringstream gzipBytes;
+			gzipBytes << inGzip.rdbuf();
+			std::fstream outGzip(multiMemberFile, std::ios::out | std::ios::trunc | std::ios::binary);
+			outGzip << gzipBytes.str() << gzipBytes.str();
+		}
+		REQUIRE(BayesicSpace::readWholeFile(multiMemberFile, 1) == plainContents + plainContents);
+		// runs of empty BGZF blocks longer than a decompression batch do not end the input
+		const std::string emptyBlocksFile("emptyBlocks.fasta.bgz");
+		{
+			std::fstream inBGZF("../tests/test.fasta.bgz", std::ios::in | std::ios::binary);
+			std::stringstream bgzfBytes;
+			bgzfBytes << inBGZF.rdbuf();
+			constexpr size_t emptyBlockSize{28};
+			const std::string emptyBlock{bgzfBytes.str().substr(bgzfBytes.str().size() - emptyBlockSize)};
+			constexpr size_t nEmptyBlocks{1000};
+			std::fstream outBGZF(emptyBlocksFile, std::ios::out | std::ios::trunc | std::ios::binary);
+			outBGZF << bgzfBytes.str();
+			for (size_t iBlock = 0; iBlock < nEmptyBlocks; ++iBlock) {
+				outBGZF << emptyBlock;
+			}
+			outBGZF << bgzfBytes.str();
+		}
+		for (size_t nThreads = 1; nThreads <= maxThreads; ++nThreads) {
+			REQUIRE(BayesicSpace::readWholeFile(emptyBlocksFile, nThreads) == plainContents + plainContents);
+		}
+		// block sizes too small for the header and footer, and uncompressed sizes too large for a block, are rejected before use
+		const std::string badBlockFile("badBlock.fasta.bgz");
+		auto writeBadBlock = [&badBlockFile](const size_t &position, const std::string &replacement) {
+			std::fstream inBGZF("../tests/test.fasta.bgz", std::ios::in | std::ios::binary);
+			std::stringstream bgzfBytes;
+			bgzfBytes << inBGZF.rdbuf();
+			std::string bytes{bgzfBytes.str()};
+			constexpr size_t emptyBlockSize{28};
+			bytes.replace(bytes.size() - emptyBlockSize + position, replacement.size(), replacement);
+			std::fstream outBGZF(badBlockFile, std::ios::out | std::ios::trunc | std::ios::binary);
+			outBGZF << bytes;
+		};
+		constexpr size_t blockSizeField{16};
+		writeBadBlock( blockSizeField, std::string("\x09\x00", 2) );
+		REQUIRE_THROWS_WITH(BayesicSpace::readWholeFile(badBlockFile, 1), Catch::Matchers::StartsWith("ERROR: malformed BGZF block"));
+		REQUIRE_THROWS_WITH(BayesicSpace::BgzfIndex(badBlockFile), Catch::Matchers::StartsWith("ERROR: malformed BGZF block"));
+		constexpr size_t inflatedSizeField{24};
+		writeBadBlock( inflatedSizeField, std::string("\xff\xff\xff\x7f", 4) );
+		REQUIRE_THROWS_WITH(BayesicSpace::readWholeFile(badBlockFile, 1), Catch::Matchers::StartsWith("ERROR: malformed BGZF block"));
+		REQUIRE_THROWS_WITH(BayesicSpace::BgzfIndex(badBlockFile), Catch::Matchers::StartsWith("ERROR: malformed BGZF block"));
+		std::remove( (badBlockFile + ".gzi").c_str() );
+	}
+	SECTION("Loading and filtering") {
+		constexpr size_t nThreads{3};
+		REQUIRE(BayesicSpace::Fasta("../tests/test.fasta.gz").subset(allHeaders) == allRecords);
+		REQUIRE(BayesicSpace::Fasta("../tests/test.fasta.bgz", nThreads).subset(allHeaders) == allRecords);
+		REQUIRE(BayesicSpace::Fasta("../tests/test.fasta.bgz", nThreads, true).subset(allHeaders) == allRecords);
+
+		const BayesicSpace::FastaFilter listFilter("../tests/subsetList.txt");
+		constexpr size_t correctSubsetLen{9};
+		REQUIRE(listFilter.filter("../tests/test.fasta.gz", "filterTest.fasta") == correctSubsetLen);
+		REQUIRE(BayesicSpace::Fasta("filterTest.fasta").subset("../tests/subsetList.txt") == testFA.subset("../tests/subsetList.txt"));
+		REQUIRE(listFilter.filter("../tests/test.fasta.bgz", "filterTest.fasta", nThreads) == correctSubsetLen);
+		REQUIRE(BayesicSpace::Fasta("filterTest.fasta").subset("../tests/subsetList.txt") == testFA.subset("../tests/subsetList.txt"));
+	}
+	SECTION("Indexed extraction") {
+		REQUIRE_THROWS_WITH(BayesicSpace::IndexedFasta("../tests/test.fasta.gz"),
+				Catch::Matchers::StartsWith("ERROR: gzip-compressed file "));
+		// work on a copy so that the indexes are not written next to the test data
+		const std::string bgzfFile("indexTest.fasta.bgz");
+		const std::string plainCopyFile("indexTestPlain.fasta");
+		{
+			std::fstream inBGZF("../tests/test.fasta.bgz", std::ios::in | std::ios::binary);
+			std::fstream outBGZF(bgzfFile, std::ios::out | std::ios::trunc | std::ios::binary);
+			outBGZF << inBGZF.rdbuf();
+			std::fstream inFASTA(plainFAfile, std::ios::in);
+			std::fstream outFASTA(plainCopyFile, std::ios::out | std::ios::trunc);
+			outFASTA << inFASTA.rdbuf();
+		}
+		std::remove( (bgzfFile + ".fai").c_str() );
+		std::remove( (bgzfFile + ".gzi").c_str() );
+		const BayesicSpace::FastaIndex plainIndex(plainCopyFile);
+		const BayesicSpace::FastaIndex bgzfIndex(bgzfFile);
+		REQUIRE( bgzfIndex.size() == plainIndex.size() );
+		for (size_t iEntry = 0; iEntry < bgzfIndex.size(); ++iEntry) {
+			REQUIRE(bgzfIndex.entry(iEntry).offset == plainIndex.entry(iEntry).offset);
+		}
+		const BayesicSpace::BgzfIndex blockIndex(bgzfFile);
+		REQUIRE( BayesicSpace::FastaIndex::isFresh(bgzfFile, bgzfFile + ".gzi") );
+		REQUIRE(BayesicSpace::BgzfIndex(bgzfFile).size() == blockIndex.size());
+		// a block index whose entry count does not match its size is malformed
+		{
+			std::fstream corruptIndex(bgzfFile + ".gzi", std::ios::in | std::ios::out | std::ios::binary);
+			const std::string hugeCount("\xff\xff\xff\xff\xff\xff\xff\x0f", 8);
+			corruptIndex.write( hugeCount.data(), static_cast<std::streamsize>( hugeCount.size() ) );
+		}
+		REQUIRE( BayesicSpace::FastaIndex::isFresh(bgzfFile, bgzfFile + ".gzi") );
+		REQUIRE_THROWS_WITH(BayesicSpace::BgzfIndex(bgzfFile), Catch::Matchers::StartsWith("ERROR: malformed BGZF index file"));
+		REQUIRE(truncate( (bgzfFile + ".gzi").c_str(), 4 ) == 0);
+		REQUIRE_THROWS_WITH(BayesicSpace::BgzfIndex(bgzfFile), Catch::Matchers::StartsWith("ERROR: malformed BGZF index file"));
+		std::remove( (bgzfFile + ".gzi").c_str() );
+		REQUIRE(BayesicSpace::BgzfIndex(bgzfFile).size() == blockIndex.size());
+
+		const BayesicSpace::IndexedFasta indexedFA(bgzfFile);
+		REQUIRE(indexedFA.subset(allHeaders) == allRecords);
+		const std::string fullSequence{allRecords.at("B.US.1997.ARES2.AB078005")};
+		REQUIRE(indexedFA.region("B.US.1997.ARES2.AB078005", 75, 170) == fullSequence.substr(74, 96));
+		const BayesicSpace::IndexedFasta reloadedFA(bgzfFile);
+		REQUIRE(reloadedFA.subset("../tests/subsetList.txt") == testFA.subset("../tests/subsetList.txt"));
+	}
+}
+#endif
+
+TEST_CASE("Can write FASTA records in order", "[writer]") {
+	const std::string testFAfile("../tests/test.fasta");
+	const BayesicSpace::Fasta testFA(testFAfile);
+	const BayesicSpace::MappedFasta mappedFA(testFAfile);
+	std::vector<std::string> fileOrder;
+	for (size_t iRecord = 0; iRecord < mappedFA.size(); ++iRecord) {
+		fileOrder.emplace_back( mappedFA.header(iRecord).str() );
+	}
+	// every other header, reversed, with a repeat and an absent header
+	std::vector<std::string> requests;
+	for (size_t iRecord = 0; iRecord < fileOrder.size(); iRecord += 2) {
+		requests.insert(requests.begin(), fileOrder[iRecord]);
+	}
+	requests.push_back( requests.front() );
+	requests.emplace_back("randomValue");
+	std::vector<std::string> inputOrder;
+	for (size_t iRecord = 0; iRecord < fileOrder.size(); iRecord += 2) {
+		inputOrder.push_back(fileOrder[iRecord]);
+	}
+	const std::vector<std::string> listOrder(inputOrder.crbegin(), inputOrder.crend());
+	auto headersOf = [](const std::vector< std::pair<std::string, std::string> > &records){
+		std::vector<std::string> headers;
+		for (const auto &eachRecord : records) {
+			headers.push_back(eachRecord.first);
+		}
+		return headers;
+	};
+	SECTION("Ordered subsets") {
+		REQUIRE(headersOf( testFA.orderedSubset(requests, BayesicSpace::RecordOrder::input) ) == inputOrder);
+		REQUIRE(headersOf( testFA.orderedSubset(requests, BayesicSpace::RecordOrder::list) ) == listOrder);
+		REQUIRE(headersOf( BayesicSpace::Fasta(testFAfile, 1, true).orderedSubset(requests, BayesicSpace::RecordOrder::list) ) == listOrder);
+		const std::unordered_map<std::string, std::string> subsetRecords{testFA.subset(requests)};
+		for ( const auto &eachRecord : testFA.orderedSubset(requests, BayesicSpace::RecordOrder::input) ) {
+			REQUIRE(eachRecord.second == subsetRecords.at(eachRecord.first));
+		}
+
+		const std::string indexedFAfile("writerIndexTest.fasta");
+		{
+			std::fstream inFASTA(testFAfile, std::ios::in);
+			std::fstream outFASTA(indexedFAfile, std::ios::out | std::ios::trunc);
+			outFASTA << inFASTA.rdbuf();
+		}
+		const BayesicSpace::IndexedFasta indexedFA(indexedFAfile);
+		std::vector<std::string> regionRequests(requests);
+		regionRequests.insert(regionRequests.begin(), fileOrder.back() + ":1-10");
+		std::vector<std::string> regionInputOrder(inputOrder);
+		regionInputOrder.insert(regionInputOrder.end() - static_cast<std::ptrdiff_t>(fileOrder.size() % 2 == 1 ? 1 : 0), fileOrder.back() + ":1-10");
+		REQUIRE(headersOf( indexedFA.orderedSubset(regionRequests, BayesicSpace::RecordOrder::input) ) == regionInputOrder);
+		std::vector<std::string> regionListOrder(listOrder);
+		regionListOrder.insert(regionListOrder.begin(), fileOrder.back() + ":1-10");
+		REQUIRE(headersOf( indexedFA.orderedSubset(regionRequests, BayesicSpace::RecordOrder::list) ) == regionListOrder);
+	}
+	SECTION("Filtering in order") {
+		const BayesicSpace::FastaFilter listFilter(requests);
+		REQUIRE(listFilter.filter(testFAfile, "writerTest.fasta", 1, BayesicSpace::RecordOrder::list, 0) == listOrder.size());
+		const BayesicSpace::MappedFasta listFA("writerTest.fasta");
+		REQUIRE(listFA.size() == listOrder.size());
+		for (size_t iRecord = 0; iRecord < listFA.size(); ++iRecord) {
+			REQUIRE(listFA.header(iRecord).str() == listOrder[iRecord]);
+			REQUIRE(listFA.sequence(iRecord) == testFA.subset( std::vector<std::string>{listOrder[iRecord]} ).at(listOrder[iRecord]));
+		}
+		REQUIRE(listFilter.filter(testFAfile, "writerTest.fasta", 1, BayesicSpace::RecordOrder::input, 0) == inputOrder.size());
+		const BayesicSpace::MappedFasta inputFA("writerTest.fasta");
+		for (size_t iRecord = 0; iRecord < inputFA.size(); ++iRecord) {
+			REQUIRE(inputFA.header(iRecord).str() == inputOrder[iRecord]);
+		}
+	}
+	SECTION("Line wrapping and large records") {
+		constexpr size_t lineWidth{60};
+		BayesicSpace::saveAsFASTA(testFA.orderedSubset(fileOrder, BayesicSpace::RecordOrder::input), "writerTest.fasta", lineWidth);
+		const BayesicSpace::FastaIndex wrappedIndex("writerTest.fasta");
+		REQUIRE(wrappedIndex.size() == fileOrder.size());
+		for (size_t iEntry = 0; iEntry < wrappedIndex.size(); ++iEntry) {
+			REQUIRE(wrappedIndex.entry(iEntry).lineBases == lineWidth);
+			REQUIRE(wrappedIndex.entry(iEntry).lineBytes == lineWidth + 1);
+		}
+		REQUIRE(BayesicSpace::Fasta("writerTest.fasta").subset(fileOrder) == testFA.subset(fileOrder));
+
+		// sequences larger than the write buffer, wrapped and unwrapped
+		std::mt19937_64 prng(17);
+		std::uniform_int_distribution<size_t> baseDist(0, 3);
+		const std::string bases("ACGT");
+		constexpr size_t largeLength{9000001};
+		std::string largeSequence(largeLength, 'A');
+		for (auto &eachBase : largeSequence) {
+			eachBase = bases[baseDist(prng)];
+		}
+		const std::vector< std::pair<std::string, std::string> > largeRecords{
+			{"first", largeSequence}, {"short", "acgt"}, {"second", largeSequence.substr(0, largeLength / 2)}
+		};
+		const std::vector<std::string> largeHeaders{"first", "short", "second"};
+		for (const size_t &eachWidth : std::vector<size_t>{0, 1, lineWidth}) {
+			BayesicSpace::saveAsFASTA(largeRecords, "largeWriterTest.fasta", eachWidth);
+			const BayesicSpace::MappedFasta largeFA("largeWriterTest.fasta");
+			REQUIRE(largeFA.size() == largeRecords.size());
+			for (size_t iRecord = 0; iRecord < largeFA.size(); ++iRecord) {
+				REQUIRE(largeFA.header(iRecord).str() == largeRecords[iRecord].first);
+				REQUIRE(largeFA.sequence(iRecord) == largeRecords[iRecord].second);
+			}
+		}
+	}
+}
+
+TEST_CASE("Can route FASTA records to several outputs", "[demultiplex]") {
+	const std::string testFAfile("../tests/test.fasta");
+	const BayesicSpace::Fasta testFA(testFAfile);
+	const BayesicSpace::MappedFasta mappedFA(testFAfile);
+	// three overlapping lists: first half, every third record (listed twice), and none
+	std::vector< std::vector<std::string> > headerLists(3);
+	for (size_t iRecord = 0; iRecord < mappedFA.size(); ++iRecord) {
+		if (iRecord < mappedFA.size() / 2) {
+			headerLists[0].push_back( mappedFA.header(iRecord).str() );
+		}
+		if (iRecord % 3 == 0) {
+			headerLists[1].push_back( mappedFA.header(iRecord).str() );
+		}
+	}
+	headerLists[1].push_back( headerLists[1].front() );
+	headerLists[2].emplace_back("randomValue");
+	std::fstream manifest("demuxManifest.txt", std::ios::out | std::ios::trunc);
+	for (size_t iList = 0; iList < headerLists.size(); ++iList) {
+		const std::string listFileName("demuxList" + std::to_string(iList) + ".txt");
+		std::fstream listFile(listFileName, std::ios::out | std::ios::trunc);
+		for (const auto &eachHeader : headerLists[iList]) {
+			listFile << ">" << eachHeader << "\n";
+		}
+		manifest << listFileName << "\tdemuxOut" << iList << ".fasta\n\n";
+	}
+	manifest.close();
+	SECTION("Exceptions on wrong data") {
+		std::fstream badManifest("demuxBadManifest.txt", std::ios::out | std::ios::trunc);
+		badManifest << "demuxList0.txt\n";
+		badManifest.close();
+		REQUIRE_THROWS_WITH(BayesicSpace::FastaDemultiplexer("demuxBadManifest.txt"),
+				Catch::Matchers::StartsWith("ERROR: manifest line "));
+		REQUIRE_THROWS_WITH(BayesicSpace::FastaDemultiplexer("demuxMissingManifest.txt"),
+				Catch::Matchers::StartsWith("ERROR: cannot open file "));
+		const std::vector< std::pair<std::string, std::string> > repeatedOutputs{{"demuxList0.txt", "demuxSame.fasta"}, {"demuxList1.txt", "demuxSame.fasta"}};
+		REQUIRE_THROWS_WITH(BayesicSpace::FastaDemultiplexer(repeatedOutputs),
+				Catch::Matchers::StartsWith("ERROR: output file demuxSame.fasta is listed more than once"));
+		const BayesicSpace::FastaDemultiplexer router("demuxManifest.txt");
+		REQUIRE_THROWS_WITH(router.demultiplex("../tests/wrong.fasta", 1, 0),
+				Catch::Matchers::StartsWith("ERROR: first line of a FASTA file must begin with "));
+	}
+	SECTION("Routing matches subsetting") {
+		const BayesicSpace::FastaDemultiplexer router("demuxManifest.txt");
+		REQUIRE(router.size() == headerLists.size());
+		const std::vector<size_t> nWritten{router.demultiplex(testFAfile, 1, 0)};
+		const std::vector<size_t> correctCounts{mappedFA.size() / 2, (mappedFA.size() + 2) / 3, 0};
+		REQUIRE(nWritten == correctCounts);
+		for (size_t iList = 0; iList < headerLists.size(); ++iList) {
+			const std::string outFileName("demuxOut" + std::to_string(iList) + ".fasta");
+			REQUIRE( (BayesicSpace::fileSize(outFileName) > 0) == (iList < 2) );
+			if (iList < 2) {
+				const BayesicSpace::MappedFasta routedFA(outFileName);
+				REQUIRE(routedFA.size() == correctCounts[iList]);
+				REQUIRE(BayesicSpace::Fasta(outFileName).subset(headerLists[iList]) == testFA.subset(headerLists[iList]));
+			}
+		}
+		const std::vector< std::pair<std::string, std::string> > pairs{{"demuxList1.txt", "demuxOutPairs.fasta"}};
+		constexpr size_t lineWidth{50};
+		REQUIRE(BayesicSpace::FastaDemultiplexer(pairs).demultiplex(testFAfile, 1, lineWidth).front() == correctCounts[1]);
+		REQUIRE(BayesicSpace::Fasta("demuxOutPairs.fasta").subset(headerLists[1]) == testFA.subset(headerLists[1]));
+	}
+}
+
+TEST_CASE("Can match accessions and header prefixes", "[headers]") {
+	const std::string headerFAfile("headerTest.fasta");
+	{
+		std::fstream outFASTA(headerFAfile, std::ios::out | std::ios::trunc);
+		outFASTA << ">NM_0001.1 first gene\nACGT\n>01B.MM.2000.A\nCCCC\n>NM_0002.1\tsecond gene\nGGGG\n"
+			<< ">01BC.MM.2000.B\nTTTT\n>01B.MM.1999.C extra words\nAAAA\n>NM_0001.10 similar accession\nCGCG\n";
+	}
+	const std::vector<std::string> fileOrder{
+		"NM_0001.1 first gene", "01B.MM.2000.A", "NM_0002.1\tsecond gene", "01BC.MM.2000.B", "01B.MM.1999.C extra words", "NM_0001.10 similar accession"
+	};
+	SECTION("Index queries") {
+		REQUIRE(BayesicSpace::accession("NM_0002.1\tsecond gene") == std::string("NM_0002.1"));
+		REQUIRE(BayesicSpace::accession("noSpaces") == std::string("noSpaces"));
+		const BayesicSpace::HeaderIndex testIndex(fileOrder);
+		REQUIRE(testIndex.size() == fileOrder.size());
+		REQUIRE(testIndex.find("NM_0001.1", BayesicSpace::HeaderMatch::accession) == std::vector<size_t>{0});
+		REQUIRE(testIndex.find("NM_0001.1", BayesicSpace::HeaderMatch::prefix) == std::vector<size_t>{0, 5});
+		REQUIRE(testIndex.find("01B.MM.", BayesicSpace::HeaderMatch::prefix) == std::vector<size_t>{1, 4});
+		REQUIRE(testIndex.find("01B", BayesicSpace::HeaderMatch::prefix) == std::vector<size_t>{1, 3, 4});
+		REQUIRE(testIndex.find("01B.MM.2000.A", BayesicSpace::HeaderMatch::whole) == std::vector<size_t>{1});
+		REQUIRE( testIndex.find("01B.MM.", BayesicSpace::HeaderMatch::whole).empty() );
+		REQUIRE( testIndex.find("zzz", BayesicSpace::HeaderMatch::prefix).empty() );
+		REQUIRE( testIndex.find("NM_0003.1", BayesicSpace::HeaderMatch::accession).empty() );
+		const std::vector<std::string> expanded{testIndex.expand(std::vector<std::string>{"01BC", "01B", "NM_0002"}, BayesicSpace::HeaderMatch::prefix)};
+		const std::vector<std::string> correctExpanded{"01BC.MM.2000.B", "01B.MM.2000.A", "01B.MM.1999.C extra words", "NM_0002.1\tsecond gene"};
+		REQUIRE(expanded == correctExpanded);
+	}
+	SECTION("Subsetting loaded records") {
+		BayesicSpace::Fasta testFA(headerFAfile);
+		const std::vector<std::string> accessions{"NM_0002.1", "NM_0001.1", "randomValue"};
+		REQUIRE_THROWS_WITH(testFA.matchHeaders(accessions, BayesicSpace::HeaderMatch::accession),
+				Catch::Matchers::StartsWith("ERROR: accession and prefix matching require the header index"));
+		REQUIRE(testFA.matchHeaders(accessions, BayesicSpace::HeaderMatch::whole) == accessions);
+		testFA.buildHeaderIndex();
+		const std::vector<std::string> matched{testFA.matchHeaders(accessions, BayesicSpace::HeaderMatch::accession)};
+		REQUIRE(matched == std::vector<std::string>{"NM_0002.1\tsecond gene", "NM_0001.1 first gene"});
+		REQUIRE(testFA.subset(matched).at("NM_0002.1\tsecond gene") == std::string("GGGG"));
+		const std::vector< std::pair<std::string, std::string> > prefixSubset{
+			testFA.orderedSubset(testFA.matchHeaders(std::vector<std::string>{"01B.MM."}, BayesicSpace::HeaderMatch::prefix), BayesicSpace::RecordOrder::input)
+		};
+		REQUIRE(prefixSubset.size() == 2);
+		REQUIRE(prefixSubset.front().second == std::string("CCCC"));
+		REQUIRE(prefixSubset.back().second == std::string("AAAA"));
+	}
+	SECTION("Streaming and indexed extraction") {
+		const BayesicSpace::FastaFilter accessionFilter(std::vector<std::string>{"NM_0001.10", "NM_0002.1"}, BayesicSpace::HeaderMatch::accession);
+		REQUIRE(accessionFilter.filter(headerFAfile, "headerFilterTest.fasta", 1, BayesicSpace::RecordOrder::list, 0) == 2);
+		const BayesicSpace::MappedFasta accessionFA("headerFilterTest.fasta");
+		REQUIRE(accessionFA.header(0).str() == fileOrder[5]);
+		REQUIRE(accessionFA.header(1).str() == fileOrder[2]);
+		const BayesicSpace::FastaFilter prefixFilter(std::vector<std::string>{"01B.MM.", "01B", "NM_0001.1"}, BayesicSpace::HeaderMatch::prefix);
+		REQUIRE(prefixFilter.filter(headerFAfile, "headerFilterTest.fasta", 1, BayesicSpace::RecordOrder::list, 0) == 5);
+		const BayesicSpace::MappedFasta prefixFA("headerFilterTest.fasta");
+		const std::vector<size_t> correctOrder{1, 4, 3, 0, 5};
+		for (size_t iRecord = 0; iRecord < prefixFA.size(); ++iRecord) {
+			REQUIRE(prefixFA.header(iRecord).str() == fileOrder[correctOrder[iRecord]]);
+		}
+
+		// index names are first words, as in samtools; whole headers are confirmed against the file
+		const BayesicSpace::FastaIndex headerIndex(headerFAfile);
+		REQUIRE(headerIndex.entry(0).name == std::string("NM_0001.1"));
+		REQUIRE(headerIndex.entry(2).name == std::string("NM_0002.1"));
+		BayesicSpace::IndexedFasta indexedFA(headerFAfile);
+		std::string sequence;
+		REQUIRE( indexedFA.fetch("NM_0002.1", sequence) );
+		REQUIRE(sequence == std::string("GGGG"));
+		REQUIRE( indexedFA.fetch("NM_0002.1\tsecond gene", sequence) );
+		REQUIRE(sequence == std::string("GGGG"));
+		REQUIRE( indexedFA.fetch("01B.MM.1999.C extra words:2-3", sequence) );
+		REQUIRE(sequence == std::string("AA"));
+		REQUIRE_FALSE( indexedFA.fetch("NM_0002.1 other gene", sequence) );
+		// a samtools index of the same file is reused as is
+		{
+			std::fstream samtoolsIndex(headerFAfile + ".fai", std::ios::out | std::ios::trunc);
+			samtoolsIndex << "NM_0001.1\t4\t22\t4\t5\n01B.MM.2000.A\t4\t42\t4\t5\nNM_0002.1\t4\t70\t4\t5\n"
+				<< "01BC.MM.2000.B\t4\t91\t4\t5\n01B.MM.1999.C\t4\t123\t4\t5\nNM_0001.10\t4\t158\t4\t5\n";
+		}
+		const BayesicSpace::IndexedFasta samtoolsFA(headerFAfile);
+		REQUIRE( samtoolsFA.fetch("NM_0001.10 similar accession", sequence) );
+		REQUIRE(sequence == std::string("CGCG"));
+		REQUIRE( samtoolsFA.fetch("01BC.MM.2000.B", sequence) );
+		REQUIRE(sequence == std::string("TTTT"));
+		REQUIRE_THROWS_WITH(indexedFA.matchHeaders(std::vector<std::string>{"01B"}, BayesicSpace::HeaderMatch::prefix),
+				Catch::Matchers::StartsWith("ERROR: accession and prefix matching require the header index"));
+		indexedFA.buildHeaderIndex();
+		const std::vector<std::string> requests{indexedFA.matchHeaders(std::vector<std::string>{"01B"}, BayesicSpace::HeaderMatch::prefix)};
+		REQUIRE(requests.size() == 3);
+		REQUIRE(indexedFA.subset(requests).at("01BC.MM.2000.B") == std::string("TTTT"));
+	}
+}
+
+TEST_CASE("Can record run statistics", "[stats]") {
+	const std::string testFAfile("../tests/test.fasta");
+	const BayesicSpace::MappedFasta mappedFA(testFAfile);
+	SECTION("Disabled statistics are empty") {
+		BayesicSpace::RunStatistics statistics;
+		REQUIRE_FALSE( statistics.enabled() );
+		statistics.startPhase("phase");
+		statistics.addCount("count", 5);
+		statistics.endPhase();
+		REQUIRE(statistics.count("count") == 0);
+		REQUIRE(statistics.phaseSeconds("phase") == 0.0);
+		REQUIRE(BayesicSpace::FastaFilter("../tests/subsetList.txt").filter(testFAfile, "statsTest.fasta", 1, BayesicSpace::RecordOrder::input, 0, statistics) == 9);
+		REQUIRE(statistics.count("records parsed") == 0);
+	}
+	SECTION("Counts and phases") {
+		BayesicSpace::RunStatistics statistics(true);
+		statistics.startPhase("first");
+		statistics.addCount("count", 5);
+		statistics.addCount("count", 2);
+		statistics.startPhase("second");
+		statistics.startPhase("first");
+		statistics.endPhase();
+		statistics.endPhase();
+		REQUIRE(statistics.count("count") == 7);
+		REQUIRE(statistics.count("absent") == 0);
+		REQUIRE(statistics.phaseSeconds("first") >= 0.0);
+		REQUIRE(BayesicSpace::RunStatistics::peakRSS() > 0);
+		const std::string json{statistics.json()};
+		REQUIRE(json.find("\"phaseSeconds\": {\"first\": ") != std::string::npos);
+		REQUIRE(json.find("\"count\": 7") != std::string::npos);
+		REQUIRE(json.find("\"peakRSSkB\": ") != std::string::npos);
+		std::stringstream report;
+		statistics.report(report);
+		REQUIRE(report.str().find("  count: 7\n") != std::string::npos);
+	}
+	SECTION("Filtering and routing statistics") {
+		BayesicSpace::RunStatistics statistics(true);
+		const BayesicSpace::FastaFilter listFilter("../tests/subsetList.txt");
+		const size_t nMatched{listFilter.filter(testFAfile, "statsTest.fasta", 1, BayesicSpace::RecordOrder::input, 0, statistics)};
+		REQUIRE(statistics.count("records parsed") == mappedFA.size());
+		REQUIRE(statistics.count("records matched") == nMatched);
+		REQUIRE(statistics.json().find("\"header table load factor\": ") != std::string::npos);
+
+		std::fstream listFile("statsList.txt", std::ios::out | std::ios::trunc);
+		listFile << mappedFA.header(0).str() << "\nrandomValue\n";
+		listFile.close();
+		const std::vector< std::pair<std::string, std::string> > pairs{{"statsList.txt", "statsOut.fasta"}};
+		const BayesicSpace::FastaDemultiplexer router(pairs);
+		BayesicSpace::RunStatistics routeStatistics(true);
+		REQUIRE(router.demultiplex(testFAfile, 1, 0, routeStatistics).front() == 1);
+		REQUIRE(routeStatistics.count("records parsed") == mappedFA.size());
+		REQUIRE(routeStatistics.count("records matched") == 1);
+		REQUIRE(router.nHeaders() == 2);
+		REQUIRE(router.outFileNames().front() == "statsOut.fasta");
+		REQUIRE( BayesicSpace::Fasta(testFAfile).loadFactor() > 0.0F );
+	}
+	SECTION("Bytes read and written") {
+		uint64_t nRead{BayesicSpace::RunStatistics::bytesRead()};
+		const BayesicSpace::MappedFasta countedFA(testFAfile);
+		REQUIRE(BayesicSpace::RunStatistics::bytesRead() - nRead == BayesicSpace::fileSize(testFAfile));
+		nRead = BayesicSpace::RunStatistics::bytesRead();
+		const std::vector<std::string> headers{BayesicSpace::readHeaderList("../tests/subsetList.txt")};
+		REQUIRE(BayesicSpace::RunStatistics::bytesRead() - nRead == BayesicSpace::fileSize("../tests/subsetList.txt"));
+		const uint64_t nWritten{BayesicSpace::RunStatistics::bytesWritten()};
+		REQUIRE(BayesicSpace::FastaFilter(headers).filter(testFAfile, "statsTest.fasta", 1, BayesicSpace::RecordOrder::input, 0) == 9);
+		REQUIRE(BayesicSpace::RunStatistics::bytesWritten() - nWritten == BayesicSpace::fileSize("statsTest.fasta"));
+	}
+}
+
+TEST_CASE("Can serve FASTA subsets from memory", "[server]") {
+	const std::string testFAfile("../tests/test.fasta");
+	const std::string socketPath("subsetfaTest.sock");
+	const BayesicSpace::Fasta testFA(testFAfile);
+	const BayesicSpace::MappedFasta mappedFA(testFAfile);
+	SECTION("Exceptions on wrong data") {
+		REQUIRE_THROWS_WITH(BayesicSpace::FastaServer(socketPath, std::vector<std::string>{}, 1, false),
+				Catch::Matchers::StartsWith("ERROR: the server needs at least one FASTA file"));
+		REQUIRE_THROWS_WITH(BayesicSpace::FastaServer(std::string(200, 'x'), std::vector<std::string>{testFAfile}, 1, false),
+				Catch::Matchers::StartsWith("ERROR: socket path "));
+		REQUIRE_THROWS_WITH(BayesicSpace::requestSubset("missingServer.sock", BayesicSpace::SubsetRequest{}, "serverTest.fasta"),
+				Catch::Matchers::StartsWith("ERROR: cannot connect to the server at "));
+		// only stale sockets are replaced
+		const std::string plainFileName("serverPlain.sock");
+		{
+			std::fstream plainFile(plainFileName, std::ios::out | std::ios::trunc);
+			plainFile << "not a socket\n";
+		}
+		REQUIRE_THROWS_WITH(BayesicSpace::FastaServer(plainFileName, std::vector<std::string>{testFAfile}, 1, false),
+				Catch::Matchers::StartsWith("ERROR: serverPlain.sock exists and is not a socket"));
+		REQUIRE(BayesicSpace::fileSize(plainFileName) == 13);
+		std::remove( plainFileName.c_str() );
+		{
+			BayesicSpace::FastaServer runningServer(socketPath, std::vector<std::string>{testFAfile}, 1, false);
+			REQUIRE_THROWS_WITH(BayesicSpace::FastaServer(socketPath, std::vector<std::string>{testFAfile}, 1, false),
+					Catch::Matchers::StartsWith("ERROR: a server is already listening on subsetfaTest.sock"));
+		}
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		std::copy( socketPath.cbegin(), socketPath.cend(), static_cast<char*>(address.sun_path) );
+		const int staleDescriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+		REQUIRE(bind( staleDescriptor, reinterpret_cast<const sockaddr*>(&address), sizeof(address) ) == 0);
+		close(staleDescriptor);
+		REQUIRE_NOTHROW(BayesicSpace::FastaServer(socketPath, std::vector<std::string>{testFAfile}, 1, false));
+	}
+	SECTION("Served subsets match local subsets") {
+		BayesicSpace::FastaServer server(socketPath, std::vector<std::string>{testFAfile, "../tests/noSeq.fasta"}, 2, false);
+		REQUIRE(server.size() == 2);
+		std::thread serverThread([&server]{server.serve();});
+		BayesicSpace::SubsetRequest badRequest;
+		badRequest.fastaName = "missing.fasta";
+		REQUIRE_THROWS_WITH(BayesicSpace::requestSubset(socketPath, badRequest, "serverTest.fasta"),
+				Catch::Matchers::StartsWith("ERROR: FASTA file missing.fasta is not loaded"));
+		// concurrent clients with different requests
+		constexpr size_t nClients{6};
+		std::vector<std::string> responses(nClients);
+		std::vector<BayesicSpace::SubsetRequest> requests(nClients);
+		std::vector<std::thread> clientThreads;
+		for (size_t iClient = 0; iClient < nClients; ++iClient) {
+			requests[iClient].fastaName = (iClient == 0 ? std::string() : testFAfile);
+			requests[iClient].order     = (iClient % 2 == 0 ? BayesicSpace::RecordOrder::list : BayesicSpace::RecordOrder::input);
+			requests[iClient].lineWidth = iClient * 20;
+			// every other record, listed in reverse file order
+			for (size_t iRecord = iClient; iRecord < mappedFA.size(); iRecord += 2) {
+				requests[iClient].headers.push_back( mappedFA.header(mappedFA.size() - 1 - iRecord).str() );
+			}
+			clientThreads.emplace_back([&requests, &responses, &socketPath, iClient]{
+				const std::string outFileName("serverTest" + std::to_string(iClient) + ".fasta");
+				BayesicSpace::requestSubset(socketPath, requests[iClient], outFileName);
+				std::fstream outFile(outFileName, std::ios::in);
+				responses[iClient] = std::string{std::istreambuf_iterator<char>(outFile), std::istreambuf_iterator<char>()};
+			});
+		}
+		for (auto &eachThread : clientThreads) {
+			eachThread.join();
+		}
+		for (size_t iClient = 0; iClient < nClients; ++iClient) {
+			BayesicSpace::saveAsFASTA(testFA.orderedSubset(requests[iClient].headers, requests[iClient].order), "serverLocal.fasta", requests[iClient].lineWidth);
+			std::fstream localFile("serverLocal.fasta", std::ios::in);
+			const std::string localBytes{std::istreambuf_iterator<char>(localFile), std::istreambuf_iterator<char>()};
+			REQUIRE_FALSE( responses[iClient].empty() );
+			REQUIRE(responses[iClient] == localBytes);
+		}
+		BayesicSpace::SubsetRequest prefixRequest;
+		prefixRequest.fastaName = testFAfile;
+		prefixRequest.match     = BayesicSpace::HeaderMatch::prefix;
+		prefixRequest.headers.emplace_back("randomValue");
+		REQUIRE(BayesicSpace::requestSubset(socketPath, prefixRequest, "serverTest.fasta") == 0);
+		server.stop();
+		serverThread.join();
+	}
+}
+
+TEST_CASE("Can pipeline reading and writing", "[pipeline]") {
+	SECTION("Queue passes items in order") {
+		BayesicSpace::SpscQueue<size_t> queue(3);
+		constexpr size_t nItems{100000};
+		std::thread producer([&queue]{
+			for (size_t iItem = 0; iItem < nItems; ++iItem) {
+				size_t item{iItem};
+				size_t nAttempts{0};
+				while ( !queue.tryPush(item) ) {
+					BayesicSpace::backOff(nAttempts);
+				}
+			}
+		});
+		bool inOrder{true};
+		for (size_t iItem = 0; iItem < nItems; ++iItem) {
+			size_t item{0};
+			size_t nAttempts{0};
+			while ( !queue.tryPop(item) ) {
+				BayesicSpace::backOff(nAttempts);
+			}
+			inOrder = inOrder && (item == iItem);
+		}
+		producer.join();
+		REQUIRE(inOrder);
+		size_t item{0};
+		REQUIRE_FALSE( queue.tryPop(item) );
+	}
+	SECTION("Read-ahead matches direct reading") {
+		const std::string testFAfile("../tests/test.fasta");
+		std::unique_ptr<BayesicSpace::InputStream> readAhead{BayesicSpace::openReadAheadStream(testFAfile, 1)};
+		std::string contents;
+		constexpr size_t readSize{1000};
+		std::vector<char> chunk(readSize);
+		size_t nRead{0};
+		while ( ( nRead = readAhead->read(chunk.data(), readSize) ) > 0 ) {
+			contents.append(chunk.data(), nRead);
+		}
+		REQUIRE(contents == BayesicSpace::readWholeFile(testFAfile, 1));
+		REQUIRE(readAhead->read(chunk.data(), readSize) == 0);
+		// a stream abandoned part way must stop its thread
+		std::unique_ptr<BayesicSpace::InputStream> abandoned{BayesicSpace::openReadAheadStream(testFAfile, 1)};
+		REQUIRE(abandoned->read(chunk.data(), readSize) == readSize);
+		abandoned.reset();
+		BayesicSpace::RecordReader fastaReader(testFAfile, 1, true);
+		std::string header;
+		size_t nRecords{0};
+		while ( fastaReader.nextHeader(header) ) {
+			fastaReader.skipSequence();
+			++nRecords;
+		}
+		REQUIRE( nRecords == BayesicSpace::MappedFasta(testFAfile).size() );
+	}
+	SECTION("Background writing matches direct writing") {
+		// long sequences fill several buffers and would be written directly without background writing
+		std::mt19937_64 generator(1983);
+		const std::string bases("ACGT");
+		std::vector< std::pair<std::string, std::string> > records;
+		constexpr size_t nRecords{4};
+		constexpr size_t sequenceLength{3000000};
+		for (size_t iRecord = 0; iRecord < nRecords; ++iRecord) {
+			std::string sequence(sequenceLength + iRecord * 1001, 'A');
+			for (auto &eachBase : sequence) {
+				eachBase = bases[generator() % bases.size()];
+			}
+			records.emplace_back("record" + std::to_string(iRecord), std::move(sequence));
+		}
+		constexpr size_t lineWidth{60};
+		for (const auto &eachWidth : {static_cast<size_t>(0), lineWidth}) {
+			BayesicSpace::FastaWriter directWriter("pipelineDirect.fasta", eachWidth);
+			BayesicSpace::FastaWriter backgroundWriter("pipelineBackground.fasta", eachWidth, true);
+			for (const auto &eachRecord : records) {
+				directWriter.write(eachRecord.first, eachRecord.second);
+				backgroundWriter.write(eachRecord.first, eachRecord.second);
+			}
+			directWriter.close();
+			// moving a writer must not disturb its background thread
+			BayesicSpace::FastaWriter movedWriter( std::move(backgroundWriter) );
+			movedWriter.close();
+			std::fstream directFile("pipelineDirect.fasta", std::ios::in);
+			std::fstream backgroundFile("pipelineBackground.fasta", std::ios::in);
+			const std::string directBytes{std::istreambuf_iterator<char>(directFile), std::istreambuf_iterator<char>()};
+			const std::string backgroundBytes{std::istreambuf_iterator<char>(backgroundFile), std::istreambuf_iterator<char>()};
+			REQUIRE(directBytes.size() > nRecords * sequenceLength);
+			REQUIRE(directBytes == backgroundBytes);
+		}
+		BayesicSpace::FastaWriter fullWriter("/dev/full", 0, true);
+		auto writeAll = [&fullWriter, &records]{
+			for (const auto &eachRecord : records) {
+				fullWriter.write(eachRecord.first, eachRecord.second);
+			}
+			fullWriter.close();
+		};
+		REQUIRE_THROWS_WITH(writeAll(),
+			Catch::Matchers::StartsWith("ERROR: failed to write the output file"));
+	}
+}
+
+TEST_CASE("Can look up long header lists", "[headerset]") {
+	SECTION("Positions and duplicates") {
+		const std::vector<std::string> headerList{"second", "first", "second", "third", "", "first"};
+		const BayesicSpace::HeaderSet testSet(headerList);
+		REQUIRE(testSet.size() == 4);
+		REQUIRE(testSet.entry(0).str() == std::string("second"));
+		REQUIRE(testSet.entry(1).str() == std::string("first"));
+		REQUIRE(testSet.entry(2).str() == std::string("third"));
+		REQUIRE(testSet.find("first") == 1);
+		REQUIRE(testSet.find("third") == 2);
+		REQUIRE(testSet.find("") == 3);
+		REQUIRE(testSet.find("fourth") == testSet.size());
+		REQUIRE(testSet.find("firs") == testSet.size());
+		REQUIRE(testSet.loadFactor() <= 0.5);
+		const BayesicSpace::HeaderSet emptySet;
+		REQUIRE(emptySet.size() == 0);
+		REQUIRE(emptySet.find("first") == 0);
+	}
+	SECTION("Header list files") {
+		const std::string listFileName("headerSetTest.txt");
+		{
+			std::fstream listFile(listFileName, std::ios::out | std::ios::trunc);
+			listFile << ">one header\n\ntwo\n>one header\nthree";
+		}
+		const BayesicSpace::HeaderSet fileSet(listFileName);
+		REQUIRE(fileSet.size() == 3);
+		REQUIRE(fileSet.entry(0).str() == std::string("one header"));
+		REQUIRE(fileSet.find("two") == 1);
+		REQUIRE(fileSet.find("three") == 2);
+		REQUIRE(fileSet.find(">one header") == fileSet.size());
+		const BayesicSpace::HeaderSet missingSet("notAfile.txt");
+		REQUIRE(missingSet.size() == 0);
+	}
+	SECTION("Large sets agree with a hash table") {
+		constexpr size_t nHeaders{20000};
+		std::vector<std::string> headerList;
+		std::unordered_map<std::string, size_t> referenceMap;
+		std::mt19937_64 prng(7);
+		for (size_t iHeader = 0; iHeader < nHeaders; ++iHeader) {
+			std::string header("seq_" + std::to_string( prng() % (nHeaders * 2) ) + " description");
+			referenceMap.emplace(header, referenceMap.size());
+			headerList.emplace_back( std::move(header) );
+		}
+		const BayesicSpace::HeaderSet largeSet(headerList);
+		REQUIRE(largeSet.size() == referenceMap.size());
+		size_t nMismatches{0};
+		size_t nFilterMisses{0};
+		for (size_t iQuery = 0; iQuery < nHeaders * 2; ++iQuery) {
+			const std::string query("seq_" + std::to_string(iQuery) + " description");
+			const auto referenceIt = referenceMap.find(query);
+			const size_t position  = largeSet.find(query);
+			if (referenceIt == referenceMap.end()) {
+				nMismatches += static_cast<size_t>( position != largeSet.size() );
+			} else {
+				nMismatches  += static_cast<size_t>(position != referenceIt->second);
+				nFilterMisses += static_cast<size_t>( !largeSet.mayContain( BayesicSpace::CharView{query.data(), query.size()} ) );
+			}
+		}
+		REQUIRE(nMismatches == 0);
+		REQUIRE(nFilterMisses == 0);
+	}
+	SECTION("Subsetting loaded records") {
+		const std::string testFAfile("../tests/test.fasta");
+		const BayesicSpace::Fasta testFA(testFAfile);
+		std::vector<std::string> headerList;
+		for (size_t iRecord = 0; iRecord < testFA.size(); iRecord += 3) {
+			headerList.push_back( testFA.header(testFA.size() - 1 - iRecord).str() );
+		}
+		headerList.emplace_back("notInFile");
+		const BayesicSpace::HeaderSet headerSet(headerList);
+		for (const auto &eachOrder : {BayesicSpace::RecordOrder::input, BayesicSpace::RecordOrder::list}) {
+			REQUIRE(testFA.subsetIndexes(headerSet, eachOrder) == testFA.subsetIndexes(headerList, eachOrder));
+		}
+		// a list longer than the file is probed record by record
+		for (size_t iExtra = 0; iExtra < testFA.size() * 2; ++iExtra) {
+			headerList.push_back( "extra" + std::to_string(iExtra) );
+		}
+		const BayesicSpace::HeaderSet longSet(headerList);
+		REQUIRE(testFA.subsetIndexes(longSet, BayesicSpace::RecordOrder::input) == testFA.subsetIndexes(headerList, BayesicSpace::RecordOrder::input));
+	}
+}
+
+TEST_CASE("Can filter sharded FASTA files", "[shards]") {
+	constexpr size_t nShards{5};
+	std::vector<std::string> shardFileNames;
+	std::vector<std::string> headerList;
+	for (size_t iShard = 0; iShard < nShards; ++iShard) {
+		shardFileNames.push_back( "shardTest" + std::to_string(iShard) + ".fasta" );
+		std::fstream shardFile(shardFileNames.back(), std::ios::out | std::ios::trunc);
+		// shards differ in size so that they are scheduled out of input order
+		for (size_t iRecord = 0; iRecord < (iShard + 1) * 50; ++iRecord) {
+			shardFile << ">shard" << iShard << "_" << iRecord << "\n" << std::string(iRecord % 7 + 1, 'A') << "\n";
+		}
+		// the same header in every shard, with a shard-specific sequence
+		shardFile << ">shared\n" << std::string(iShard + 1, 'C') << "\n";
+		headerList.push_back( "shard" + std::to_string(iShard) + "_" + std::to_string(iShard * 3) );
+	}
+	headerList.emplace_back("shard0_1");
+	headerList.emplace_back("shared");
+	headerList.emplace_back("notInShards");
+	const BayesicSpace::FastaFilter shardFilter(headerList);
+	SECTION("Name helpers") {
+		const std::string nameListFile("shardNames.txt");
+		{
+			std::fstream nameFile(nameListFile, std::ios::out | std::ios::trunc);
+			nameFile << "first.fa\n\nsecond.fa.gz\n";
+		}
+		REQUIRE(BayesicSpace::inputFileNames("@" + nameListFile) == std::vector<std::string>{"first.fa", "second.fa.gz"});
+		REQUIRE(BayesicSpace::inputFileNames("first.fa,,second.fa.gz") == std::vector<std::string>{"first.fa", "second.fa.gz"});
+		REQUIRE_THROWS_WITH(BayesicSpace::inputFileNames("@notAfile.txt"), Catch::Matchers::StartsWith("ERROR: cannot open file notAfile.txt"));
+		REQUIRE(BayesicSpace::shardOutFileName("refs/chr1.fa.gz", "out/subset.fasta") == std::string("out/chr1_subset.fasta"));
+		REQUIRE(BayesicSpace::shardOutFileName("chrX", "subset.fasta") == std::string("chrX_subset.fasta"));
+	}
+	SECTION("Merged output") {
+		for (const auto &eachThreadCount : {static_cast<size_t>(1), static_cast<size_t>(3), nShards * 2}) {
+			BayesicSpace::RunStatistics statistics(true);
+			const size_t nWritten = shardFilter.filterShards(shardFileNames, std::vector<std::string>{"shardTestOut.fasta"}, eachThreadCount,
+				BayesicSpace::RecordOrder::input, 0, statistics);
+			REQUIRE(nWritten == nShards + 2);
+			REQUIRE(statistics.count("records matched") == nShards + 2);
+			REQUIRE(statistics.count("shards") == nShards);
+			const BayesicSpace::MappedFasta mergedFA("shardTestOut.fasta");
+			REQUIRE(mergedFA.size() == nShards + 2);
+			REQUIRE(mergedFA.header(0).str() == std::string("shard0_0"));
+			REQUIRE(mergedFA.header(1).str() == std::string("shard0_1"));
+			REQUIRE(mergedFA.header(2).str() == std::string("shared"));
+			REQUIRE(mergedFA.sequence(2) == std::string("C"));
+			REQUIRE(mergedFA.header(3).str() == std::string("shard1_3"));
+			REQUIRE(mergedFA.header(nShards + 1).str() == "shard" + std::to_string(nShards - 1) + "_" + std::to_string( (nShards - 1) * 3 ));
+		}
+		REQUIRE(shardFilter.filterShards(shardFileNames, std::vector<std::string>{"shardTestOut.fasta"}, 2, BayesicSpace::RecordOrder::list, 0) == nShards + 2);
+		const BayesicSpace::MappedFasta listFA("shardTestOut.fasta");
+		for (size_t iRecord = 0; iRecord < listFA.size(); ++iRecord) {
+			REQUIRE(listFA.header(iRecord).str() == headerList[iRecord]);
+		}
+	}
+	SECTION("Per-shard outputs") {
+		std::vector<std::string> outFileNames;
+		for (const auto &eachShard : shardFileNames) {
+			outFileNames.push_back( BayesicSpace::shardOutFileName(eachShard, "shardOut.fasta") );
+		}
+		REQUIRE(shardFilter.filterShards(shardFileNames, outFileNames, 3, BayesicSpace::RecordOrder::input, 0) == nShards * 2 + 1);
+		for (size_t iShard = 0; iShard < nShards; ++iShard) {
+			const BayesicSpace::MappedFasta shardFA(outFileNames[iShard]);
+			REQUIRE(shardFA.size() == (iShard == 0 ? 3 : 2));
+			REQUIRE(shardFA.header(shardFA.size() - 1).str() == std::string("shared"));
+			REQUIRE(shardFA.sequence(shardFA.size() - 1) == std::string(iShard + 1, 'C'));
+		}
+	}
+	SECTION("Errors") {
+		REQUIRE_THROWS_WITH(shardFilter.filterShards(shardFileNames, std::vector<std::string>{"a.fasta", "b.fasta"}, 2, BayesicSpace::RecordOrder::input, 0),
+			Catch::Matchers::StartsWith("ERROR: there must be one output file or one per input file"));
+		REQUIRE_THROWS_WITH(shardFilter.filterShards(std::vector<std::string>{shardFileNames[0], shardFileNames[1]}, std::vector<std::string>{"a.fasta", "a.fasta"},
+			2, BayesicSpace::RecordOrder::input, 0), Catch::Matchers::StartsWith("ERROR: output file names must be distinct"));
+		std::vector<std::string> withMissing(shardFileNames);
+		withMissing.emplace_back("notAshard.fasta");
+		REQUIRE_THROWS(shardFilter.filterShards(withMissing, std::vector<std::string>{"shardTestOut.fasta"}, 3, BayesicSpace::RecordOrder::input, 0));
+	}
+}
+
+TEST_CASE("Can reload FASTA records from a snapshot", "[snapshot]") {
+	const std::string snapFAfile("snapshotTest.fasta");
+	const std::string snapshotFile{BayesicSpace::Fasta::snapshotFileName(snapFAfile)};
+	{
+		std::fstream testFile("../tests/test.fasta", std::ios::in);
+		std::fstream outFASTA(snapFAfile, std::ios::out | std::ios::trunc);
+		outFASTA << testFile.rdbuf();
+	}
+	std::remove( snapshotFile.c_str() );
+	const BayesicSpace::Fasta parsedFA(snapFAfile);
+	auto sameRecords = [&parsedFA](const BayesicSpace::Fasta &otherFA) {
+		if ( otherFA.size() != parsedFA.size() ) {
+			return false;
+		}
+		for (size_t iRecord = 0; iRecord < parsedFA.size(); ++iRecord) {
+			if ( !( otherFA.header(iRecord) == parsedFA.header(iRecord) ) || !( otherFA.sequenceView(iRecord) == parsedFA.sequenceView(iRecord) ) ) {
+				return false;
+			}
+			if ( otherFA.find( parsedFA.header(iRecord).str() ) != iRecord ) {
+				return false;
+			}
+		}
+		return true;
+	};
+	SECTION("Snapshot creation and reuse") {
+		REQUIRE_FALSE( BayesicSpace::Fasta::snapshotIsCurrent(snapFAfile) );
+		const BayesicSpace::Fasta firstFA(snapFAfile, 2, false, true);
+		REQUIRE( BayesicSpace::Fasta::snapshotIsCurrent(snapFAfile) );
+		REQUIRE( sameRecords(firstFA) );
+		const BayesicSpace::Fasta snapshotFA(snapFAfile, 2, false, true);
+		REQUIRE( sameRecords(snapshotFA) );
+		// copies share the mapped snapshot
+		BayesicSpace::Fasta copiedFA(snapshotFA);
+		REQUIRE( sameRecords(copiedFA) );
+		const std::vector<std::string> headerList{parsedFA.header(3).str(), "notInFile", parsedFA.header(1).str()};
+		REQUIRE(snapshotFA.subsetIndexes(headerList, BayesicSpace::RecordOrder::list) == std::vector<size_t>{3, 1});
+		// packed loads do not use the snapshot
+		const BayesicSpace::Fasta packedFA(snapFAfile, 1, true, true);
+		REQUIRE( packedFA.isPacked() );
+		REQUIRE( packedFA.sequence(2) == parsedFA.sequence(2) );
+	}
+	SECTION("Stale and damaged snapshots") {
+		const BayesicSpace::Fasta firstFA(snapFAfile, 1, false, true);
+		REQUIRE( BayesicSpace::Fasta::snapshotIsCurrent(snapFAfile) );
+		{
+			std::fstream outFASTA(snapFAfile, std::ios::out | std::ios::app);
+			outFASTA << ">snapshotAddition\nACGTACGT\n";
+		}
+		REQUIRE_FALSE( BayesicSpace::Fasta::snapshotIsCurrent(snapFAfile) );
+		const BayesicSpace::Fasta changedFA(snapFAfile, 1, false, true);
+		REQUIRE(changedFA.size() == parsedFA.size() + 1);
+		REQUIRE( changedFA.sequence( changedFA.find("snapshotAddition") ) == std::string("ACGTACGT") );
+		REQUIRE( BayesicSpace::Fasta::snapshotIsCurrent(snapFAfile) );
+		// a truncated snapshot is rebuilt
+		const size_t snapshotSize = BayesicSpace::fileSize(snapshotFile);
+		REQUIRE(truncate(snapshotFile.c_str(), static_cast<off_t>(snapshotSize / 2)) == 0);
+		REQUIRE_FALSE( BayesicSpace::Fasta::snapshotIsCurrent(snapFAfile) );
+		const BayesicSpace::Fasta rebuiltFA(snapFAfile, 1, false, true);
+		REQUIRE(rebuiltFA.size() == parsedFA.size() + 1);
+		REQUIRE(BayesicSpace::fileSize(snapshotFile) == snapshotSize);
+		const BayesicSpace::Fasta reloadedFA(snapFAfile, 1, false, true);
+		REQUIRE( reloadedFA.sequence( reloadedFA.find("snapshotAddition") ) == std::string("ACGTACGT") );
+		// offsets outside the mapped file are errors
+		constexpr std::streamoff preambleSize{80};
+		const uint64_t badOffset{0xFFFFFFFFFFFFFF00ULL};
+		auto overwriteField = [&snapshotFile, &badOffset](const std::streamoff &position) {
+			std::fstream snapshot(snapshotFile, std::ios::in | std::ios::out | std::ios::binary);
+			snapshot.seekp(position);
+			snapshot.write( reinterpret_cast<const char*>(&badOffset), sizeof(badOffset) );
+		};
+		overwriteField(preambleSize + 8);
+		REQUIRE( BayesicSpace::Fasta::snapshotIsCurrent(snapFAfile) );
+		REQUIRE_THROWS_WITH(BayesicSpace::Fasta(snapFAfile, 1, false, true), Catch::Matchers::StartsWith("ERROR: header 0 is outside the header table of snapshot"));
+		std::remove( snapshotFile.c_str() );
+		const BayesicSpace::Fasta resavedFA(snapFAfile, 1, false, true);
+		const auto nRecords = static_cast<std::streamoff>( resavedFA.size() );
+		overwriteField(preambleSize + (nRecords + 1) * 8 + 8);
+		REQUIRE_THROWS_WITH(BayesicSpace::Fasta(snapFAfile, 1, false, true), Catch::Matchers::StartsWith("ERROR: sequence 0 is outside the sequences of snapshot"));
+	}
+	std::remove( snapshotFile.c_str() );
+}
+
+TEST_CASE("Can write BGZF-compressed FASTA files", "[bgzfout]") {
+	// long records span several blocks and several writer buffers
+	std::mt19937_64 generator(2023);
+	const std::string bases("ACGTN");
+	std::vector< std::pair<std::string, std::string> > records;
+	constexpr size_t nRecords{5};
+	constexpr size_t sequenceLength{600000};
+	for (size_t iRecord = 0; iRecord < nRecords; ++iRecord) {
+		std::string sequence(sequenceLength * iRecord + iRecord * 77, 'A');
+		for (auto &eachBase : sequence) {
+			eachBase = bases[generator() % bases.size()];
+		}
+		records.emplace_back("bgzfRecord" + std::to_string(iRecord) + " description", std::move(sequence));
+	}
+	constexpr size_t lineWidth{60};
+	BayesicSpace::OutputFormat format;
+	format.lineWidth    = lineWidth;
+	format.compression  = BayesicSpace::Compression::bgzf;
+	format.nThreads     = 3;
+	format.writeIndexes = true;
+	SECTION("Compressed output matches plain output") {
+		BayesicSpace::saveAsFASTA(records, "bgzfPlain.fasta", lineWidth);
+		for (const size_t &eachThreadCount : {static_cast<size_t>(1), static_cast<size_t>(3)}) {
+			format.nThreads = eachThreadCount;
+			BayesicSpace::saveAsFASTA(records, "bgzfOut.fasta.gz", format);
+			REQUIRE(BayesicSpace::detectCompression("bgzfOut.fasta.gz") == BayesicSpace::Compression::bgzf);
+			REQUIRE( (BayesicSpace::readWholeFile("bgzfOut.fasta.gz", 2) == BayesicSpace::readWholeFile("bgzfPlain.fasta", 1)) );
+		}
+		// the file ends with the standard empty block
+		std::fstream compressedFile("bgzfOut.fasta.gz", std::ios::in | std::ios::binary);
+		const std::string compressedBytes{std::istreambuf_iterator<char>(compressedFile), std::istreambuf_iterator<char>()};
+		const std::string endBlock{"\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43\x02\x00\x1b\x00\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00", 28};
+		REQUIRE(compressedBytes.size() > endBlock.size());
+		REQUIRE(compressedBytes.compare(compressedBytes.size() - endBlock.size(), endBlock.size(), endBlock) == 0);
+		// the filter and an empty subset compress too
+		const BayesicSpace::FastaFilter headerFilter(std::vector<std::string>{records[2].first, records[4].first}, BayesicSpace::HeaderMatch::whole);
+		BayesicSpace::RunStatistics noStatistics;
+		REQUIRE(headerFilter.filter("bgzfPlain.fasta", "bgzfFiltered.fasta.gz", 1, BayesicSpace::RecordOrder::list, format, noStatistics) == 2);
+		const BayesicSpace::Fasta filteredFA("bgzfFiltered.fasta.gz");
+		REQUIRE(filteredFA.size() == 2);
+		REQUIRE( (filteredFA.sequence(0) == records[2].second) );
+		REQUIRE( (filteredFA.sequence(1) == records[4].second) );
+		BayesicSpace::saveAsFASTA(std::vector< std::pair<std::string, std::string> >{}, "bgzfEmpty.fasta.gz", format);
+		REQUIRE(BayesicSpace::fileSize("bgzfEmpty.fasta.gz") == endBlock.size());
+		REQUIRE( BayesicSpace::readWholeFile("bgzfEmpty.fasta.gz", 1).empty() );
+	}
+	SECTION("Written indexes") {
+		BayesicSpace::saveAsFASTA(records, "bgzfPlain.fasta", lineWidth);
+		std::remove("bgzfPlain.fasta.fai");
+		const BayesicSpace::FastaIndex builtIndex("bgzfPlain.fasta");
+		BayesicSpace::saveAsFASTA(records, "bgzfOut.fasta.gz", format);
+		REQUIRE( BayesicSpace::FastaIndex::isFresh("bgzfOut.fasta.gz", "bgzfOut.fasta.gz.fai") );
+		REQUIRE( BayesicSpace::FastaIndex::isFresh("bgzfOut.fasta.gz", "bgzfOut.fasta.gz.gzi") );
+		const BayesicSpace::FastaIndex writtenIndex("bgzfOut.fasta.gz");
+		REQUIRE( writtenIndex.size() == builtIndex.size() );
+		for (size_t iRecord = 0; iRecord < builtIndex.size(); ++iRecord) {
+			REQUIRE(writtenIndex.entry(iRecord).name == builtIndex.entry(iRecord).name);
+			REQUIRE(writtenIndex.entry(iRecord).length == builtIndex.entry(iRecord).length);
+			REQUIRE(writtenIndex.entry(iRecord).offset == builtIndex.entry(iRecord).offset);
+			REQUIRE(writtenIndex.entry(iRecord).lineBases == builtIndex.entry(iRecord).lineBases);
+			REQUIRE(writtenIndex.entry(iRecord).lineBytes == builtIndex.entry(iRecord).lineBytes);
+		}
+		const BayesicSpace::IndexedFasta indexedFA("bgzfOut.fasta.gz");
+		std::string sequence;
+		REQUIRE( indexedFA.fetch(records[3].first, sequence) );
+		REQUIRE( (sequence == records[3].second) );
+		REQUIRE(indexedFA.region(records[4].first, 2000001, 2000100) == records[4].second.substr(2000000, 100));
+		// written indexes name records by accession, as samtools does
+		std::fstream writtenFai("bgzfOut.fasta.gz.fai", std::ios::in);
+		std::string faiLine;
+		std::getline(writtenFai, faiLine);
+		REQUIRE(faiLine.substr( 0, faiLine.find('\t') ) == std::string("bgzfRecord0"));
+		REQUIRE( indexedFA.fetch("bgzfRecord3", sequence) );
+		REQUIRE( (sequence == records[3].second) );
+		REQUIRE(indexedFA.region("bgzfRecord4", 2000001, 2000100) == records[4].second.substr(2000000, 100));
+		BayesicSpace::FastaWriter tabWriter("bgzfTab.fasta.gz", format, false);
+		tabWriter.write("tab\theader", "ACGT");
+		tabWriter.close();
+		const BayesicSpace::IndexedFasta tabFA("bgzfTab.fasta.gz");
+		REQUIRE( tabFA.fetch("tab", sequence) );
+		REQUIRE(sequence == std::string("ACGT"));
+		REQUIRE( tabFA.fetch("tab\theader", sequence) );
+	}
+}